@@ -0,0 +1,536 @@
+/*###############################################################################
+#
+# Copyright 2020-2021 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// Host-only reference implementation of the NvVFX API, built on the reference NvCVImage.
+// Transfer copies its input, SuperRes and Upscale resample bilinearly (Upscale also sharpens by its strength), and
+// ArtifactReduction and Denoising pass their input through. The effects validate their images and parameters the way
+// the SDK does, so that the samples exercise the same call sequences, but no models are needed.
+//
+// The time taken by NvVFX_Run() can be padded to mimic a GPU, with these environment variables:
+//   NVVFX_REF_RUN_LATENCY_US    minimum duration of each NvVFX_Run(), in microseconds
+//   NVVFX_REF_IMAGE_LATENCY_US  additional duration for each image in a batch, in microseconds
+//   NVVFX_REF_PIXEL_LATENCY_NS  additional duration for each pixel of output, in nanoseconds
+//   NVVFX_REF_MODE_LATENCY_US   additional duration for each image in aggressive mode (NVVFX_MODE 1), in microseconds
+//   NVVFX_REF_MAX_INPUT         the largest input accepted, as WxH (default 3840x2160)
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../../version.h"
+#include "nvVideoEffects.h"
+
+struct CUstream_st {
+  unsigned id;
+};
+
+struct NvVFX_StateObjectHandleBase {
+  NvVFX_Handle owner;
+  unsigned long long frames;  // frames processed since the state was allocated or reset
+};
+
+namespace {
+
+enum EffectKind { FX_TRANSFER, FX_ARTIFACT_REDUCTION, FX_SUPER_RES, FX_UPSCALE, FX_DENOISING };
+
+const struct {
+  const char *name;
+  EffectKind kind;
+  bool stateful;
+} kEffects[] = {
+    {NVVFX_FX_TRANSFER, FX_TRANSFER, false},
+    {NVVFX_FX_ARTIFACT_REDUCTION, FX_ARTIFACT_REDUCTION, false},
+    {NVVFX_FX_SUPER_RES, FX_SUPER_RES, false},
+    {NVVFX_FX_SR_UPSCALE, FX_UPSCALE, false},
+    {NVVFX_FX_DENOISING, FX_DENOISING, true},
+};
+
+const unsigned kMaxNumberStreams = 64;
+const unsigned long long kStateBytes = sizeof(NvVFX_StateObjectHandleBase);
+
+struct Latency {
+  std::chrono::microseconds run{0}, image{0}, aggressive{0};
+  std::chrono::nanoseconds pixel{0};
+  unsigned maxWidth = 3840, maxHeight = 2160;
+};
+
+const Latency &Config() {
+  static const Latency config = [] {
+    Latency c;
+    const char *s;
+    if (nullptr != (s = getenv("NVVFX_REF_RUN_LATENCY_US"))) c.run = std::chrono::microseconds(strtoll(s, nullptr, 0));
+    if (nullptr != (s = getenv("NVVFX_REF_IMAGE_LATENCY_US")))
+      c.image = std::chrono::microseconds(strtoll(s, nullptr, 0));
+    if (nullptr != (s = getenv("NVVFX_REF_PIXEL_LATENCY_NS")))
+      c.pixel = std::chrono::nanoseconds(strtoll(s, nullptr, 0));
+    if (nullptr != (s = getenv("NVVFX_REF_MODE_LATENCY_US")))
+      c.aggressive = std::chrono::microseconds(strtoll(s, nullptr, 0));
+    if (nullptr != (s = getenv("NVVFX_REF_MAX_INPUT"))) {
+      unsigned w, h;
+      if (2 == sscanf(s, "%u%*[xX]%u", &w, &h)) {
+        c.maxWidth = w;
+        c.maxHeight = h;
+      }
+    }
+    return c;
+  }();
+  return config;
+}
+
+bool SameShape(const NvCVImage &a, const NvCVImage &b) {
+  return a.width == b.width && a.height == b.height && a.pixelFormat == b.pixelFormat &&
+         a.componentType == b.componentType && a.planar == b.planar;
+}
+
+// Bilinear resampling of every component, with pixel centers aligned, as cv::INTER_LINEAR.
+template <typename T>
+void ResampleImage(const NvCVImage *src, NvCVImage *dst) {
+  const bool planar = NVCV_PLANAR == src->planar;
+  const int sStep = planar ? src->componentBytes : src->pixelBytes;
+  const int dStep = planar ? dst->componentBytes : dst->pixelBytes;
+  const float fx = (float)src->width / dst->width, fy = (float)src->height / dst->height;
+  std::vector<int> x0(dst->width), x1(dst->width);
+  std::vector<float> wx(dst->width);
+  for (unsigned x = 0; x < dst->width; ++x) {
+    float sx = (x + .5f) * fx - .5f;
+    if (sx < 0.f) sx = 0.f;
+    x0[x] = (int)sx;
+    x1[x] = (x0[x] + 1 < (int)src->width) ? x0[x] + 1 : x0[x];
+    wx[x] = sx - (float)x0[x];
+  }
+  for (unsigned c = 0; c < src->numComponents; ++c) {
+    ptrdiff_t sOff = planar ? (ptrdiff_t)c * src->height * src->pitch : (ptrdiff_t)c * src->componentBytes;
+    ptrdiff_t dOff = planar ? (ptrdiff_t)c * dst->height * dst->pitch : (ptrdiff_t)c * dst->componentBytes;
+    const unsigned char *sPlane = (const unsigned char *)src->pixels + sOff;
+    unsigned char *dPlane = (unsigned char *)dst->pixels + dOff;
+    for (unsigned y = 0; y < dst->height; ++y) {
+      float sy = (y + .5f) * fy - .5f;
+      if (sy < 0.f) sy = 0.f;
+      int y0 = (int)sy, y1 = (y0 + 1 < (int)src->height) ? y0 + 1 : y0;
+      float wy = sy - (float)y0;
+      const unsigned char *r0 = sPlane + (ptrdiff_t)y0 * src->pitch, *r1 = sPlane + (ptrdiff_t)y1 * src->pitch;
+      unsigned char *d = dPlane + (ptrdiff_t)y * dst->pitch;
+      for (unsigned x = 0; x < dst->width; ++x, d += dStep) {
+        float a = (float)*(const T *)(r0 + x0[x] * sStep), b = (float)*(const T *)(r0 + x1[x] * sStep);
+        float e = (float)*(const T *)(r1 + x0[x] * sStep), f = (float)*(const T *)(r1 + x1[x] * sStep);
+        float top = a + (b - a) * wx[x], bottom = e + (f - e) * wx[x], v = top + (bottom - top) * wy;
+        if (std::is_integral<T>::value) v = std::floor(v + .5f);
+        *(T *)d = (T)v;
+      }
+    }
+  }
+}
+
+NvCV_Status Resample(const NvCVImage *src, NvCVImage *dst) {
+  switch (src->componentType) {
+    case NVCV_U8:  ResampleImage<unsigned char>(src, dst); break;
+    case NVCV_F32: ResampleImage<float>(src, dst);         break;
+    default:       return NVCV_ERR_PIXELFORMAT;
+  }
+  return NVCV_SUCCESS;
+}
+
+// The nth image of a batch that starts with the given image, as laid out by AllocateBatchBuffer().
+void NthImage(const NvCVImage &first, unsigned n, NvCVImage *view) {
+  unsigned rows = (NVCV_PLANAR == first.planar) ? first.height * first.numComponents : first.height;
+  NvCVImage_InitView(view, const_cast<NvCVImage *>(&first), 0, 0, first.width, first.height);
+  view->pixels = (unsigned char *)first.pixels + (ptrdiff_t)n * rows * first.pitch;
+}
+
+}  // namespace
+
+struct NvVFX_Object {
+  std::string name;
+  EffectKind kind;
+  bool stateful;
+  NvCVImage src, dst;  // views of the images supplied by the app
+  NvCVImage tmp;       // the resampled image, before Upscale sharpens it
+  NvCVImage loadedSrc, loadedDst;  // the shapes at the time of NvVFX_Load()
+  std::string modelDir;
+  CUstream stream = nullptr;
+  float strength = 0.f;
+  unsigned mode = 0, temporal = 0, gpu = 0, cudaGraph = 0;
+  unsigned batchSize = 1, modelBatch = 1;
+  unsigned maxStreams = 1, loadedMaxStreams = 1;  // the number of states that may be allocated
+  unsigned loadedMode = 0;
+  NvVFX_StateObjectHandle *states = nullptr;
+  std::vector<NvVFX_StateObjectHandle> allocated;
+  bool loaded = false;
+
+  NvCV_Status load();
+  NvCV_Status runOne(const NvCVImage &in, NvCVImage *out);
+};
+
+NvCV_Status NvVFX_Object::load() {
+  if (!src.pixels || !dst.pixels) return NVCV_ERR_MISSINGINPUT;
+  if (src.width > Config().maxWidth || src.height > Config().maxHeight) return NVCV_ERR_RESOLUTION;
+  if (batchSize < 1 || modelBatch < 1) return NVCV_ERR_PARAMETER;
+  if (maxStreams < 1 || maxStreams > kMaxNumberStreams) return NVCV_ERR_PARAMETER;
+
+  // The model effects take the same formats as they do in the SDK.
+  switch (kind) {
+    case FX_TRANSFER:
+      if (src.width != dst.width || src.height != dst.height) return NVCV_ERR_MISMATCH;
+      break;
+    case FX_UPSCALE:
+      if (NVCV_RGBA != src.pixelFormat || NVCV_U8 != src.componentType || NVCV_CHUNKY != src.planar ||
+          NVCV_RGBA != dst.pixelFormat || NVCV_U8 != dst.componentType || NVCV_CHUNKY != dst.planar)
+        return NVCV_ERR_PIXELFORMAT;
+      if (dst.width < src.width || dst.height < src.height) return NVCV_ERR_RESOLUTION;
+      if (NVCV_SUCCESS != NvCVImage_Realloc(&tmp, dst.width, dst.height, dst.pixelFormat, dst.componentType,
+                                            dst.planar, NVCV_GPU, 32))
+        return NVCV_ERR_MEMORY;
+      break;
+    default:
+      if (NVCV_BGR != src.pixelFormat || NVCV_F32 != src.componentType || NVCV_PLANAR != src.planar ||
+          NVCV_BGR != dst.pixelFormat || NVCV_F32 != dst.componentType || NVCV_PLANAR != dst.planar)
+        return NVCV_ERR_PIXELFORMAT;
+      if (FX_SUPER_RES == kind) {
+        if (dst.width < src.width || dst.height < src.height) return NVCV_ERR_RESOLUTION;
+      } else if (src.width != dst.width || src.height != dst.height) {
+        return NVCV_ERR_MISMATCH;
+      }
+      break;
+  }
+  NvCVImage_InitView(&loadedSrc, &src, 0, 0, src.width, src.height);
+  NvCVImage_InitView(&loadedDst, &dst, 0, 0, dst.width, dst.height);
+  loadedMode = mode;
+  loadedMaxStreams = maxStreams;
+  loaded = true;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_Object::runOne(const NvCVImage &in, NvCVImage *out) {
+  NvCV_Status err;
+  switch (kind) {
+    case FX_SUPER_RES:
+      return Resample(&in, out);
+    case FX_UPSCALE:
+      if (strength <= 0.f) return Resample(&in, out);
+      if (NVCV_SUCCESS != (err = Resample(&in, &tmp))) return err;
+      return NvCVImage_Sharpen(strength, &tmp, out, stream, nullptr);
+    default:  // Transfer, and the pass-through effects
+      return NvCVImage_Transfer(&in, out, 1.f, stream, nullptr);
+  }
+}
+
+NvCV_Status NvVFX_API NvVFX_GetVersion(unsigned int *version) {
+  if (!version) return NVCV_ERR_PARAMETER;
+  *version = (NVIDIA_VIDEOEFFECTS_SDK_VERSION_MAJOR << 24) | (NVIDIA_VIDEOEFFECTS_SDK_VERSION_MINOR << 16) |
+             (NVIDIA_VIDEOEFFECTS_SDK_VERSION_RELEASE << 8) | NVIDIA_VIDEOEFFECTS_SDK_VERSION_BUILD;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_CreateEffect(NvVFX_EffectSelector code, NvVFX_Handle *effect) {
+  if (!code || !effect) return NVCV_ERR_PARAMETER;
+  *effect = nullptr;
+  for (const auto &fx : kEffects) {
+    if (strcmp(code, fx.name)) continue;
+    NvVFX_Handle obj = new NvVFX_Object;
+    obj->name = fx.name;
+    obj->kind = fx.kind;
+    obj->stateful = fx.stateful;
+    *effect = obj;
+    return NVCV_SUCCESS;
+  }
+  return NVCV_ERR_FEATURENOTFOUND;
+}
+
+void NvVFX_API NvVFX_DestroyEffect(NvVFX_Handle effect) {
+  if (!effect) return;
+  for (NvVFX_StateObjectHandle state : effect->allocated) delete state;
+  delete effect;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetU32(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, unsigned int val) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!strcmp(paramName, NVVFX_MODE))
+    effect->mode = val;
+  else if (!strcmp(paramName, NVVFX_TEMPORAL))
+    effect->temporal = val;
+  else if (!strcmp(paramName, NVVFX_GPU))
+    effect->gpu = val;
+  else if (!strcmp(paramName, NVVFX_CUDA_GRAPH))
+    effect->cudaGraph = val;
+  else if (!strcmp(paramName, NVVFX_BATCH_SIZE))
+    effect->batchSize = val;
+  else if (!strcmp(paramName, NVVFX_MODEL_BATCH))
+    effect->modelBatch = val;
+  else if (!strcmp(paramName, NVVFX_MAX_NUMBER_STREAMS))  // takes effect at the next NvVFX_Load()
+    effect->maxStreams = val;
+  else if (!strcmp(paramName, NVVFX_MAX_INPUT_WIDTH) || !strcmp(paramName, NVVFX_MAX_INPUT_HEIGHT) ||
+           !strcmp(paramName, NVVFX_STATE_COUNT))
+    return NVCV_ERR_PARAMREADONLY;
+  else
+    return NVCV_ERR_SELECTOR;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetS32(NvVFX_Handle effect, NvVFX_ParameterSelector /*paramName*/, int /*val*/) {
+  return effect ? NVCV_ERR_SELECTOR : NVCV_ERR_EFFECT;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetF32(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, float val) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (strcmp(paramName, NVVFX_STRENGTH)) return NVCV_ERR_SELECTOR;
+  if (val < 0.f || val > 1.f) return NVCV_ERR_PARAMETER;
+  effect->strength = val;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetF64(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, double val) {
+  return NvVFX_SetF32(effect, paramName, (float)val);
+}
+
+NvCV_Status NvVFX_API NvVFX_SetU64(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, unsigned long long val) {
+  return NvVFX_SetU32(effect, paramName, (unsigned)val);
+}
+
+NvCV_Status NvVFX_API NvVFX_SetObject(NvVFX_Handle effect, NvVFX_ParameterSelector /*paramName*/, void * /*ptr*/) {
+  return effect ? NVCV_ERR_SELECTOR : NVCV_ERR_EFFECT;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetStateObjectHandleArray(NvVFX_Handle effect, NvVFX_ParameterSelector paramName,
+                                                      NvVFX_StateObjectHandle *handle) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (strcmp(paramName, NVVFX_STATE)) return NVCV_ERR_SELECTOR;
+  effect->states = handle;  // read by NvVFX_Run(), one per image in the batch
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetCudaStream(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, CUstream stream) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (strcmp(paramName, NVVFX_CUDA_STREAM)) return NVCV_ERR_SELECTOR;
+  effect->stream = stream;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetImage(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, NvCVImage *im) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  NvCVImage *slot;
+  if (!strcmp(paramName, NVVFX_INPUT_IMAGE_0))
+    slot = &effect->src;
+  else if (!strcmp(paramName, NVVFX_OUTPUT_IMAGE_0))
+    slot = &effect->dst;
+  else
+    return NVCV_ERR_SELECTOR;
+  if (im)
+    NvCVImage_InitView(slot, im, 0, 0, im->width, im->height);  // the descriptor is copied, as in the SDK
+  else
+    NvCVImage_Dealloc(slot);
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_SetString(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, const char *str) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (strcmp(paramName, NVVFX_MODEL_DIRECTORY)) return NVCV_ERR_SELECTOR;
+  effect->modelDir = str ? str : "";
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetU32(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, unsigned int *val) {
+  if (!val) return NVCV_ERR_PARAMETER;
+  if (!strcmp(paramName, NVVFX_MAX_INPUT_WIDTH))
+    *val = Config().maxWidth;
+  else if (!strcmp(paramName, NVVFX_MAX_INPUT_HEIGHT))
+    *val = Config().maxHeight;
+  else if (!strcmp(paramName, NVVFX_MAX_NUMBER_STREAMS))
+    *val = effect ? effect->maxStreams : kMaxNumberStreams;
+  else if (!effect)
+    return NVCV_ERR_EFFECT;
+  else if (!strcmp(paramName, NVVFX_MODE))
+    *val = effect->mode;
+  else if (!strcmp(paramName, NVVFX_TEMPORAL))
+    *val = effect->temporal;
+  else if (!strcmp(paramName, NVVFX_GPU))
+    *val = effect->gpu;
+  else if (!strcmp(paramName, NVVFX_CUDA_GRAPH))
+    *val = effect->cudaGraph;
+  else if (!strcmp(paramName, NVVFX_BATCH_SIZE))
+    *val = effect->batchSize;
+  else if (!strcmp(paramName, NVVFX_MODEL_BATCH))
+    *val = effect->modelBatch;
+  else if (!strcmp(paramName, NVVFX_STATE_COUNT))
+    *val = (unsigned)effect->allocated.size();
+  else if (!strcmp(paramName, NVVFX_STATE_SIZE) && effect->stateful)
+    *val = (unsigned)kStateBytes;
+  else
+    return NVCV_ERR_SELECTOR;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetS32(NvVFX_Handle effect, NvVFX_ParameterSelector /*paramName*/, int * /*val*/) {
+  return effect ? NVCV_ERR_SELECTOR : NVCV_ERR_EFFECT;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetF32(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, float *val) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!val) return NVCV_ERR_PARAMETER;
+  if (strcmp(paramName, NVVFX_STRENGTH)) return NVCV_ERR_SELECTOR;
+  *val = effect->strength;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetF64(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, double *val) {
+  float f;
+  NvCV_Status err = NvVFX_GetF32(effect, paramName, &f);
+  if (NVCV_SUCCESS == err) *val = f;
+  return err;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetU64(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, unsigned long long *val) {
+  unsigned u;
+  if (!val) return NVCV_ERR_PARAMETER;
+  NvCV_Status err = NvVFX_GetU32(effect, paramName, &u);
+  if (NVCV_SUCCESS == err) *val = u;
+  return err;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetObject(NvVFX_Handle effect, NvVFX_ParameterSelector /*paramName*/, void ** /*ptr*/) {
+  return effect ? NVCV_ERR_SELECTOR : NVCV_ERR_EFFECT;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetCudaStream(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, CUstream *stream) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!stream) return NVCV_ERR_PARAMETER;
+  if (strcmp(paramName, NVVFX_CUDA_STREAM)) return NVCV_ERR_SELECTOR;
+  *stream = effect->stream;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetImage(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, NvCVImage *im) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!im) return NVCV_ERR_PARAMETER;
+  NvCVImage *slot;
+  if (!strcmp(paramName, NVVFX_INPUT_IMAGE_0))
+    slot = &effect->src;
+  else if (!strcmp(paramName, NVVFX_OUTPUT_IMAGE_0))
+    slot = &effect->dst;
+  else
+    return NVCV_ERR_SELECTOR;
+  NvCVImage_InitView(im, slot, 0, 0, slot->width, slot->height);
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_GetString(NvVFX_Handle effect, NvVFX_ParameterSelector paramName, const char **str) {
+  if (!str) return NVCV_ERR_PARAMETER;
+  if (!strcmp(paramName, NVVFX_INFO)) {
+    static const std::string info = [] {
+      std::string s;
+      for (const auto &fx : kEffects) s += std::string("  ") + fx.name + " (host reference)\n";
+      return s;
+    }();
+    *str = info.c_str();
+    return NVCV_SUCCESS;
+  }
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (strcmp(paramName, NVVFX_MODEL_DIRECTORY)) return NVCV_ERR_SELECTOR;
+  *str = effect->modelDir.c_str();
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_Run(NvVFX_Handle effect, int /*async*/) {
+  NvCV_Status err = NVCV_SUCCESS;
+  if (!effect) return NVCV_ERR_EFFECT;
+  const auto start = std::chrono::steady_clock::now();
+
+  // The images may be rebound between runs, but a change of shape or mode needs another NvVFX_Load().
+  if (!effect->loaded || !SameShape(effect->src, effect->loadedSrc) || !SameShape(effect->dst, effect->loadedDst) ||
+      effect->mode != effect->loadedMode)
+    return NVCV_ERR_INITIALIZATION;
+  if (effect->stateful && !effect->states) return NVCV_ERR_MISSINGINPUT;
+  for (unsigned n = 0; n < effect->batchSize; ++n) {
+    NvCVImage in, out;
+    if (effect->states) {
+      NvVFX_StateObjectHandle state = effect->states[n];
+      if (!state || state->owner != effect) return NVCV_ERR_PARAMETER;
+      ++state->frames;
+    }
+    NthImage(effect->src, n, &in);
+    NthImage(effect->dst, n, &out);
+    if (NVCV_SUCCESS != (err = effect->runOne(in, &out))) return err;
+  }
+
+  // Stand in for the time that the GPU would have taken, which grows with the size of the output and the mode.
+  const Latency &lat = Config();
+  auto busy = lat.run + (lat.image + lat.pixel * ((long long)effect->dst.width * effect->dst.height) +
+                         (effect->mode ? lat.aggressive : std::chrono::microseconds(0))) *
+                            effect->batchSize;
+  if (busy.count() > 0) std::this_thread::sleep_until(start + busy);
+  return err;
+}
+
+NvCV_Status NvVFX_API NvVFX_Load(NvVFX_Handle effect) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  effect->loaded = false;
+  return effect->load();
+}
+
+NvCV_Status NvVFX_API NvVFX_CudaStreamCreate(CUstream *stream) {
+  static std::atomic<unsigned> nextId{0};
+  if (!stream) return NVCV_ERR_PARAMETER;
+  *stream = new CUstream_st{++nextId};
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_CudaStreamDestroy(CUstream stream) {
+  delete stream;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_AllocateState(NvVFX_Handle effect, NvVFX_StateObjectHandle *handle) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!handle) return NVCV_ERR_PARAMETER;
+  if (!effect->stateful) return NVCV_ERR_FEATURENOTFOUND;
+  if (!effect->loaded) return NVCV_ERR_INITIALIZATION;
+  if (effect->allocated.size() >= effect->loadedMaxStreams) return NVCV_ERR_TOOBIG;
+  *handle = new NvVFX_StateObjectHandleBase{effect, 0};
+  effect->allocated.push_back(*handle);
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvVFX_API NvVFX_DeallocateState(NvVFX_Handle effect, NvVFX_StateObjectHandle handle) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  for (auto it = effect->allocated.begin(); it != effect->allocated.end(); ++it) {
+    if (*it != handle) continue;
+    effect->allocated.erase(it);
+    delete handle;
+    return NVCV_SUCCESS;
+  }
+  return NVCV_ERR_OBJECTNOTFOUND;
+}
+
+NvCV_Status NvVFX_API NvVFX_ResetState(NvVFX_Handle effect, NvVFX_StateObjectHandle handle) {
+  if (!effect) return NVCV_ERR_EFFECT;
+  if (!handle || handle->owner != effect) return NVCV_ERR_OBJECTNOTFOUND;
+  handle->frames = 0;
+  return NVCV_SUCCESS;
+}
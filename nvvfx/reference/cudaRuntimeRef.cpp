@@ -0,0 +1,96 @@
+/*###############################################################################
+#
+# Copyright 2020-2021 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// The few CUDA runtime entry points used by the samples, for the host-only reference backend.
+// The reference NvVFX and NvCVImage libraries finish all of their work before returning, so every stream is always
+// idle, and events and stream synchronization reduce to bookkeeping.
+
+#include <chrono>
+
+#include "cuda_runtime_api.h"
+
+struct CUevent_st {
+  std::chrono::steady_clock::time_point recorded;
+};
+
+extern "C" {
+
+cudaError_t CUDARTAPI cudaEventCreate(cudaEvent_t *event) {
+  if (!event) return cudaErrorInvalidValue;
+  *event = new CUevent_st{std::chrono::steady_clock::now()};
+  return cudaSuccess;
+}
+
+cudaError_t CUDARTAPI cudaEventCreateWithFlags(cudaEvent_t *event, unsigned int /*flags*/) {
+  return cudaEventCreate(event);
+}
+
+cudaError_t CUDARTAPI cudaEventDestroy(cudaEvent_t event) {
+  delete event;
+  return cudaSuccess;
+}
+
+cudaError_t CUDARTAPI cudaEventRecord(cudaEvent_t event, cudaStream_t /*stream*/) {
+  if (!event) return cudaErrorInvalidResourceHandle;
+  event->recorded = std::chrono::steady_clock::now();
+  return cudaSuccess;
+}
+
+cudaError_t CUDARTAPI cudaEventQuery(cudaEvent_t event) {
+  return event ? cudaSuccess : cudaErrorInvalidResourceHandle;
+}
+
+cudaError_t CUDARTAPI cudaEventSynchronize(cudaEvent_t event) {
+  return event ? cudaSuccess : cudaErrorInvalidResourceHandle;
+}
+
+cudaError_t CUDARTAPI cudaEventElapsedTime(float *ms, cudaEvent_t start, cudaEvent_t end) {
+  if (!ms) return cudaErrorInvalidValue;
+  if (!start || !end) return cudaErrorInvalidResourceHandle;
+  *ms = std::chrono::duration<float, std::milli>(end->recorded - start->recorded).count();
+  return cudaSuccess;
+}
+
+cudaError_t CUDARTAPI cudaStreamWaitEvent(cudaStream_t /*stream*/, cudaEvent_t event, unsigned int /*flags*/) {
+  return event ? cudaSuccess : cudaErrorInvalidResourceHandle;
+}
+
+cudaError_t CUDARTAPI cudaStreamSynchronize(cudaStream_t /*stream*/) { return cudaSuccess; }
+
+cudaError_t CUDARTAPI cudaStreamQuery(cudaStream_t /*stream*/) { return cudaSuccess; }
+
+cudaError_t CUDARTAPI cudaDeviceSynchronize(void) { return cudaSuccess; }
+
+cudaError_t CUDARTAPI cudaGetLastError(void) { return cudaSuccess; }
+
+cudaError_t CUDARTAPI cudaPeekAtLastError(void) { return cudaSuccess; }
+
+const char *CUDARTAPI cudaGetErrorName(cudaError_t error) {
+  return (cudaSuccess == error) ? "cudaSuccess" : "cudaErrorUnknown";
+}
+
+const char *CUDARTAPI cudaGetErrorString(cudaError_t error) {
+  return (cudaSuccess == error) ? "no error" : "an error occurred in the host reference CUDA runtime";
+}
+
+}  // extern "C"
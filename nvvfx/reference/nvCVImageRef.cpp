@@ -0,0 +1,1035 @@
+/*###############################################################################
+#
+# Copyright 2020-2021 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// Host-only reference implementation of the NvCVImage API.
+// Every memory space, including NVCV_GPU and NVCV_CUDA_ARRAY, is ordinary host memory, and every operation completes
+// before it returns, so CUDA streams are accepted and ignored. This is meant for running and profiling the samples on
+// machines without an NVIDIA GPU, not for production use.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nvCVImageRef.h"
+
+namespace {
+
+bool IsYUV(NvCVImage_PixelFormat format) {
+  return NVCV_YUV420 == format || NVCV_YUV422 == format || NVCV_YUV444 == format;
+}
+
+unsigned ComponentBytes(NvCVImage_ComponentType type) {
+  switch (type) {
+    case NVCV_U8:  return 1;
+    case NVCV_U16: case NVCV_S16: case NVCV_F16: return 2;
+    case NVCV_U32: case NVCV_S32: case NVCV_F32: return 4;
+    case NVCV_U64: case NVCV_S64: case NVCV_F64: return 8;
+    default:       return 0;
+  }
+}
+
+// Byte offsets of the U and V planes, and the chroma pitch, derived from the luma pitch.
+// Chunky 4:2:2 and 4:4:4 have a single plane. Returns the number of bytes of the whole image.
+unsigned long long YUVLayout(NvCVImage_PixelFormat format, unsigned layout, unsigned height, int pitch,
+                             long long *uOff, long long *vOff, int *cPitch, int *cPixSpan) {
+  unsigned long long ap = (unsigned long long)(pitch < 0 ? -pitch : pitch);
+  unsigned cHeight = (NVCV_YUV420 == format) ? (height + 1) / 2 : height;
+  unsigned long long lumaBytes = ap * height;
+  switch (layout) {
+    case NVCV_YUV:  // [Y][U][V]
+    case NVCV_YVU: {  // [Y][V][U]
+      int cp = (NVCV_YUV444 == format) ? pitch : pitch / 2;
+      long long first = (long long)lumaBytes, second = first + (long long)cp * cHeight;
+      *uOff = (NVCV_YUV == layout) ? first : second;
+      *vOff = (NVCV_YUV == layout) ? second : first;
+      *cPitch = cp;
+      *cPixSpan = 1;
+      return lumaBytes + 2ULL * (unsigned long long)(cp < 0 ? -cp : cp) * cHeight;
+    }
+    case NVCV_YCUV:  // [Y][UV]
+    case NVCV_YCVU: {  // [Y][VU]
+      int cp = (NVCV_YUV444 == format) ? pitch * 2 : pitch;
+      *uOff = (long long)lumaBytes + (NVCV_YCUV == layout ? 0 : 1);
+      *vOff = (long long)lumaBytes + (NVCV_YCUV == layout ? 1 : 0);
+      *cPitch = cp;
+      *cPixSpan = 2;
+      return lumaBytes + (unsigned long long)(cp < 0 ? -cp : cp) * cHeight;
+    }
+    default:  // Chunky
+      *uOff = *vOff = 0;
+      *cPitch = pitch;
+      *cPixSpan = 0;
+      return lumaBytes;
+  }
+}
+
+// The pixel and component byte counts, and the number of components, of the given format and layout.
+bool PixelGeometry(NvCVImage_PixelFormat format, NvCVImage_ComponentType type, unsigned layout,
+                   unsigned char *pixelBytes, unsigned char *componentBytes, unsigned char *numComponents) {
+  int sem[4];
+  unsigned cb = ComponentBytes(type), nc;
+  if (NVCV_FORMAT_UNKNOWN == format || NVCV_TYPE_UNKNOWN == type) {
+    *pixelBytes = *componentBytes = *numComponents = 0;
+    return NVCV_FORMAT_UNKNOWN == format && NVCV_TYPE_UNKNOWN == type;
+  }
+  if (!cb) return false;
+  if (IsYUV(format)) {
+    nc = 3;
+    switch (layout) {
+      case NVCV_UYVY: case NVCV_VYUY: case NVCV_YUYV: case NVCV_YVYU:
+        if (NVCV_YUV422 != format) return false;
+        *pixelBytes = (unsigned char)(2 * cb);
+        break;
+      case NVCV_CYUV: case NVCV_CYVU:
+        if (NVCV_YUV444 != format) return false;
+        *pixelBytes = (unsigned char)(3 * cb);
+        break;
+      case NVCV_YUV: case NVCV_YVU: case NVCV_YCUV: case NVCV_YCVU:
+        *pixelBytes = (unsigned char)cb;
+        break;
+      default:
+        return false;
+    }
+  } else {
+    if (0 == (nc = (unsigned)FormatSemantics(format, sem))) return false;
+    if (NVCV_CHUNKY != layout && NVCV_PLANAR != layout) return false;
+    *pixelBytes = (unsigned char)((NVCV_PLANAR == layout) ? cb : cb * nc);
+  }
+  *componentBytes = (unsigned char)cb;
+  *numComponents = (unsigned char)nc;
+  return true;
+}
+
+// The number of bytes in a row of pixels. The rows of subsampled YUV have whole pairs of pixels, so that the chroma
+// of an odd width fits within the pitch.
+unsigned long long RowBytes(const NvCVImage *im, unsigned width) {
+  if (IsYUV(im->pixelFormat) && NVCV_YUV444 != im->pixelFormat) width += width & 1;
+  return (unsigned long long)width * ((NVCV_PLANAR == im->planar) ? im->componentBytes : im->pixelBytes);
+}
+
+// The number of bytes spanned by an image with the given pitch.
+unsigned long long ImageBytes(const NvCVImage *im) {
+  long long uOff, vOff;
+  int cPitch, cSpan;
+  unsigned long long ap = (unsigned long long)(im->pitch < 0 ? -im->pitch : im->pitch);
+  if (IsYUV(im->pixelFormat)) return YUVLayout(im->pixelFormat, im->planar, im->height, im->pitch, &uOff, &vOff,
+                                               &cPitch, &cSpan);
+  if (NVCV_PLANAR == im->planar) return ap * im->height * im->numComponents;
+  return ap * im->height;
+}
+
+// Whether the bytes spanned by two images may intersect, e.g. views of the same buffer. Negative pitches span
+// downward from pixels.
+bool BuffersOverlap(const NvCVImage *a, const NvCVImage *b) {
+  const unsigned char *lo[2], *hi[2];
+  const NvCVImage *im[2] = {a, b};
+  for (int i = 0; i < 2; ++i) {
+    long long rows = (long long)im[i]->height * ((NVCV_PLANAR == im[i]->planar) ? im[i]->numComponents : 1);
+    long long last = (long long)im[i]->pitch * (rows - 1), span = im[i]->pitch < 0 ? -im[i]->pitch : im[i]->pitch;
+    lo[i] = (const unsigned char *)im[i]->pixels + (last < 0 ? last : 0);
+    hi[i] = (const unsigned char *)im[i]->pixels + (last > 0 ? last : 0) + span;
+  }
+  return lo[0] < hi[1] && lo[1] < hi[0];
+}
+
+void *AllocBytes(unsigned long long size) {
+  const size_t align = 64;
+  size = (size + align - 1) & ~(unsigned long long)(align - 1);
+#ifdef _WIN32
+  return _aligned_malloc((size_t)size, align);
+#else   // !_WIN32
+  return std::aligned_alloc(align, (size_t)size);
+#endif  // _WIN32
+}
+
+void FreeBytes(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else   // !_WIN32
+  std::free(p);
+#endif  // _WIN32
+}
+
+template <typename T> struct Range;
+template <> struct Range<unsigned char>  { static constexpr float lo = 0.f,      hi = 255.f,   opaque = 255.f; };
+template <> struct Range<unsigned short> { static constexpr float lo = 0.f,      hi = 65535.f, opaque = 65535.f; };
+template <> struct Range<short>          { static constexpr float lo = -32768.f, hi = 32767.f, opaque = 32767.f; };
+template <> struct Range<float>          { static constexpr float lo = -HUGE_VALF, hi = HUGE_VALF, opaque = 1.f; };
+
+template <typename T>
+inline T FromFloat(float v) {
+  if (v < Range<T>::lo) v = Range<T>::lo;
+  if (v > Range<T>::hi) v = Range<T>::hi;
+  return (T)std::floor(v + .5f);
+}
+template <>
+inline float FromFloat<float>(float v) {
+  return v;
+}
+
+// Rec.601 luma weights, as used by OpenCV's cvtColor().
+const float kLumaR = 0.299f, kLumaG = 0.587f, kLumaB = 0.114f;
+
+void BuildComponentMap(NvCVImage_PixelFormat srcFormat, NvCVImage_PixelFormat dstFormat, ComponentMap *map,
+                       int *numDst) {
+  int srcSem[4], dstSem[4], where[5] = {-1, -1, -1, -1, -1};
+  int ns = FormatSemantics(srcFormat, srcSem), nd = FormatSemantics(dstFormat, dstSem);
+  for (int i = 0; i < ns; ++i) where[srcSem[i]] = i;
+  bool srcColor = where[SEM_R] >= 0;
+  for (int k = 0; k < nd; ++k) {
+    int s = dstSem[k];
+    map[k].op = MAP_ZERO;
+    if (where[s] >= 0) {
+      map[k].op = MAP_COPY;
+      map[k].src[0] = where[s];
+    } else if (SEM_A == s) {
+      map[k].op = MAP_OPAQUE;
+    } else if (SEM_Y == s && srcColor) {
+      map[k].op = MAP_LUMA;
+      map[k].src[0] = where[SEM_R];
+      map[k].src[1] = where[SEM_G];
+      map[k].src[2] = where[SEM_B];
+    } else if (SEM_Y != s && where[SEM_Y] >= 0) {  // gray to color
+      map[k].op = MAP_COPY;
+      map[k].src[0] = where[SEM_Y];
+    }
+  }
+  *numDst = nd;
+}
+
+template <typename S, typename D>
+void ConvertRegion(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                   unsigned height, const ComponentMap *map, int nd, float scale) {
+  const int sStep = ComponentStep(src), dStep = ComponentStep(dst);
+  const D opaque = FromFloat<D>(Range<D>::opaque);
+  for (unsigned y = 0; y < height; ++y) {
+    const unsigned char *sp[4];
+    for (unsigned c = 0; c < src->numComponents; ++c) sp[c] = ComponentPtr(src, c, sx, sy + (int)y);
+    for (int k = 0; k < nd; ++k) {
+      unsigned char *dp = ComponentPtr(dst, (unsigned)k, dx, dy + (int)y);
+      const ComponentMap &m = map[k];
+      switch (m.op) {
+        case MAP_COPY: {
+          const unsigned char *s = sp[m.src[0]];
+          for (unsigned x = 0; x < width; ++x, s += sStep, dp += dStep)
+            *(D *)dp = FromFloat<D>((float)*(const S *)s * scale);
+        } break;
+        case MAP_LUMA: {
+          const unsigned char *r = sp[m.src[0]], *g = sp[m.src[1]], *b = sp[m.src[2]];
+          for (unsigned x = 0; x < width; ++x, r += sStep, g += sStep, b += sStep, dp += dStep)
+            *(D *)dp = FromFloat<D>((kLumaR * (float)*(const S *)r + kLumaG * (float)*(const S *)g +
+                                     kLumaB * (float)*(const S *)b) * scale);
+        } break;
+        default: {
+          const D v = (MAP_OPAQUE == m.op) ? opaque : (D)0;
+          for (unsigned x = 0; x < width; ++x, dp += dStep) *(D *)dp = v;
+        } break;
+      }
+    }
+  }
+}
+
+template <typename S>
+NvCV_Status ConvertRegionFrom(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                              unsigned height, const ComponentMap *map, int nd, float scale) {
+  switch (dst->componentType) {
+    case NVCV_U8:  ConvertRegion<S, unsigned char>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);  break;
+    case NVCV_U16: ConvertRegion<S, unsigned short>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale); break;
+    case NVCV_S16: ConvertRegion<S, short>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);          break;
+    case NVCV_F32: ConvertRegion<S, float>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);          break;
+    default:       return NVCV_ERR_PIXELFORMAT;
+  }
+  return NVCV_SUCCESS;
+}
+
+// A persistent pool of threads that transfers share, to convert bands of rows concurrently. It is never destroyed,
+// so that no thread is joined while the process or the library is being torn down.
+class RowPool {
+ public:
+  static RowPool &Get() {
+    static RowPool *pool = new RowPool;
+    return *pool;
+  }
+  unsigned threads() const { return _threads; }
+
+  // Call fn(0) ... fn(n - 1), the caller taking part, and return when all have completed.
+  void ParallelFor(unsigned n, const std::function<void(unsigned)> &fn) {
+    if (n <= 1 || _threads <= 1) {
+      for (unsigned i = 0; i < n; ++i) fn(i);
+      return;
+    }
+    std::atomic<unsigned> pending(n - 1);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (unsigned i = 1; i < n; ++i) _tasks.push_back(Task{&fn, i, &pending});
+    }
+    _cv.notify_all();
+    fn(0);
+    while (pending.load(std::memory_order_acquire)) {  // help rather than block
+      Task task;
+      if (Pop(&task))
+        task.Run();
+      else
+        std::this_thread::yield();
+    }
+  }
+
+ private:
+  struct Task {
+    const std::function<void(unsigned)> *fn;
+    unsigned i;
+    std::atomic<unsigned> *pending;
+    void Run() {
+      (*fn)(i);
+      pending->fetch_sub(1, std::memory_order_release);
+    }
+  };
+
+  RowPool() {
+    const char *env = getenv("NVCV_REF_THREADS");
+    _threads = env ? (unsigned)atoi(env) : std::min(std::thread::hardware_concurrency(), 16u);
+    if (!_threads) _threads = 1;
+    for (unsigned i = 1; i < _threads; ++i) std::thread(&RowPool::Work, this).detach();
+  }
+  bool Pop(Task *task) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_tasks.empty()) return false;
+    *task = _tasks.front();
+    _tasks.pop_front();
+    return true;
+  }
+  void Work() {
+    for (;;) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return !_tasks.empty(); });
+        task = _tasks.front();
+        _tasks.pop_front();
+      }
+      task.Run();
+    }
+  }
+
+  unsigned _threads;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque<Task> _tasks;
+};
+
+// The number of bands of rows to split a region into: small regions are not worth waking threads for.
+unsigned NumBands(size_t pixels, unsigned rows) {
+  const size_t kMinBandPixels = 65536;
+  return (unsigned)std::max<size_t>(1, std::min<size_t>({pixels / kMinBandPixels, RowPool::Get().threads(), rows}));
+}
+unsigned NumBands(unsigned width, unsigned height, const NvCVImage *src, const NvCVImage *dst) {
+  if (BuffersOverlap(src, dst)) return 1;  // rows must be visited in order
+  return NumBands((size_t)width * height, height);
+}
+
+bool IsSupportedType(NvCVImage_ComponentType type) {
+  return NVCV_U8 == type || NVCV_U16 == type || NVCV_S16 == type || NVCV_F32 == type;
+}
+
+// Convert a region whose component types are supported: the vector kernels take as many columns as they can, and
+// the scalar code the rest.
+void ConvertRows(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                 unsigned height, const ComponentMap *map, int nd, float scale) {
+  unsigned done = TransferColumnsSIMD(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);
+  if (done == width) return;
+  sx += (int)done;
+  dx += (int)done;
+  width -= done;
+  switch (src->componentType) {
+    case NVCV_U8:  ConvertRegionFrom<unsigned char>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);  break;
+    case NVCV_U16: ConvertRegionFrom<unsigned short>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale); break;
+    case NVCV_S16: ConvertRegionFrom<short>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);          break;
+    default:       ConvertRegionFrom<float>(src, sx, sy, dst, dx, dy, width, height, map, nd, scale);          break;
+  }
+}
+
+// Copy or convert a width x height region of src at (sx, sy) to dst at (dx, dy). The region has been clipped.
+NvCV_Status TransferRegion(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                           unsigned height, float scale) {
+  if (!src->pixels || !dst->pixels) return NVCV_ERR_BUFFER;
+  if (!width || !height) return NVCV_SUCCESS;
+  const unsigned bands = NumBands(width, height, src, dst);
+  auto bandRows = [height, bands](unsigned b, unsigned *y0) {
+    *y0 = (unsigned)((size_t)height * b / bands);
+    return (unsigned)((size_t)height * (b + 1) / bands) - *y0;
+  };
+
+  // The same format is a plain copy of each row of each plane.
+  if (src->pixelFormat == dst->pixelFormat && src->componentType == dst->componentType &&
+      src->planar == dst->planar && 1.f == scale && !IsYUV(src->pixelFormat)) {
+    unsigned planes = (NVCV_PLANAR == src->planar) ? src->numComponents : 1;
+    size_t rowBytes = (size_t)width * src->pixelBytes;
+    RowPool::Get().ParallelFor(bands, [&](unsigned b) {
+      unsigned y0, rows = bandRows(b, &y0);
+      for (unsigned c = 0; c < planes; ++c)
+        for (unsigned y = y0; y < y0 + rows; ++y)
+          memmove(ComponentPtr(dst, c, dx, dy + (int)y), ComponentPtr(src, c, sx, sy + (int)y), rowBytes);
+    });
+    return NVCV_SUCCESS;
+  }
+
+  if (IsYUV(src->pixelFormat) || IsYUV(dst->pixelFormat)) return NVCV_ERR_PIXELFORMAT;
+  if (!IsSupportedType(src->componentType) || !IsSupportedType(dst->componentType)) return NVCV_ERR_PIXELFORMAT;
+  ComponentMap map[4];
+  int nd;
+  BuildComponentMap(src->pixelFormat, dst->pixelFormat, map, &nd);
+  RowPool::Get().ParallelFor(bands, [&](unsigned b) {
+    unsigned y0, rows = bandRows(b, &y0);
+    ConvertRows(src, sx, sy + (int)y0, dst, dx, dy + (int)y0, width, rows, map, nd, scale);
+  });
+  return NVCV_SUCCESS;
+}
+
+// dst = bg + (fg - bg) * matte, or fg + bg * (1 - matte) if fg is premultiplied, for every component. A bg with a zero
+// pitch and step is a constant color.
+template <typename T>
+void CompositeRegion(const NvCVImage *fg, const NvCVImage *bg, const void *bgColor, const NvCVImage *mat,
+                     NvCVImage *dst, bool premultiplied) {
+  const int fStep = ComponentStep(fg), dStep = ComponentStep(dst), mStep = ComponentStep(mat);
+  const int bStep = bg ? ComponentStep(bg) : 0;
+  const float mScale = (NVCV_U8 == mat->componentType) ? 1.f / 255.f : 1.f;
+  for (unsigned c = 0; c < dst->numComponents; ++c) {
+    for (unsigned y = 0; y < dst->height; ++y) {
+      const unsigned char *f = ComponentPtr(fg, c, 0, (int)y), *m = ComponentPtr(mat, 0, 0, (int)y);
+      const unsigned char *b = bg ? ComponentPtr(bg, c, 0, (int)y) : (const unsigned char *)bgColor + c * sizeof(T);
+      unsigned char *d = ComponentPtr(dst, c, 0, (int)y);
+      for (unsigned x = 0; x < dst->width; ++x, f += fStep, b += bStep, m += mStep, d += dStep) {
+        float a = ((NVCV_U8 == mat->componentType) ? (float)*m : *(const float *)m) * mScale;
+        float bv = (float)*(const T *)b, fv = (float)*(const T *)f;
+        *(T *)d = FromFloat<T>(premultiplied ? fv + bv * (1.f - a) : bv + (fv - bv) * a);
+      }
+    }
+  }
+}
+
+NvCV_Status CompositeImages(const NvCVImage *fg, const NvCVImage *bg, const void *bgColor, const NvCVImage *mat,
+                            NvCVImage *dst, bool premultiplied = false) {
+  if (!fg || !mat || !dst || (!bg && !bgColor)) return NVCV_ERR_PARAMETER;
+  if (!fg->pixels || !mat->pixels || !dst->pixels || (bg && !bg->pixels)) return NVCV_ERR_BUFFER;
+  if (fg->pixelFormat != dst->pixelFormat || fg->componentType != dst->componentType ||
+      (bg && (bg->pixelFormat != dst->pixelFormat || bg->componentType != dst->componentType)))
+    return NVCV_ERR_MISMATCH;
+  if (fg->width != dst->width || fg->height != dst->height || mat->width != dst->width ||
+      mat->height != dst->height || (bg && (bg->width != dst->width || bg->height != dst->height)))
+    return NVCV_ERR_MISMATCH;
+  if (1 != mat->numComponents || (NVCV_U8 != mat->componentType && NVCV_F32 != mat->componentType))
+    return NVCV_ERR_PIXELFORMAT;
+  switch (dst->componentType) {
+    case NVCV_U8:  CompositeRegion<unsigned char>(fg, bg, bgColor, mat, dst, premultiplied);  break;
+    case NVCV_U16: CompositeRegion<unsigned short>(fg, bg, bgColor, mat, dst, premultiplied); break;
+    case NVCV_F32: CompositeRegion<float>(fg, bg, bgColor, mat, dst, premultiplied);          break;
+    default:       return NVCV_ERR_PIXELFORMAT;
+  }
+  return NVCV_SUCCESS;
+}
+
+// Unsharp mask with a 4-neighbor blur; alpha is copied unchanged.
+template <typename T>
+void SharpenImage(float sharpness, const NvCVImage *src, NvCVImage *dst) {
+  int sem[4];
+  const int sStep = ComponentStep(src), dStep = ComponentStep(dst);
+  const int w = (int)src->width, h = (int)src->height;
+  FormatSemantics(src->pixelFormat, sem);
+  for (unsigned c = 0; c < src->numComponents; ++c) {
+    float amount = (SEM_A == sem[c]) ? 0.f : sharpness;
+    for (int y = 0; y < h; ++y) {
+      const unsigned char *n = ComponentPtr(src, c, 0, y > 0 ? y - 1 : 0);
+      const unsigned char *s = ComponentPtr(src, c, 0, y);
+      const unsigned char *v = ComponentPtr(src, c, 0, y + 1 < h ? y + 1 : y);
+      unsigned char *d = ComponentPtr(dst, c, 0, y);
+      for (int x = 0; x < w; ++x, d += dStep) {
+        int xl = (x > 0 ? x - 1 : 0) * sStep, xc = x * sStep, xr = (x + 1 < w ? x + 1 : x) * sStep;
+        float center = (float)*(const T *)(s + xc);
+        float blur = .25f * ((float)*(const T *)(n + xc) + (float)*(const T *)(v + xc) +
+                             (float)*(const T *)(s + xl) + (float)*(const T *)(s + xr));
+        *(T *)d = FromFloat<T>(center + amount * (center - blur));
+      }
+    }
+  }
+}
+
+// Rows [y0, y1) of a width x height region of YUV to dst at (dx, dy).
+template <typename D>
+void ConvertFromYUV(const YUVPlanes &yuv, NvCVImage *dst, int dx, int dy, unsigned width, unsigned height,
+                    unsigned y0, unsigned y1, float scale) {
+  int sem[4];
+  const int nd = FormatSemantics(dst->pixelFormat, sem), dStep = ComponentStep(dst);
+  const YUVCoefficients k = GetYUVCoefficients(yuv.colorspace);
+  const float rv = 2.f * (1.f - k.kr), bu = 2.f * (1.f - k.kb);
+  const float gu = bu * k.kb / k.kg, gv = rv * k.kr / k.kg;
+  const bool subX = NVCV_YUV444 != yuv.format, subY = NVCV_YUV420 == yuv.format;
+  const bool cositedX = ChromaCositedX(yuv.colorspace), cositedY = ChromaCositedY(yuv.colorspace);
+  const int cw = subX ? (int)(width + 1) / 2 : (int)width, ch = subY ? (int)(height + 1) / 2 : (int)height;
+  const D opaque = FromFloat<D>(Range<D>::opaque);
+  std::vector<float> uRow((size_t)cw), vRow((size_t)cw);
+
+  for (int y = (int)y0; y < (int)y1; ++y) {
+    int j0 = y, j1 = y;
+    float wy = 0.f;
+    if (subY) ChromaTaps(y, ch, cositedY, &j0, &j1, &wy);
+    const unsigned char *u0 = yuv.u + (ptrdiff_t)j0 * yuv.cPitch, *u1 = yuv.u + (ptrdiff_t)j1 * yuv.cPitch;
+    const unsigned char *v0 = yuv.v + (ptrdiff_t)j0 * yuv.cPitch, *v1 = yuv.v + (ptrdiff_t)j1 * yuv.cPitch;
+    for (int i = 0; i < cw; ++i) {
+      ptrdiff_t o = (ptrdiff_t)i * yuv.cPixBytes;
+      uRow[i] = (1.f - wy) * u0[o] + wy * u1[o];
+      vRow[i] = (1.f - wy) * v0[o] + wy * v1[o];
+    }
+    const unsigned char *yp = yuv.y + (ptrdiff_t)y * yuv.yPitch;
+    unsigned char *dp[4];
+    for (int c = 0; c < nd; ++c) dp[c] = ComponentPtr(dst, (unsigned)c, dx, dy + y);
+    for (int x = 0; x < (int)width; ++x, yp += yuv.yPixBytes) {
+      int i0 = x, i1 = x;
+      float wx = 0.f;
+      if (subX) ChromaTaps(x, cw, cositedX, &i0, &i1, &wx);
+      float Y = ((float)*yp - k.yBias) * k.yGain;
+      float U = ((1.f - wx) * uRow[i0] + wx * uRow[i1] - 128.f) * k.cGain;
+      float V = ((1.f - wx) * vRow[i0] + wx * vRow[i1] - 128.f) * k.cGain;
+      float rgb[3] = {Y + rv * V, Y - gu * U - gv * V, Y + bu * U};
+      for (int c = 0; c < nd; ++c) {
+        D *d = (D *)dp[c];
+        switch (sem[c]) {
+          case SEM_A: *d = opaque;                            break;
+          case SEM_Y: *d = FromFloat<D>(Y * scale);           break;
+          default:    *d = FromFloat<D>(rgb[sem[c]] * scale); break;
+        }
+        dp[c] += dStep;
+      }
+    }
+  }
+}
+
+// A width x height region of src at (sx, sy) to chroma rows [j0, j1) of YUV, and the luma rows that they cover.
+template <typename S>
+void ConvertToYUV(const NvCVImage *src, int sx, int sy, unsigned width, unsigned height, const YUVPlanes &yuv,
+                  unsigned j0, unsigned j1, float scale) {
+  int sem[4], where[5] = {-1, -1, -1, -1, -1};
+  const int ns = FormatSemantics(src->pixelFormat, sem), sStep = ComponentStep(src);
+  for (int i = 0; i < ns; ++i) where[sem[i]] = i;
+  const int ri = where[SEM_R] >= 0 ? where[SEM_R] : where[SEM_Y];  // gray is replicated
+  const int gi = where[SEM_G] >= 0 ? where[SEM_G] : where[SEM_Y];
+  const int bi = where[SEM_B] >= 0 ? where[SEM_B] : where[SEM_Y];
+  const YUVCoefficients k = GetYUVCoefficients(yuv.colorspace);
+  const float yInv = 1.f / k.yGain, cInv = 1.f / k.cGain;
+  const float uk = .5f / (1.f - k.kb), vk = .5f / (1.f - k.kr);
+  const bool subX = NVCV_YUV444 != yuv.format, subY = NVCV_YUV420 == yuv.format;
+  const bool cositedX = ChromaCositedX(yuv.colorspace), cositedY = ChromaCositedY(yuv.colorspace);
+  const int w = (int)width, h = (int)height, cw = subX ? (w + 1) / 2 : w;
+  unsigned r0, r1;
+  ChromaSourceRows(yuv, height, j0, j1, &r0, &r1);
+  const unsigned lumaRow0 = subY ? 2 * j0 : j0;  // the first row of luma of the band; r0 may precede it
+  std::vector<float> uRows((size_t)cw * (r1 - r0)), vRows((size_t)cw * (r1 - r0));  // horizontally subsampled
+  std::vector<float> uFull((size_t)w), vFull((size_t)w);
+
+  for (int y = (int)r0; y < (int)r1; ++y) {
+    const unsigned char *r = ComponentPtr(src, (unsigned)ri, sx, sy + y);
+    const unsigned char *g = ComponentPtr(src, (unsigned)gi, sx, sy + y);
+    const unsigned char *b = ComponentPtr(src, (unsigned)bi, sx, sy + y);
+    unsigned char *yp = yuv.y + (ptrdiff_t)y * yuv.yPitch;
+    const bool writeLuma = (unsigned)y >= lumaRow0;
+    for (int x = 0; x < w; ++x, r += sStep, g += sStep, b += sStep, yp += yuv.yPixBytes) {
+      float R = (float)*(const S *)r * scale, G = (float)*(const S *)g * scale, B = (float)*(const S *)b * scale;
+      float Y = k.kr * R + k.kg * G + k.kb * B;
+      uFull[x] = (B - Y) * uk;
+      vFull[x] = (R - Y) * vk;
+      if (writeLuma) *yp = FromFloat<unsigned char>(Y * yInv + k.yBias);
+    }
+    float *ur = &uRows[(size_t)(y - (int)r0) * cw], *vr = &vRows[(size_t)(y - (int)r0) * cw];
+    for (int i = 0; i < cw; ++i) {
+      if (!subX) {
+        ur[i] = uFull[i];
+        vr[i] = vFull[i];
+      } else if (cositedX) {  // [1 2 1] / 4 about the even column
+        int l = std::max(2 * i - 1, 0), c = 2 * i, rr = std::min(2 * i + 1, w - 1);
+        ur[i] = .25f * (uFull[l] + 2.f * uFull[c] + uFull[rr]);
+        vr[i] = .25f * (vFull[l] + 2.f * vFull[c] + vFull[rr]);
+      } else {  // [1 1] / 2 about the midpoint
+        int c = 2 * i, rr = std::min(2 * i + 1, w - 1);
+        ur[i] = .5f * (uFull[c] + uFull[rr]);
+        vr[i] = .5f * (vFull[c] + vFull[rr]);
+      }
+    }
+  }
+
+  for (int j = (int)j0; j < (int)j1; ++j) {
+    int t = j, m = j, b = j;  // the rows above, at, and below the chroma sample
+    float w0 = 0.f, w1 = 1.f, w2 = 0.f;
+    if (subY && cositedY) {
+      t = std::max(2 * j - 1, 0), m = 2 * j, b = std::min(2 * j + 1, h - 1);
+      w0 = w2 = .25f, w1 = .5f;
+    } else if (subY) {
+      t = m = 2 * j, b = std::min(2 * j + 1, h - 1);
+      w0 = w1 = .25f, w2 = .5f;
+    }
+    const float *u0 = &uRows[(size_t)(t - (int)r0) * cw], *u1 = &uRows[(size_t)(m - (int)r0) * cw];
+    const float *u2 = &uRows[(size_t)(b - (int)r0) * cw], *v0 = &vRows[(size_t)(t - (int)r0) * cw];
+    const float *v1 = &vRows[(size_t)(m - (int)r0) * cw], *v2 = &vRows[(size_t)(b - (int)r0) * cw];
+    unsigned char *up = yuv.u + (ptrdiff_t)j * yuv.cPitch, *vp = yuv.v + (ptrdiff_t)j * yuv.cPitch;
+    for (int i = 0; i < cw; ++i, up += yuv.cPixBytes, vp += yuv.cPixBytes) {
+      *up = FromFloat<unsigned char>((w0 * u0[i] + w1 * u1[i] + w2 * u2[i]) * cInv + 128.f);
+      *vp = FromFloat<unsigned char>((w0 * v0[i] + w1 * v1[i] + w2 * v2[i]) * cInv + 128.f);
+    }
+  }
+}
+
+// Convert rows [y0, y1) from YUV, with the vector kernels if they accommodate the formats.
+void FromYUVRows(const YUVPlanes &yuv, NvCVImage *dst, int dx, int dy, unsigned width, unsigned height, unsigned y0,
+                 unsigned y1, float scale) {
+  if (TransferFromYUVSIMD(yuv, dst, dx, dy, width, height, y0, y1, scale)) return;
+  switch (dst->componentType) {
+    case NVCV_U8:  ConvertFromYUV<unsigned char>(yuv, dst, dx, dy, width, height, y0, y1, scale);  break;
+    case NVCV_U16: ConvertFromYUV<unsigned short>(yuv, dst, dx, dy, width, height, y0, y1, scale); break;
+    case NVCV_S16: ConvertFromYUV<short>(yuv, dst, dx, dy, width, height, y0, y1, scale);          break;
+    default:       ConvertFromYUV<float>(yuv, dst, dx, dy, width, height, y0, y1, scale);          break;
+  }
+}
+
+// Convert to chroma rows [j0, j1) of YUV, with the vector kernels if they accommodate the formats.
+void ToYUVRows(const NvCVImage *src, int sx, int sy, unsigned width, unsigned height, const YUVPlanes &yuv,
+               unsigned j0, unsigned j1, float scale) {
+  if (TransferToYUVSIMD(src, sx, sy, width, height, yuv, j0, j1, scale)) return;
+  switch (src->componentType) {
+    case NVCV_U8:  ConvertToYUV<unsigned char>(src, sx, sy, width, height, yuv, j0, j1, scale);  break;
+    case NVCV_U16: ConvertToYUV<unsigned short>(src, sx, sy, width, height, yuv, j0, j1, scale); break;
+    case NVCV_S16: ConvertToYUV<short>(src, sx, sy, width, height, yuv, j0, j1, scale);          break;
+    default:       ConvertToYUV<float>(src, sx, sy, width, height, yuv, j0, j1, scale);          break;
+  }
+}
+
+}  // namespace
+
+NvCV_Status NvCV_API NvCVImage_Init(NvCVImage *im, unsigned width, unsigned height, int pitch, void *pixels,
+                                    NvCVImage_PixelFormat format, NvCVImage_ComponentType type, unsigned layout,
+                                    unsigned memSpace) {
+  if (!im) return NVCV_ERR_PARAMETER;
+  if (!PixelGeometry(format, type, layout, &im->pixelBytes, &im->componentBytes, &im->numComponents))
+    return NVCV_ERR_PIXELFORMAT;
+  im->width = width;
+  im->height = height;
+  im->pitch = pitch;
+  im->pixelFormat = format;
+  im->componentType = type;
+  im->planar = (unsigned char)layout;
+  im->gpuMem = (unsigned char)memSpace;
+  im->colorspace = 0;
+  im->reserved[0] = im->reserved[1] = 0;
+  im->pixels = pixels;
+  im->deletePtr = nullptr;
+  im->deleteProc = nullptr;
+  im->bufferBytes = ImageBytes(im);
+  return NVCV_SUCCESS;
+}
+
+
+void NvCV_API NvCVImage_InitView(NvCVImage *subImg, NvCVImage *fullImg, int x, int y, unsigned width,
+                                 unsigned height) {
+  // As in the SDK, this is only meaningful for chunky images; the planes of a planar image are located by its height.
+  ptrdiff_t offset = (ptrdiff_t)y * fullImg->pitch + (ptrdiff_t)x * fullImg->pixelBytes;
+  subImg->width = width;
+  subImg->height = height;
+  subImg->pitch = fullImg->pitch;
+  subImg->pixelFormat = fullImg->pixelFormat;
+  subImg->componentType = fullImg->componentType;
+  subImg->pixelBytes = fullImg->pixelBytes;
+  subImg->componentBytes = fullImg->componentBytes;
+  subImg->numComponents = fullImg->numComponents;
+  subImg->planar = fullImg->planar;
+  subImg->gpuMem = fullImg->gpuMem;
+  subImg->colorspace = fullImg->colorspace;
+  subImg->reserved[0] = subImg->reserved[1] = 0;
+  subImg->pixels = fullImg->pixels ? (unsigned char *)fullImg->pixels + offset : nullptr;
+  subImg->deletePtr = nullptr;  // a view never owns its buffer
+  subImg->deleteProc = nullptr;
+  subImg->bufferBytes = (fullImg->bufferBytes > (unsigned long long)offset) ? fullImg->bufferBytes - offset : 0;
+}
+
+NvCV_Status NvCV_API NvCVImage_Alloc(NvCVImage *im, unsigned width, unsigned height, NvCVImage_PixelFormat format,
+                                     NvCVImage_ComponentType type, unsigned layout, unsigned memSpace,
+                                     unsigned alignment) {
+  NvCV_Status err;
+  if (!im) return NVCV_ERR_PARAMETER;
+  if (im->pixels) NvCVImage_Dealloc(im);  // the constructors clear pixels, so the other fields may be garbage
+  if (NVCV_SUCCESS != (err = NvCVImage_Init(im, width, height, 0, nullptr, format, type, layout, memSpace))) return err;
+
+  // The default alignment mimics the SDK: 4 bytes on the CPU, and a cudaMallocPitch()-like 256 bytes on the GPU.
+  if (0 == alignment) alignment = (NVCV_CPU == memSpace || NVCV_CPU_PINNED == memSpace) ? 4 : 256;
+  unsigned long long rowBytes = RowBytes(im, width);
+  im->pitch = (int)((rowBytes + alignment - 1) / alignment * alignment);
+  im->bufferBytes = ImageBytes(im);
+  if (!im->bufferBytes) return NVCV_SUCCESS;
+  if (nullptr == (im->pixels = AllocBytes(im->bufferBytes))) {
+    im->bufferBytes = 0;
+    return NVCV_ERR_MEMORY;
+  }
+  im->deletePtr = im->pixels;
+  im->deleteProc = FreeBytes;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_Realloc(NvCVImage *im, unsigned width, unsigned height, NvCVImage_PixelFormat format,
+                                       NvCVImage_ComponentType type, unsigned layout, unsigned memSpace,
+                                       unsigned alignment) {
+  NvCV_Status err;
+  NvCVImage probe;  // the geometry of the requested image, without a buffer
+  if (!im) return NVCV_ERR_PARAMETER;
+  if (NVCV_SUCCESS != (err = NvCVImage_Init(&probe, width, height, 0, nullptr, format, type, layout, memSpace)))
+    return err;
+  if (0 == alignment) alignment = (NVCV_CPU == memSpace || NVCV_CPU_PINNED == memSpace) ? 4 : 256;
+  unsigned long long rowBytes = RowBytes(&probe, width);
+  probe.pitch = (int)((rowBytes + alignment - 1) / alignment * alignment);
+  unsigned long long need = ImageBytes(&probe);
+
+  // Reuse the buffer if it is ours, in the same memory space, and large enough.
+  if (im->pixels && im->deletePtr == im->pixels && im->gpuMem == memSpace && im->bufferBytes >= need) {
+    void *buf = im->deletePtr;
+    void (*proc)(void *) = im->deleteProc;
+    unsigned long long capacity = im->bufferBytes;
+    NvCVImage_Init(im, width, height, probe.pitch, buf, format, type, layout, memSpace);
+    im->deletePtr = buf;
+    im->deleteProc = proc;
+    im->bufferBytes = capacity;
+    return NVCV_SUCCESS;
+  }
+  return NvCVImage_Alloc(im, width, height, format, type, layout, memSpace, alignment);
+}
+
+void NvCV_API NvCVImage_Dealloc(NvCVImage *im) {
+  if (!im) return;
+  if (im->deletePtr) {
+    if (im->deleteProc)
+      im->deleteProc(im->deletePtr);
+    else
+      std::free(im->deletePtr);
+  }
+  im->pixels = nullptr;
+  im->deletePtr = nullptr;
+  im->deleteProc = nullptr;
+  im->bufferBytes = 0;
+}
+
+void NvCV_API NvCVImage_DeallocAsync(NvCVImage *im, struct CUstream_st * /*stream*/) { NvCVImage_Dealloc(im); }
+
+NvCV_Status NvCV_API NvCVImage_Create(unsigned width, unsigned height, NvCVImage_PixelFormat format,
+                                      NvCVImage_ComponentType type, unsigned layout, unsigned memSpace,
+                                      unsigned alignment, NvCVImage **out) {
+  NvCV_Status err;
+  if (!out) return NVCV_ERR_PARAMETER;
+  *out = new NvCVImage;
+  if (NVCV_SUCCESS != (err = NvCVImage_Alloc(*out, width, height, format, type, layout, memSpace, alignment))) {
+    delete *out;
+    *out = nullptr;
+  }
+  return err;
+}
+
+void NvCV_API NvCVImage_Destroy(NvCVImage *im) { delete im; }
+
+void NvCV_API NvCVImage_ComponentOffsets(NvCVImage_PixelFormat format, int *rOff, int *gOff, int *bOff, int *aOff,
+                                         int *yOff) {
+  int sem[4], where[5] = {-1, -1, -1, -1, -1};
+  int n = FormatSemantics(format, sem);
+  for (int i = 0; i < n; ++i) where[sem[i]] = i;
+  if (IsYUV(format)) where[SEM_Y] = 0;
+  if (rOff) *rOff = where[SEM_R];
+  if (gOff) *gOff = where[SEM_G];
+  if (bOff) *bOff = where[SEM_B];
+  if (aOff) *aOff = where[SEM_A];
+  if (yOff) *yOff = where[SEM_Y];
+}
+
+NvCV_Status NvCV_API NvCVImage_Transfer(const NvCVImage *src, NvCVImage *dst, float scale,
+                                        struct CUstream_st *stream, NvCVImage *tmp) {
+  if (!src || !dst) return NVCV_ERR_PARAMETER;
+  if (src->width != dst->width || src->height != dst->height) return NVCV_ERR_MISMATCH;
+  if (IsYUV(src->pixelFormat) != IsYUV(dst->pixelFormat)) {  // the colorspace field describes the YUV image
+    const NvCVImage *im = IsYUV(src->pixelFormat) ? src : dst;
+    unsigned char *y, *u, *v;
+    int yPixBytes, cPixBytes, yPitch, cPitch;
+    NvCV_Status err = NvCVImage_GetYUVPointers(const_cast<NvCVImage *>(im), &y, &u, &v, &yPixBytes, &cPixBytes,
+                                               &yPitch, &cPitch);
+    if (NVCV_SUCCESS != err) return err;
+    if (im == src)
+      return NvCVImage_TransferFromYUV(y, yPixBytes, yPitch, u, v, cPixBytes, cPitch, im->pixelFormat,
+                                       im->componentType, im->colorspace, im->gpuMem, dst, nullptr, scale, stream,
+                                       tmp);
+    return NvCVImage_TransferToYUV(src, nullptr, y, yPixBytes, yPitch, u, v, cPixBytes, cPitch, im->pixelFormat,
+                                   im->componentType, im->colorspace, im->gpuMem, scale, stream, tmp);
+  }
+  return TransferRegion(src, 0, 0, dst, 0, 0, src->width, src->height, scale);
+}
+
+NvCV_Status NvCV_API NvCVImage_TransferRect(const NvCVImage *src, const NvCVRect2i *srcRect, NvCVImage *dst,
+                                            const NvCVPoint2i *dstPt, float scale, struct CUstream_st * /*stream*/,
+                                            NvCVImage * /*tmp*/) {
+  if (!src || !dst) return NVCV_ERR_PARAMETER;
+  NvCVRect2i r = srcRect ? *srcRect : NvCVRect2i{0, 0, (int)src->width, (int)src->height};
+  NvCVPoint2i d = dstPt ? *dstPt : NvCVPoint2i{0, 0};
+
+  // Clip to both the source and destination images.
+  if (r.x < 0) { r.width += r.x; d.x -= r.x; r.x = 0; }
+  if (r.y < 0) { r.height += r.y; d.y -= r.y; r.y = 0; }
+  if (d.x < 0) { r.width += d.x; r.x -= d.x; d.x = 0; }
+  if (d.y < 0) { r.height += d.y; r.y -= d.y; d.y = 0; }
+  if (r.width > (int)src->width - r.x) r.width = (int)src->width - r.x;
+  if (r.height > (int)src->height - r.y) r.height = (int)src->height - r.y;
+  if (r.width > (int)dst->width - d.x) r.width = (int)dst->width - d.x;
+  if (r.height > (int)dst->height - d.y) r.height = (int)dst->height - d.y;
+  if (r.width <= 0 || r.height <= 0) return NVCV_SUCCESS;
+  return TransferRegion(src, r.x, r.y, dst, d.x, d.y, (unsigned)r.width, (unsigned)r.height, scale);
+}
+
+NvCV_Status NvCV_API NvCVImage_TransferFromYUV(const void *y, int yPixBytes, int yPitch, const void *u, const void *v,
+                                               int uvPixBytes, int uvPitch, NvCVImage_PixelFormat yuvFormat,
+                                               NvCVImage_ComponentType yuvType, unsigned yuvColorSpace,
+                                               unsigned /*yuvMemSpace*/, NvCVImage *dst, const NvCVRect2i *dstRect,
+                                               float scale, struct CUstream_st * /*stream*/, NvCVImage * /*tmp*/) {
+  if (!y || !u || !v || !dst) return NVCV_ERR_PARAMETER;
+  if (!dst->pixels) return NVCV_ERR_BUFFER;
+  if (!IsYUV(yuvFormat) || NVCV_U8 != yuvType || IsYUV(dst->pixelFormat) || !IsSupportedType(dst->componentType))
+    return NVCV_ERR_PIXELFORMAT;
+  NvCVRect2i r = dstRect ? *dstRect : NvCVRect2i{0, 0, (int)dst->width, (int)dst->height};
+  if (r.x < 0 || r.y < 0 || r.width > (int)dst->width - r.x || r.height > (int)dst->height - r.y)
+    return NVCV_ERR_PARAMETER;
+  if (r.width <= 0 || r.height <= 0) return NVCV_SUCCESS;
+  YUVPlanes yuv = {(unsigned char *)y, (unsigned char *)u, (unsigned char *)v, yPixBytes, yPitch,
+                   uvPixBytes, uvPitch, yuvFormat, yuvColorSpace};
+  const unsigned w = (unsigned)r.width, h = (unsigned)r.height, bands = NumBands((size_t)w * h, h);
+  RowPool::Get().ParallelFor(bands, [&](unsigned b) {
+    FromYUVRows(yuv, dst, r.x, r.y, w, h, (unsigned)((size_t)h * b / bands), (unsigned)((size_t)h * (b + 1) / bands),
+                scale);
+  });
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_TransferToYUV(const NvCVImage *src, const NvCVRect2i *srcRect, const void *y,
+                                             int yPixBytes, int yPitch, const void *u, const void *v, int uvPixBytes,
+                                             int uvPitch, NvCVImage_PixelFormat yuvFormat,
+                                             NvCVImage_ComponentType yuvType, unsigned yuvColorSpace,
+                                             unsigned /*yuvMemSpace*/, float scale, struct CUstream_st * /*stream*/,
+                                             NvCVImage * /*tmp*/) {
+  if (!src || !y || !u || !v) return NVCV_ERR_PARAMETER;
+  if (!src->pixels) return NVCV_ERR_BUFFER;
+  if (!IsYUV(yuvFormat) || NVCV_U8 != yuvType || IsYUV(src->pixelFormat) || !IsSupportedType(src->componentType))
+    return NVCV_ERR_PIXELFORMAT;
+  NvCVRect2i r = srcRect ? *srcRect : NvCVRect2i{0, 0, (int)src->width, (int)src->height};
+  if (r.x < 0 || r.y < 0 || r.width > (int)src->width - r.x || r.height > (int)src->height - r.y)
+    return NVCV_ERR_PARAMETER;
+  if (r.width <= 0 || r.height <= 0) return NVCV_SUCCESS;
+  YUVPlanes yuv = {(unsigned char *)y, (unsigned char *)u, (unsigned char *)v, yPixBytes, yPitch,
+                   uvPixBytes, uvPitch, yuvFormat, yuvColorSpace};
+  const unsigned w = (unsigned)r.width, h = (unsigned)r.height;
+  const unsigned ch = (NVCV_YUV420 == yuvFormat) ? (h + 1) / 2 : h, bands = NumBands((size_t)w * h, ch);
+  RowPool::Get().ParallelFor(bands, [&](unsigned b) {  // bands of chroma rows, and the luma rows that they cover
+    ToYUVRows(src, r.x, r.y, w, h, yuv, (unsigned)((size_t)ch * b / bands), (unsigned)((size_t)ch * (b + 1) / bands),
+              scale);
+  });
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_MapResource(NvCVImage * /*im*/, struct CUstream_st * /*stream*/) {
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_UnmapResource(NvCVImage * /*im*/, struct CUstream_st * /*stream*/) {
+  return NVCV_SUCCESS;
+}
+
+#if RTX_CAMERA_IMAGE == 0
+NvCV_Status NvCV_API NvCVImage_Composite(const NvCVImage *fg, const NvCVImage *bg, const NvCVImage *mat,
+                                         NvCVImage *dst, struct CUstream_st * /*stream*/) {
+  return CompositeImages(fg, bg, nullptr, mat, dst);
+}
+#else   // RTX_CAMERA_IMAGE == 1
+NvCV_Status NvCV_API NvCVImage_Composite(const NvCVImage *fg, const NvCVImage *bg, const NvCVImage *mat,
+                                         NvCVImage *dst) {
+  return CompositeImages(fg, bg, nullptr, mat, dst);
+}
+#endif  // RTX_CAMERA_IMAGE
+
+// The rectangle is the size of the matte, clipped against all four images. As in the SDK, the images are windowed
+// with NvCVImage_InitView(), which is only meaningful for chunky pixels.
+NvCV_Status NvCV_API NvCVImage_CompositeRect(const NvCVImage *fg, const NvCVPoint2i *fgOrg, const NvCVImage *bg,
+                                             const NvCVPoint2i *bgOrg, const NvCVImage *mat, unsigned mode,
+                                             NvCVImage *dst, const NvCVPoint2i *dstOrg,
+                                             struct CUstream_st * /*stream*/) {
+  static const NvCVPoint2i origin = {0, 0};
+  if (!fg || !bg || !mat || !dst || mode > 1) return NVCV_ERR_PARAMETER;
+  if (NVCV_PLANAR == fg->planar || NVCV_PLANAR == bg->planar || NVCV_PLANAR == mat->planar ||
+      NVCV_PLANAR == dst->planar)
+    return NVCV_ERR_PIXELFORMAT;
+  if (!fgOrg) fgOrg = &origin;
+  if (!bgOrg) bgOrg = &origin;
+  if (!dstOrg) dstOrg = &origin;
+  const NvCVPoint2i *orgs[3] = {fgOrg, bgOrg, dstOrg};
+  const NvCVImage *ims[3] = {fg, bg, dst};
+  int x0 = 0, y0 = 0, x1 = (int)mat->width, y1 = (int)mat->height;  // In matte coordinates
+  for (int i = 0; i < 3; ++i) {
+    x0 = std::max(x0, -orgs[i]->x);
+    y0 = std::max(y0, -orgs[i]->y);
+    x1 = std::min(x1, (int)ims[i]->width - orgs[i]->x);
+    y1 = std::min(y1, (int)ims[i]->height - orgs[i]->y);
+  }
+  if (x1 <= x0 || y1 <= y0) return NVCV_SUCCESS;
+  const unsigned w = (unsigned)(x1 - x0), h = (unsigned)(y1 - y0);
+  NvCVImage f, b, m, d;
+  NvCVImage_InitView(&f, const_cast<NvCVImage *>(fg), fgOrg->x + x0, fgOrg->y + y0, w, h);
+  NvCVImage_InitView(&b, const_cast<NvCVImage *>(bg), bgOrg->x + x0, bgOrg->y + y0, w, h);
+  NvCVImage_InitView(&m, const_cast<NvCVImage *>(mat), x0, y0, w, h);
+  NvCVImage_InitView(&d, dst, dstOrg->x + x0, dstOrg->y + y0, w, h);
+  return CompositeImages(&f, &b, nullptr, &m, &d, 1 == mode);
+}
+
+#if RTX_CAMERA_IMAGE == 0
+NvCV_Status NvCV_API NvCVImage_CompositeOverConstant(const NvCVImage *src, const NvCVImage *mat, const void *bgColor,
+                                                     NvCVImage *dst, struct CUstream_st * /*stream*/) {
+  return CompositeImages(src, nullptr, bgColor, mat, dst);
+}
+#else   // RTX_CAMERA_IMAGE == 1
+NvCV_Status NvCV_API NvCVImage_CompositeOverConstant(const NvCVImage *src, const NvCVImage *mat,
+                                                     const unsigned char bgColor[3], NvCVImage *dst) {
+  return CompositeImages(src, nullptr, bgColor, mat, dst);
+}
+#endif  // RTX_CAMERA_IMAGE
+
+NvCV_Status NvCV_API NvCVImage_FlipY(const NvCVImage *src, NvCVImage *dst) {
+  if (!dst) return NVCV_ERR_PARAMETER;
+  if (!src) src = dst;
+  if (NVCV_PLANAR == src->planar || (IsYUV(src->pixelFormat) && src->pixelBytes == src->componentBytes))
+    return NVCV_ERR_PIXELFORMAT;
+  if (src != dst) {
+    NvCVImage_Dealloc(dst);
+    NvCVImage_InitView(dst, const_cast<NvCVImage *>(src), 0, 0, src->width, src->height);
+  }
+  if (dst->height) dst->pixels = (unsigned char *)dst->pixels + (ptrdiff_t)(dst->height - 1) * dst->pitch;
+  dst->pitch = -dst->pitch;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_GetYUVPointers(NvCVImage *im, unsigned char **y, unsigned char **u, unsigned char **v,
+                                              int *yPixBytes, int *cPixBytes, int *yRowBytes, int *cRowBytes) {
+  long long uOff, vOff;
+  int cPitch, cSpan;
+  if (!im) return NVCV_ERR_PARAMETER;
+  if (!IsYUV(im->pixelFormat)) return NVCV_ERR_PIXELFORMAT;
+  unsigned char *p = (unsigned char *)im->pixels;
+  YUVLayout(im->pixelFormat, im->planar, im->height, im->pitch, &uOff, &vOff, &cPitch, &cSpan);
+  if (0 == cSpan) {  // Chunky: the components are interleaved within each row
+    int yo = 0, uo = 0, vo = 0;
+    switch (im->planar) {
+      case NVCV_UYVY: yo = 1; uo = 0; vo = 2; break;
+      case NVCV_VYUY: yo = 1; uo = 2; vo = 0; break;
+      case NVCV_YUYV: yo = 0; uo = 1; vo = 3; break;
+      case NVCV_YVYU: yo = 0; uo = 3; vo = 1; break;
+      case NVCV_CYUV: yo = 0; uo = 1; vo = 2; break;
+      case NVCV_CYVU: yo = 0; uo = 2; vo = 1; break;
+    }
+    int cb = im->componentBytes, chunk = (NVCV_YUV444 == im->pixelFormat) ? 3 * cb : 4 * cb;
+    if (y) *y = p + yo * cb;
+    if (u) *u = p + uo * cb;
+    if (v) *v = p + vo * cb;
+    if (yPixBytes) *yPixBytes = (NVCV_YUV444 == im->pixelFormat) ? chunk : 2 * cb;
+    if (cPixBytes) *cPixBytes = chunk;
+  } else {
+    if (y) *y = p;
+    if (u) *u = p + uOff;
+    if (v) *v = p + vOff;
+    if (yPixBytes) *yPixBytes = im->componentBytes;
+    if (cPixBytes) *cPixBytes = cSpan * im->componentBytes;
+  }
+  if (yRowBytes) *yRowBytes = im->pitch;
+  if (cRowBytes) *cRowBytes = cPitch;
+  return NVCV_SUCCESS;
+}
+
+NvCV_Status NvCV_API NvCVImage_Sharpen(float sharpness, const NvCVImage *src, NvCVImage *dst,
+                                       struct CUstream_st * /*stream*/, NvCVImage * /*tmp*/) {
+  if (!src || !dst) return NVCV_ERR_PARAMETER;
+  if (!src->pixels || !dst->pixels) return NVCV_ERR_BUFFER;
+  if (src == dst || src->pixels == dst->pixels) return NVCV_ERR_PARAMETER;  // not in place
+  if (src->width != dst->width || src->height != dst->height || src->pixelFormat != dst->pixelFormat ||
+      src->componentType != dst->componentType || src->planar != dst->planar)
+    return NVCV_ERR_MISMATCH;
+  if (IsYUV(src->pixelFormat)) return NVCV_ERR_PIXELFORMAT;
+  switch (src->componentType) {
+    case NVCV_U8:  SharpenImage<unsigned char>(sharpness, src, dst);  break;
+    case NVCV_U16: SharpenImage<unsigned short>(sharpness, src, dst); break;
+    case NVCV_F32: SharpenImage<float>(sharpness, src, dst);          break;
+    default:       return NVCV_ERR_PIXELFORMAT;
+  }
+  return NVCV_SUCCESS;
+}
+
+#ifdef _WIN32
+__declspec(dllexport) const char* __cdecl
+#else
+const char*
+#endif  // _WIN32 or linux
+    NvCV_GetErrorStringFromCode(NvCV_Status code) {
+  switch (code) {
+    case NVCV_SUCCESS:                  return "The procedure returned successfully";
+    case NVCV_ERR_GENERAL:              return "An otherwise unspecified error has occurred";
+    case NVCV_ERR_UNIMPLEMENTED:        return "The requested feature is not yet implemented";
+    case NVCV_ERR_MEMORY:               return "There is not enough memory for the requested operation";
+    case NVCV_ERR_EFFECT:               return "An invalid effect handle has been supplied";
+    case NVCV_ERR_SELECTOR:             return "The given parameter selector is not valid in this effect filter";
+    case NVCV_ERR_BUFFER:               return "An image buffer has not been specified";
+    case NVCV_ERR_PARAMETER:            return "An invalid parameter value has been supplied for this effect+selector";
+    case NVCV_ERR_MISMATCH:             return "Some parameters are not appropriately matched";
+    case NVCV_ERR_PIXELFORMAT:          return "The specified pixel format is not accommodated";
+    case NVCV_ERR_MODEL:                return "Error while loading the TRT model";
+    case NVCV_ERR_LIBRARY:              return "Error loading the dynamic library";
+    case NVCV_ERR_INITIALIZATION:       return "The effect has not been properly initialized";
+    case NVCV_ERR_FILE:                 return "The file could not be found";
+    case NVCV_ERR_FEATURENOTFOUND:      return "The requested feature was not found";
+    case NVCV_ERR_MISSINGINPUT:         return "A required parameter was not set";
+    case NVCV_ERR_RESOLUTION:           return "The specified image resolution is not supported";
+    case NVCV_ERR_UNSUPPORTEDGPU:       return "The GPU is not supported";
+    case NVCV_ERR_WRONGGPU:             return "The current GPU is not the one selected";
+    case NVCV_ERR_UNSUPPORTEDDRIVER:    return "The currently installed graphics driver is not supported";
+    case NVCV_ERR_MODELDEPENDENCIES:    return "There is no model with dependencies that match this system";
+    case NVCV_ERR_PARSE:                return "There has been a parsing or syntax error while reading a file";
+    case NVCV_ERR_MODELSUBSTITUTION:    return "The specified model does not exist and has been substituted";
+    case NVCV_ERR_READ:                 return "An error occurred while reading a file";
+    case NVCV_ERR_WRITE:                return "An error occurred while writing a file";
+    case NVCV_ERR_PARAMREADONLY:        return "The selected parameter is read-only";
+    case NVCV_ERR_TOOSMALL:             return "A supplied parameter or buffer is not large enough";
+    case NVCV_ERR_TOOBIG:               return "A supplied parameter is too big";
+    case NVCV_ERR_WRONGSIZE:            return "A supplied parameter is not the expected size";
+    case NVCV_ERR_OBJECTNOTFOUND:       return "The specified object was not found";
+    case NVCV_ERR_CUDA:                 return "An otherwise unspecified CUDA error has been reported";
+    default:                            return "An error has occurred in the reference implementation";
+  }
+}
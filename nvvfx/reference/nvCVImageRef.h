@@ -0,0 +1,151 @@
+/*###############################################################################
+#
+# Copyright 2020-2021 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __NVCVIMAGEREF_H__
+#define __NVCVIMAGEREF_H__
+
+// Internals shared by the translation units of the reference NvCVImage library.
+
+#include <cstddef>
+
+#include "nvCVImage.h"
+
+// Pointer to component c of pixel (x, y); both chunky and planar layouts are accommodated, as are negative pitches.
+inline unsigned char *ComponentPtr(const NvCVImage *im, unsigned c, int x, int y) {
+  unsigned char *p = (unsigned char *)im->pixels;
+  if (NVCV_PLANAR == im->planar)
+    return p + ((ptrdiff_t)c * im->height + y) * im->pitch + (ptrdiff_t)x * im->componentBytes;
+  return p + (ptrdiff_t)y * im->pitch + (ptrdiff_t)x * im->pixelBytes + (ptrdiff_t)c * im->componentBytes;
+}
+
+inline int ComponentStep(const NvCVImage *im) {
+  return (NVCV_PLANAR == im->planar) ? im->componentBytes : im->pixelBytes;
+}
+
+enum Semantic { SEM_R, SEM_G, SEM_B, SEM_A, SEM_Y };
+
+// The meaning of each component of a (non-YUV) pixel format, in memory order. Returns the number of components.
+inline int FormatSemantics(NvCVImage_PixelFormat format, int sem[4]) {
+  switch (format) {
+    case NVCV_Y:    sem[0] = SEM_Y;                                                         return 1;
+    case NVCV_A:    sem[0] = SEM_A;                                                         return 1;
+    case NVCV_YA:   sem[0] = SEM_Y; sem[1] = SEM_A;                                         return 2;
+    case NVCV_RGB:  sem[0] = SEM_R; sem[1] = SEM_G; sem[2] = SEM_B;                         return 3;
+    case NVCV_BGR:  sem[0] = SEM_B; sem[1] = SEM_G; sem[2] = SEM_R;                         return 3;
+    case NVCV_RGBA: sem[0] = SEM_R; sem[1] = SEM_G; sem[2] = SEM_B; sem[3] = SEM_A;         return 4;
+    case NVCV_BGRA: sem[0] = SEM_B; sem[1] = SEM_G; sem[2] = SEM_R; sem[3] = SEM_A;         return 4;
+    case NVCV_ARGB: sem[0] = SEM_A; sem[1] = SEM_R; sem[2] = SEM_G; sem[3] = SEM_B;         return 4;
+    case NVCV_ABGR: sem[0] = SEM_A; sem[1] = SEM_B; sem[2] = SEM_G; sem[3] = SEM_R;         return 4;
+    default:                                                                                return 0;
+  }
+}
+
+// How each destination component of a transfer is computed from the source components.
+enum { MAP_COPY, MAP_LUMA, MAP_OPAQUE, MAP_ZERO };
+struct ComponentMap {
+  int op;
+  int src[3];  // component indices: src[0] for MAP_COPY, { r, g, b } for MAP_LUMA
+};
+
+// Convert as many leading columns of the region as the vector kernels accommodate, bit-exactly as the scalar code
+// would, and return how many that was; the caller converts the rest. Zero is returned for combinations of formats
+// that have no vector kernel, and when NVCV_REF_ISA=scalar.
+unsigned TransferColumnsSIMD(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                             unsigned height, const ComponentMap *map, int nd, float scale);
+
+// The planes of a YUV image, as described to NvCVImage_TransferFromYUV() and NvCVImage_TransferToYUV().
+struct YUVPlanes {
+  unsigned char *y, *u, *v;
+  int yPixBytes, yPitch, cPixBytes, cPitch;
+  NvCVImage_PixelFormat format;
+  unsigned colorspace;
+};
+
+// The luma weights of the Rec.601, 709 or 2020 axes, and the mapping of the stored range to [0, 255]:
+// Y = (y - yBias) * yGain, C = (c - 128) * cGain.
+struct YUVCoefficients {
+  float kr, kg, kb;
+  float yBias, yGain, cGain;
+};
+
+inline YUVCoefficients GetYUVCoefficients(unsigned colorspace) {
+  YUVCoefficients k;
+  switch (colorspace & (NVCV_709 | NVCV_2020)) {
+    case NVCV_709:  k.kr = .2126f; k.kb = .0722f; break;
+    case NVCV_2020: k.kr = .2627f; k.kb = .0593f; break;
+    default:        k.kr = .299f;  k.kb = .114f;  break;
+  }
+  k.kg = 1.f - k.kr - k.kb;
+  if (colorspace & NVCV_FULL_RANGE) {
+    k.yBias = 0.f;
+    k.yGain = k.cGain = 1.f;
+  } else {
+    k.yBias = 16.f;
+    k.yGain = 255.f / 219.f;
+    k.cGain = 255.f / 224.f;
+  }
+  return k;
+}
+
+// MPEG-2 chroma sits on the even luma columns, between the luma rows; MPEG-1 chroma sits between both.
+inline bool ChromaCositedX(unsigned colorspace) {
+  return NVCV_CHROMA_INTSTITIAL != (colorspace & (NVCV_CHROMA_INTSTITIAL | NVCV_CHROMA_TOPLEFT));
+}
+inline bool ChromaCositedY(unsigned colorspace) {
+  return NVCV_CHROMA_TOPLEFT == (colorspace & (NVCV_CHROMA_INTSTITIAL | NVCV_CHROMA_TOPLEFT));
+}
+
+// The chroma samples i0 and i1, of n, that are blended as (1 - w) * c[i0] + w * c[i1] at luma position x.
+inline void ChromaTaps(int x, int n, bool cosited, int *i0, int *i1, float *w) {
+  *i0 = x >> 1;
+  if (cosited) {
+    *i1 = (x & 1) ? (*i0 + 1 < n ? *i0 + 1 : n - 1) : *i0;
+    *w = (x & 1) ? .5f : 0.f;
+  } else {
+    *i1 = (x & 1) ? (*i0 + 1 < n ? *i0 + 1 : n - 1) : (*i0 > 0 ? *i0 - 1 : 0);
+    *w = .25f;
+  }
+}
+
+// The rows of luma that contribute to chroma rows [j0, j1) of an image of the given height: 4:2:0 chroma is filtered
+// vertically from rows 2j and 2j + 1, and also 2j - 1 if cosited.
+inline void ChromaSourceRows(const YUVPlanes &yuv, unsigned height, unsigned j0, unsigned j1, unsigned *r0,
+                             unsigned *r1) {
+  if (NVCV_YUV420 != yuv.format) {
+    *r0 = j0;
+    *r1 = j1;
+  } else {
+    *r0 = (ChromaCositedY(yuv.colorspace) && j0) ? 2 * j0 - 1 : 2 * j0;
+    *r1 = (2 * j1 < height) ? 2 * j1 : height;
+  }
+}
+
+// Convert rows [y0, y1) of a width x height YUV image to dst at (dx, dy), or convert rows [r0, r1) of src at
+// (sx, sy) to chroma rows [j0, j1) of YUV (see ChromaSourceRows), bit-exactly as the scalar code would. False is
+// returned for combinations of formats that have no vector kernel, and when NVCV_REF_ISA is not avx2.
+bool TransferFromYUVSIMD(const YUVPlanes &yuv, NvCVImage *dst, int dx, int dy, unsigned width, unsigned height,
+                         unsigned y0, unsigned y1, float scale);
+bool TransferToYUVSIMD(const NvCVImage *src, int sx, int sy, unsigned width, unsigned height, const YUVPlanes &yuv,
+                       unsigned j0, unsigned j1, float scale);
+
+#endif  // __NVCVIMAGEREF_H__
@@ -0,0 +1,714 @@
+/*###############################################################################
+#
+# Copyright 2020-2021 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// SSE4.1 and AVX2 kernels for NvCVImage_Transfer() between u8 and f32 images with 1 to 4 components, chunky or
+// planar (f32 planar only), with any component order, alpha insertion or removal, and a scale factor. This covers
+// the BGR u8 chunky <--> BGR f32 planar conversions on either side of most effects. The instruction set is chosen at
+// run time, and may be capped with NVCV_REF_ISA=scalar, sse4.1 or avx2, e.g. to compare against the scalar code.
+//
+// Each block of 8 pixels is widened to float, multiplied by the scale, then clamped and rounded as floor(v + 0.5)
+// for u8, which is exactly the sequence of single precision operations of the scalar code, so the results are
+// bit-identical.
+//
+// AVX2 kernels also convert between u8 YUV 4:2:0, 4:2:2 and 4:4:4 (planar, semi-planar or chunky, in any of the
+// colorspaces and chroma sitings) and the same RGB-family images, bit-identically to ConvertFromYUV() and
+// ConvertToYUV(). They are specialized at compile time for the subsampling, the siting and the byte strides of the
+// YUV planes, and for the type and layout of the RGB image; the colorspace only changes the coefficients.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "nvCVImageRef.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NVCVREF_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif  // _MSC_VER
+#endif  // x86
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NVCVREF_TARGET(isa) __attribute__((target(isa)))
+#else  // MSVC compiles any intrinsic without a target option
+#define NVCVREF_TARGET(isa)
+#endif  // __GNUC__ || __clang__
+
+namespace {
+
+enum Isa { ISA_SCALAR, ISA_SSE41, ISA_AVX2 };
+
+Isa DetectIsa() {
+  Isa isa = ISA_SCALAR;
+#ifdef NVCVREF_X86
+  bool sse41, avx2 = false;
+#if defined(_MSC_VER) && !defined(__clang__)
+  int r[4];
+  __cpuid(r, 1);
+  sse41 = 0 != (r[2] & (1 << 19));
+  if ((r[2] & (1 << 27)) && (r[2] & (1 << 28)) && 6 == (_xgetbv(0) & 6)) {  // OSXSAVE, AVX, and YMM state enabled
+    __cpuidex(r, 7, 0);
+    avx2 = 0 != (r[1] & (1 << 5));
+  }
+#else   // GCC or clang
+  __builtin_cpu_init();
+  sse41 = __builtin_cpu_supports("sse4.1");
+  avx2 = __builtin_cpu_supports("avx2");
+#endif  // _MSC_VER
+  isa = avx2 ? ISA_AVX2 : sse41 ? ISA_SSE41 : ISA_SCALAR;
+#endif  // NVCVREF_X86
+  const char *cap = getenv("NVCV_REF_ISA");
+  if (cap) {
+    if (!strcmp(cap, "scalar"))
+      isa = ISA_SCALAR;
+    else if (!strcmp(cap, "sse4.1") && isa > ISA_SSE41)
+      isa = ISA_SSE41;
+  }
+  return isa;
+}
+
+Isa CurrentIsa() {
+  static const Isa isa = DetectIsa();
+  return isa;
+}
+
+// Everything about a transfer that is the same for every block of pixels.
+struct Plan {
+  int nc, nd;                  // the number of source and destination components
+  bool srcU8, dstU8;           // otherwise f32
+  bool srcChunky, dstChunky;   // otherwise planar
+  int srcComp[4];              // the source of each destination component, or -1 for a constant
+  float constant[4];           // the value of a constant destination component, in destination units
+  float scale;
+  int hiOffset;                // the byte offset of the second load of a block of chunky source pixels
+  unsigned char deinterleave[4][2][16];  // per source component, shuffles of the two loads of a chunky block
+  unsigned char interleave[2][2][16];    // per 16 bytes of a chunky destination block, shuffles of { 0, 1 }, { 2, 3 }
+};
+
+// The byte shuffles of chunky blocks of 8 pixels, of nc source and nd destination components.
+void MakeShuffles(int nc, int nd, Plan *plan) {
+  // A chunky block of 8 pixels is loaded as bytes [0, 16) and [hiOffset, hiOffset + 16), without reading past it.
+  int blockBytes = 8 * nc;
+  plan->nc = nc;
+  plan->nd = nd;
+  plan->hiOffset = (blockBytes > 16) ? blockBytes - 16 : 0;
+  for (int c = 0; c < nc; ++c) {
+    memset(plan->deinterleave[c], 0x80, sizeof(plan->deinterleave[c]));
+    for (int i = 0; i < 8; ++i) {
+      int o = i * nc + c;
+      if (o < 16)
+        plan->deinterleave[c][0][i] = (unsigned char)o;
+      else
+        plan->deinterleave[c][1][i] = (unsigned char)(o - plan->hiOffset);
+    }
+  }
+  memset(plan->interleave, 0x80, sizeof(plan->interleave));
+  for (int j = 0; j < 8 * nd; ++j) {
+    int i = j / nd, k = j % nd;
+    plan->interleave[j / 16][k / 2][j % 16] = (unsigned char)((k % 2) * 8 + i);
+  }
+}
+
+bool MakePlan(const NvCVImage *src, const NvCVImage *dst, const ComponentMap *map, int nd, float scale, Plan *plan) {
+  if ((NVCV_U8 != src->componentType && NVCV_F32 != src->componentType) ||
+      (NVCV_U8 != dst->componentType && NVCV_F32 != dst->componentType))
+    return false;
+  plan->nc = src->numComponents;
+  plan->nd = nd;
+  plan->srcU8 = NVCV_U8 == src->componentType;
+  plan->dstU8 = NVCV_U8 == dst->componentType;
+  plan->srcChunky = NVCV_PLANAR != src->planar;
+  plan->dstChunky = NVCV_PLANAR != dst->planar;
+  if (plan->nc < 1 || plan->nc > 4 || nd < 1 || nd > 4) return false;
+  if ((plan->srcChunky && !plan->srcU8) || (plan->dstChunky && !plan->dstU8)) return false;  // chunky f32
+  for (int k = 0; k < nd; ++k) {
+    switch (map[k].op) {
+      case MAP_COPY:   plan->srcComp[k] = map[k].src[0]; plan->constant[k] = 0.f;                     break;
+      case MAP_OPAQUE: plan->srcComp[k] = -1;            plan->constant[k] = plan->dstU8 ? 255.f : 1.f; break;
+      case MAP_ZERO:   plan->srcComp[k] = -1;            plan->constant[k] = 0.f;                     break;
+      default:         return false;  // luma stays scalar, to keep the order of its arithmetic
+    }
+  }
+  plan->scale = scale;
+  MakeShuffles(plan->nc, nd, plan);
+  return true;
+}
+
+#ifdef NVCVREF_X86
+
+// 8 source pixels of component c, as bytes 0-7.
+NVCVREF_TARGET("sse4.1")
+inline __m128i LoadBytes(const Plan &plan, const unsigned char *const *sp, unsigned b, int c, __m128i lo, __m128i hi) {
+  if (!plan.srcChunky) return _mm_loadl_epi64((const __m128i *)(sp[c] + 8 * b));
+  return _mm_or_si128(_mm_shuffle_epi8(lo, _mm_loadu_si128((const __m128i *)plan.deinterleave[c][0])),
+                      _mm_shuffle_epi8(hi, _mm_loadu_si128((const __m128i *)plan.deinterleave[c][1])));
+}
+
+// The two loads of a block of chunky u8 source pixels.
+NVCVREF_TARGET("sse4.1")
+inline void LoadChunky(const Plan &plan, const unsigned char *p, __m128i *lo, __m128i *hi) {
+  *lo = (1 == plan.nc) ? _mm_loadl_epi64((const __m128i *)p) : _mm_loadu_si128((const __m128i *)p);
+  *hi = plan.hiOffset ? _mm_loadu_si128((const __m128i *)(p + plan.hiOffset)) : _mm_setzero_si128();
+}
+
+// Clamp, round and narrow 8 values to bytes 0-7.
+NVCVREF_TARGET("sse4.1")
+inline __m128i ToBytes(__m128 v0, __m128 v1) {
+  const __m128 zero = _mm_setzero_ps(), max = _mm_set1_ps(255.f), half = _mm_set1_ps(.5f);
+  v0 = _mm_floor_ps(_mm_add_ps(_mm_min_ps(_mm_max_ps(v0, zero), max), half));
+  v1 = _mm_floor_ps(_mm_add_ps(_mm_min_ps(_mm_max_ps(v1, zero), max), half));
+  __m128i w = _mm_packus_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1));
+  return _mm_packus_epi16(w, w);
+}
+
+// Interleave the bytes of nd components, and store 8 chunky destination pixels.
+NVCVREF_TARGET("sse4.1")
+inline void StoreChunky(const Plan &plan, unsigned char *p, const __m128i *bytes) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i r01 = _mm_unpacklo_epi64(bytes[0], plan.nd > 1 ? bytes[1] : zero);
+  __m128i r23 = _mm_unpacklo_epi64(plan.nd > 2 ? bytes[2] : zero, plan.nd > 3 ? bytes[3] : zero);
+  __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(r01, _mm_loadu_si128((const __m128i *)plan.interleave[0][0])),
+                              _mm_shuffle_epi8(r23, _mm_loadu_si128((const __m128i *)plan.interleave[0][1])));
+  switch (plan.nd) {
+    case 1: _mm_storel_epi64((__m128i *)p, out0); return;
+    case 2: _mm_storeu_si128((__m128i *)p, out0); return;
+  }
+  __m128i out1 = _mm_or_si128(_mm_shuffle_epi8(r01, _mm_loadu_si128((const __m128i *)plan.interleave[1][0])),
+                              _mm_shuffle_epi8(r23, _mm_loadu_si128((const __m128i *)plan.interleave[1][1])));
+  _mm_storeu_si128((__m128i *)p, out0);
+  if (3 == plan.nd)
+    _mm_storel_epi64((__m128i *)(p + 16), out1);
+  else
+    _mm_storeu_si128((__m128i *)(p + 16), out1);
+}
+
+NVCVREF_TARGET("sse4.1")
+void TransferRowsSSE41(const Plan &plan, const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy,
+                       unsigned blocks, unsigned height) {
+  const __m128 scale = _mm_set1_ps(plan.scale);
+  for (unsigned y = 0; y < height; ++y) {
+    const unsigned char *sp[4];
+    unsigned char *dp[4];
+    for (int c = 0; c < plan.nc; ++c) sp[c] = ComponentPtr(src, (unsigned)c, sx, sy + (int)y);
+    for (int k = 0; k < plan.nd; ++k) dp[k] = ComponentPtr(dst, (unsigned)k, dx, dy + (int)y);
+    for (unsigned b = 0; b < blocks; ++b) {
+      __m128 f[4][2];
+      __m128i lo = _mm_setzero_si128(), hi = lo, bytes[4];
+      if (plan.srcChunky) LoadChunky(plan, sp[0] + 8 * plan.nc * b, &lo, &hi);
+      for (int c = 0; c < plan.nc; ++c) {
+        if (plan.srcU8) {
+          __m128i v = LoadBytes(plan, sp, b, c, lo, hi);
+          f[c][0] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+          f[c][1] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+        } else {
+          f[c][0] = _mm_loadu_ps((const float *)(sp[c] + 32 * b));
+          f[c][1] = _mm_loadu_ps((const float *)(sp[c] + 32 * b + 16));
+        }
+        f[c][0] = _mm_mul_ps(f[c][0], scale);
+        f[c][1] = _mm_mul_ps(f[c][1], scale);
+      }
+      for (int k = 0; k < plan.nd; ++k) {
+        int c = plan.srcComp[k];
+        __m128 v0 = (c >= 0) ? f[c][0] : _mm_set1_ps(plan.constant[k]);
+        __m128 v1 = (c >= 0) ? f[c][1] : v0;
+        if (!plan.dstU8) {
+          _mm_storeu_ps((float *)(dp[k] + 32 * b), v0);
+          _mm_storeu_ps((float *)(dp[k] + 32 * b + 16), v1);
+        } else {
+          bytes[k] = ToBytes(v0, v1);
+          if (!plan.dstChunky) _mm_storel_epi64((__m128i *)(dp[k] + 8 * b), bytes[k]);
+        }
+      }
+      if (plan.dstU8 && plan.dstChunky) StoreChunky(plan, dp[0] + 8 * plan.nd * b, bytes);
+    }
+  }
+}
+
+// Clamp, round and narrow 8 values to bytes 0-7.
+NVCVREF_TARGET("avx2")
+inline __m128i ToBytes8(__m256 v) {
+  const __m256 zero = _mm256_setzero_ps(), max = _mm256_set1_ps(255.f), half = _mm256_set1_ps(.5f);
+  __m256i i = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(v, zero), max), half)));
+  __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+  return _mm_packus_epi16(w, w);
+}
+
+NVCVREF_TARGET("avx2")
+void TransferRowsAVX2(const Plan &plan, const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy,
+                      unsigned blocks, unsigned height) {
+  const __m256 scale = _mm256_set1_ps(plan.scale);
+  for (unsigned y = 0; y < height; ++y) {
+    const unsigned char *sp[4];
+    unsigned char *dp[4];
+    for (int c = 0; c < plan.nc; ++c) sp[c] = ComponentPtr(src, (unsigned)c, sx, sy + (int)y);
+    for (int k = 0; k < plan.nd; ++k) dp[k] = ComponentPtr(dst, (unsigned)k, dx, dy + (int)y);
+    for (unsigned b = 0; b < blocks; ++b) {
+      __m256 f[4];
+      __m128i lo = _mm_setzero_si128(), hi = lo, bytes[4];
+      if (plan.srcChunky) LoadChunky(plan, sp[0] + 8 * plan.nc * b, &lo, &hi);
+      for (int c = 0; c < plan.nc; ++c) {
+        if (plan.srcU8)
+          f[c] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(LoadBytes(plan, sp, b, c, lo, hi)));
+        else
+          f[c] = _mm256_loadu_ps((const float *)(sp[c] + 32 * b));
+        f[c] = _mm256_mul_ps(f[c], scale);
+      }
+      for (int k = 0; k < plan.nd; ++k) {
+        int c = plan.srcComp[k];
+        __m256 v = (c >= 0) ? f[c] : _mm256_set1_ps(plan.constant[k]);
+        if (!plan.dstU8) {
+          _mm256_storeu_ps((float *)(dp[k] + 32 * b), v);
+          continue;
+        }
+        bytes[k] = ToBytes8(v);
+        if (!plan.dstChunky) _mm_storel_epi64((__m128i *)(dp[k] + 8 * b), bytes[k]);
+      }
+      if (plan.dstU8 && plan.dstChunky) StoreChunky(plan, dp[0] + 8 * plan.nd * b, bytes);
+    }
+  }
+}
+
+
+// 8 bytes, widened to float.
+NVCVREF_TARGET("avx2")
+inline __m256 LoadFloats8(const unsigned char *p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+// The even and the odd elements of { a, b }.
+NVCVREF_TARGET("avx2")
+inline __m256 Evens(__m256 a, __m256 b) {
+  __m256d e = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+  return _mm256_castpd_ps(_mm256_permute4x64_pd(e, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+NVCVREF_TARGET("avx2")
+inline __m256 Odds(__m256 a, __m256 b) {
+  __m256d o = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm256_castpd_ps(_mm256_permute4x64_pd(o, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// Every kStep-th byte of a YUV row, to or from consecutive bytes.
+template <int kStep>
+inline void GatherBytes(const unsigned char *p, unsigned char *out, int n) {
+  for (int i = 0; i < n; ++i) out[i] = p[(ptrdiff_t)i * kStep];
+}
+template <int kStep>
+inline void ScatterBytes(const unsigned char *in, unsigned char *p, int n) {
+  for (int i = 0; i < n; ++i) p[(ptrdiff_t)i * kStep] = in[i];
+}
+
+// Stores 8 pixels, given as { R, G, B, A, Y } (see Semantic), at column x of a row of a u8 or f32 RGB-family image;
+// only the first n are stored at the end of a row.
+template <bool kU8, bool kChunky>
+struct PixelStore {
+  Plan shuffles;
+  int nd, sem[4];
+  unsigned char *rows[4];
+
+  explicit PixelStore(const NvCVImage *im) {
+    nd = FormatSemantics(im->pixelFormat, sem);
+    MakeShuffles(1, nd, &shuffles);
+  }
+  void Row(NvCVImage *im, int x, int y) {
+    for (int k = 0; k < nd; ++k) rows[k] = ComponentPtr(im, (unsigned)k, x, y);
+  }
+  NVCVREF_TARGET("avx2") void operator()(int x, int n, const __m256 *v) const {
+    if constexpr (kU8 && kChunky) {
+      __m128i bytes[4];
+      unsigned char tmp[32];
+      for (int k = 0; k < nd; ++k) bytes[k] = ToBytes8(v[sem[k]]);
+      if (8 == n) return StoreChunky(shuffles, rows[0] + (ptrdiff_t)x * nd, bytes);
+      StoreChunky(shuffles, tmp, bytes);
+      memcpy(rows[0] + (ptrdiff_t)x * nd, tmp, (size_t)n * nd);
+    } else if constexpr (kU8) {
+      unsigned char tmp[16];
+      for (int k = 0; k < nd; ++k) {
+        __m128i bytes = ToBytes8(v[sem[k]]);
+        if (8 == n) {
+          _mm_storel_epi64((__m128i *)(rows[k] + x), bytes);
+        } else {
+          _mm_storeu_si128((__m128i *)tmp, bytes);
+          memcpy(rows[k] + x, tmp, (size_t)n);
+        }
+      }
+    } else if constexpr (!kChunky) {
+      float tmp[8];
+      for (int k = 0; k < nd; ++k) {
+        if (8 == n) {
+          _mm256_storeu_ps((float *)rows[k] + x, v[sem[k]]);
+        } else {
+          _mm256_storeu_ps(tmp, v[sem[k]]);
+          memcpy((float *)rows[k] + x, tmp, (size_t)n * sizeof(float));
+        }
+      }
+    } else {
+      float tmp[4][8], *p = (float *)rows[0] + (ptrdiff_t)x * nd;
+      for (int k = 0; k < nd; ++k) _mm256_storeu_ps(tmp[k], v[sem[k]]);
+      for (int i = 0; i < n; ++i)
+        for (int k = 0; k < nd; ++k) *p++ = tmp[k][i];
+    }
+  }
+};
+
+// Loads the R, G and B of 8 pixels at column x of a row of a u8 or f32 RGB-family image; gray is replicated. Only
+// the first n are read at the end of a row.
+template <bool kU8, bool kChunky>
+struct PixelLoad {
+  Plan shuffles;
+  int nc, comp[3];
+  const unsigned char *rows[4];
+
+  explicit PixelLoad(const NvCVImage *im) {
+    int sem[4], where[5] = {-1, -1, -1, -1, -1};
+    nc = FormatSemantics(im->pixelFormat, sem);
+    for (int i = 0; i < nc; ++i) where[sem[i]] = i;
+    for (int i = 0; i < 3; ++i) comp[i] = where[i] >= 0 ? where[i] : where[SEM_Y];
+    MakeShuffles(nc, 1, &shuffles);
+    shuffles.srcChunky = kChunky;
+  }
+  bool Valid() const { return comp[0] >= 0 && comp[1] >= 0 && comp[2] >= 0; }
+  void Row(const NvCVImage *im, int x, int y) {
+    for (int c = 0; c < nc; ++c) rows[c] = ComponentPtr(im, (unsigned)c, x, y);
+  }
+  NVCVREF_TARGET("avx2") void operator()(int x, int n, __m256 *rgb) const {
+    if constexpr (kU8 && kChunky) {
+      unsigned char tmp[32] = {0};
+      const unsigned char *p = rows[0] + (ptrdiff_t)x * nc;
+      if (n < 8) p = (const unsigned char *)memcpy(tmp, p, (size_t)n * nc);
+      __m128i lo, hi;
+      LoadChunky(shuffles, p, &lo, &hi);
+      for (int i = 0; i < 3; ++i)
+        rgb[i] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(LoadBytes(shuffles, nullptr, 0, comp[i], lo, hi)));
+    } else if constexpr (kU8) {
+      unsigned char tmp[8] = {0};
+      for (int i = 0; i < 3; ++i)
+        rgb[i] = LoadFloats8((8 == n) ? rows[comp[i]] + x : (const unsigned char *)memcpy(tmp, rows[comp[i]] + x, n));
+    } else if constexpr (!kChunky) {
+      float tmp[8] = {0};
+      for (int i = 0; i < 3; ++i) {
+        const float *p = (const float *)rows[comp[i]] + x;
+        rgb[i] = _mm256_loadu_ps((8 == n) ? p : (const float *)memcpy(tmp, p, (size_t)n * sizeof(float)));
+      }
+    } else {
+      float tmp[3][8] = {{0}};
+      const float *p = (const float *)rows[0] + (ptrdiff_t)x * nc;
+      for (int j = 0; j < n; ++j, p += nc)
+        for (int i = 0; i < 3; ++i) tmp[i][j] = p[comp[i]];
+      for (int i = 0; i < 3; ++i) rgb[i] = _mm256_loadu_ps(tmp[i]);
+    }
+  }
+};
+
+// (1 - w) * a[i] + w * b[i], i in [0, n).
+NVCVREF_TARGET("avx2")
+void BlendBytes(const unsigned char *a, const unsigned char *b, float w, int n, float *out) {
+  const __m256 wa = _mm256_set1_ps(1.f - w), wb = _mm256_set1_ps(w);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i,
+                     _mm256_add_ps(_mm256_mul_ps(wa, LoadFloats8(a + i)), _mm256_mul_ps(wb, LoadFloats8(b + i))));
+  for (; i < n; ++i) out[i] = (1.f - w) * a[i] + w * b[i];
+}
+
+// Rows [y0, y1) of a width x height YUV image, with luma every kYPix bytes and chroma every kCPix bytes, to a row
+// store. The chroma of a row is blended vertically into uRow[1, cw], which is padded by replicating its ends, so that
+// the horizontal taps of ChromaTaps() are two permutes of uRow[x / 2, x / 2 + 8) for each block of 8 pixels at x.
+template <bool kSubX, bool kCositedX, int kYPix, int kCPix, class Store>
+NVCVREF_TARGET("avx2")
+void FromYUVRowsAVX2(const YUVPlanes &yuv, Store &store, NvCVImage *dst, int dx, int dy, unsigned width,
+                     unsigned height, unsigned y0, unsigned y1, float scale, float opaque) {
+  const YUVCoefficients k = GetYUVCoefficients(yuv.colorspace);
+  const float rv = 2.f * (1.f - k.kr), bu = 2.f * (1.f - k.kb);
+  const float gu = bu * k.kb / k.kg, gv = rv * k.kr / k.kg;
+  const bool subY = NVCV_YUV420 == yuv.format, cositedY = ChromaCositedY(yuv.colorspace);
+  const int w = (int)width, cw = kSubX ? (w + 1) / 2 : w, ch = subY ? (int)(height + 1) / 2 : (int)height;
+  const __m256 yBias = _mm256_set1_ps(k.yBias), yGain = _mm256_set1_ps(k.yGain), cGain = _mm256_set1_ps(k.cGain);
+  const __m256 c128 = _mm256_set1_ps(128.f), vScale = _mm256_set1_ps(scale), vOpaque = _mm256_set1_ps(opaque);
+  const __m256 vrv = _mm256_set1_ps(rv), vbu = _mm256_set1_ps(bu), vgu = _mm256_set1_ps(gu), vgv = _mm256_set1_ps(gv);
+  const __m256i ia = _mm256_setr_epi32(1, 1, 2, 2, 3, 3, 4, 4);
+  const __m256i ib = kCositedX ? _mm256_setr_epi32(1, 2, 2, 3, 3, 4, 4, 5) : _mm256_setr_epi32(0, 2, 1, 3, 2, 4, 3, 5);
+  const __m256 wb = kCositedX ? _mm256_setr_ps(0.f, .5f, 0.f, .5f, 0.f, .5f, 0.f, .5f) : _mm256_set1_ps(.25f);
+  const __m256 wa = kCositedX ? _mm256_setr_ps(1.f, .5f, 1.f, .5f, 1.f, .5f, 1.f, .5f) : _mm256_set1_ps(.75f);
+  std::vector<float> uRow((size_t)cw + 16), vRow((size_t)cw + 16);
+  std::vector<unsigned char> gathered(kCPix != 1 ? 4 * (size_t)cw : 0), yRow((size_t)w + 8);
+
+  for (int y = (int)y0; y < (int)y1; ++y) {
+    int j0 = y, j1 = y;
+    float wy = 0.f;
+    if (subY) ChromaTaps(y, ch, cositedY, &j0, &j1, &wy);
+    const unsigned char *c[4] = {yuv.u + (ptrdiff_t)j0 * yuv.cPitch, yuv.u + (ptrdiff_t)j1 * yuv.cPitch,
+                                 yuv.v + (ptrdiff_t)j0 * yuv.cPitch, yuv.v + (ptrdiff_t)j1 * yuv.cPitch};
+    if constexpr (kCPix != 1) {
+      for (int r = 0; r < 4; ++r) {
+        GatherBytes<kCPix>(c[r], &gathered[(size_t)r * cw], cw);
+        c[r] = &gathered[(size_t)r * cw];
+      }
+    }
+    BlendBytes(c[0], c[1], wy, cw, &uRow[1]);
+    BlendBytes(c[2], c[3], wy, cw, &vRow[1]);
+    uRow[0] = uRow[1], uRow[cw + 1] = uRow[cw];
+    vRow[0] = vRow[1], vRow[cw + 1] = vRow[cw];
+
+    const unsigned char *yp = yuv.y + (ptrdiff_t)y * yuv.yPitch;
+    if (kYPix != 1 || w % 8) {  // the last block is read from a copy, padded to 8
+      GatherBytes<kYPix>(yp, yRow.data(), w);
+      yp = yRow.data();
+    }
+    store.Row(dst, dx, dy + y);
+    for (int x = 0; x < w; x += 8) {
+      __m256 Y = _mm256_mul_ps(_mm256_sub_ps(LoadFloats8(yp + x), yBias), yGain), U, V;
+      if constexpr (kSubX) {
+        __m256 u = _mm256_loadu_ps(&uRow[x / 2]), v = _mm256_loadu_ps(&vRow[x / 2]);
+        U = _mm256_add_ps(_mm256_mul_ps(wa, _mm256_permutevar8x32_ps(u, ia)),
+                          _mm256_mul_ps(wb, _mm256_permutevar8x32_ps(u, ib)));
+        V = _mm256_add_ps(_mm256_mul_ps(wa, _mm256_permutevar8x32_ps(v, ia)),
+                          _mm256_mul_ps(wb, _mm256_permutevar8x32_ps(v, ib)));
+      } else {  // (1 - 0) * c + 0 * c is exactly c
+        U = _mm256_loadu_ps(&uRow[1 + x]);
+        V = _mm256_loadu_ps(&vRow[1 + x]);
+      }
+      U = _mm256_mul_ps(_mm256_sub_ps(U, c128), cGain);
+      V = _mm256_mul_ps(_mm256_sub_ps(V, c128), cGain);
+      __m256 px[5];
+      px[SEM_R] = _mm256_mul_ps(_mm256_add_ps(Y, _mm256_mul_ps(vrv, V)), vScale);
+      px[SEM_G] = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(Y, _mm256_mul_ps(vgu, U)), _mm256_mul_ps(vgv, V)), vScale);
+      px[SEM_B] = _mm256_mul_ps(_mm256_add_ps(Y, _mm256_mul_ps(vbu, U)), vScale);
+      px[SEM_A] = vOpaque;
+      px[SEM_Y] = _mm256_mul_ps(Y, vScale);
+      store(x, std::min(8, w - x), px);
+    }
+  }
+}
+
+// A width x height region of a row load to chroma rows [j0, j1) of YUV and the luma rows that they cover, as
+// ConvertToYUV() does. The chroma of a row is kept in uFull[1, w], padded by replicating its ends, so that the
+// [1 2 1] and [1 1] filters about column 2i read the even and odd elements of uFull[2i, 2i + 18).
+template <bool kSubX, bool kCositedX, int kYPix, int kCPix, class Load>
+NVCVREF_TARGET("avx2")
+void ToYUVRowsAVX2(Load &load, const NvCVImage *src, int sx, int sy, unsigned width, unsigned height,
+                   const YUVPlanes &yuv, unsigned j0, unsigned j1, float scale) {
+  const YUVCoefficients k = GetYUVCoefficients(yuv.colorspace);
+  const float yInv = 1.f / k.yGain, cInv = 1.f / k.cGain;
+  const float uk = .5f / (1.f - k.kb), vk = .5f / (1.f - k.kr);
+  const bool subY = NVCV_YUV420 == yuv.format, cositedY = ChromaCositedY(yuv.colorspace);
+  const int w = (int)width, h = (int)height, cw = kSubX ? (w + 1) / 2 : w, pitch = cw + 8;
+  const __m256 kr = _mm256_set1_ps(k.kr), kg = _mm256_set1_ps(k.kg), kb = _mm256_set1_ps(k.kb);
+  const __m256 vyInv = _mm256_set1_ps(yInv), vcInv = _mm256_set1_ps(cInv), yBias = _mm256_set1_ps(k.yBias);
+  const __m256 vuk = _mm256_set1_ps(uk), vvk = _mm256_set1_ps(vk), vScale = _mm256_set1_ps(scale);
+  const __m256 c128 = _mm256_set1_ps(128.f), two = _mm256_set1_ps(2.f), quarter = _mm256_set1_ps(.25f);
+  const __m256 half = _mm256_set1_ps(.5f);
+  unsigned r0, r1;
+  ChromaSourceRows(yuv, height, j0, j1, &r0, &r1);
+  const unsigned lumaRow0 = subY ? 2 * j0 : j0;  // the first row of luma of the band; r0 may precede it
+  std::vector<float> uRows((size_t)pitch * (r1 - r0)), vRows((size_t)pitch * (r1 - r0));  // horizontally subsampled
+  std::vector<float> uFull((size_t)w + 24), vFull((size_t)w + 24);
+  unsigned char tmp[16];
+
+  for (int y = (int)r0; y < (int)r1; ++y) {
+    unsigned char *yp = yuv.y + (ptrdiff_t)y * yuv.yPitch;
+    const bool writeLuma = (unsigned)y >= lumaRow0;
+    load.Row(src, sx, sy + y);
+    for (int x = 0; x < w; x += 8) {
+      const int n = std::min(8, w - x);
+      __m256 rgb[3];
+      load(x, n, rgb);
+      __m256 R = _mm256_mul_ps(rgb[0], vScale), G = _mm256_mul_ps(rgb[1], vScale), B = _mm256_mul_ps(rgb[2], vScale);
+      __m256 Y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(kr, R), _mm256_mul_ps(kg, G)), _mm256_mul_ps(kb, B));
+      _mm256_storeu_ps(&uFull[1 + x], _mm256_mul_ps(_mm256_sub_ps(B, Y), vuk));
+      _mm256_storeu_ps(&vFull[1 + x], _mm256_mul_ps(_mm256_sub_ps(R, Y), vvk));
+      if (!writeLuma) continue;
+      __m128i bytes = ToBytes8(_mm256_add_ps(_mm256_mul_ps(Y, vyInv), yBias));
+      if (1 == kYPix && 8 == n) {
+        _mm_storel_epi64((__m128i *)(yp + x), bytes);
+      } else {
+        _mm_storeu_si128((__m128i *)tmp, bytes);
+        ScatterBytes<kYPix>(tmp, yp + (ptrdiff_t)x * kYPix, n);
+      }
+    }
+    uFull[0] = uFull[1], uFull[w + 1] = uFull[w];
+    vFull[0] = vFull[1], vFull[w + 1] = vFull[w];
+
+    float *ur = &uRows[(size_t)(y - (int)r0) * pitch], *vr = &vRows[(size_t)(y - (int)r0) * pitch];
+    for (int i = 0; i < cw; i += 8) {
+      if constexpr (!kSubX) {
+        _mm256_storeu_ps(ur + i, _mm256_loadu_ps(&uFull[1 + i]));
+        _mm256_storeu_ps(vr + i, _mm256_loadu_ps(&vFull[1 + i]));
+        continue;
+      }
+      for (int p = 0; p < 2; ++p) {
+        const float *f = (p ? vFull.data() : uFull.data()) + 2 * i;
+        __m256 a0 = _mm256_loadu_ps(f), a1 = _mm256_loadu_ps(f + 8);
+        __m256 c = Odds(a0, a1), r = Evens(_mm256_loadu_ps(f + 2), _mm256_loadu_ps(f + 10)), out;
+        if constexpr (kCositedX)  // [1 2 1] / 4 about the even column
+          out = _mm256_mul_ps(quarter, _mm256_add_ps(_mm256_add_ps(Evens(a0, a1), _mm256_mul_ps(two, c)), r));
+        else  // [1 1] / 2 about the midpoint
+          out = _mm256_mul_ps(half, _mm256_add_ps(c, r));
+        _mm256_storeu_ps((p ? vr : ur) + i, out);
+      }
+    }
+  }
+
+  for (int j = (int)j0; j < (int)j1; ++j) {
+    int t = j, m = j, b = j;  // the rows above, at, and below the chroma sample
+    float w0 = 0.f, w1 = 1.f, w2 = 0.f;
+    if (subY && cositedY) {
+      t = std::max(2 * j - 1, 0), m = 2 * j, b = std::min(2 * j + 1, h - 1);
+      w0 = w2 = .25f, w1 = .5f;
+    } else if (subY) {
+      t = m = 2 * j, b = std::min(2 * j + 1, h - 1);
+      w0 = w1 = .25f, w2 = .5f;
+    }
+    const __m256 vw0 = _mm256_set1_ps(w0), vw1 = _mm256_set1_ps(w1), vw2 = _mm256_set1_ps(w2);
+    for (int p = 0; p < 2; ++p) {
+      const float *rows = (p ? vRows : uRows).data();
+      const float *c0 = rows + (size_t)(t - (int)r0) * pitch, *c1 = rows + (size_t)(m - (int)r0) * pitch;
+      const float *c2 = rows + (size_t)(b - (int)r0) * pitch;
+      unsigned char *cp = (p ? yuv.v : yuv.u) + (ptrdiff_t)j * yuv.cPitch;
+      for (int i = 0; i < cw; i += 8) {
+        const int n = std::min(8, cw - i);
+        __m256 f = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vw0, _mm256_loadu_ps(c0 + i)),
+                                               _mm256_mul_ps(vw1, _mm256_loadu_ps(c1 + i))),
+                                 _mm256_mul_ps(vw2, _mm256_loadu_ps(c2 + i)));
+        __m128i bytes = ToBytes8(_mm256_add_ps(_mm256_mul_ps(f, vcInv), c128));
+        if (1 == kCPix && 8 == n) {
+          _mm_storel_epi64((__m128i *)(cp + i), bytes);
+        } else {
+          _mm_storeu_si128((__m128i *)tmp, bytes);
+          ScatterBytes<kCPix>(tmp, cp + (ptrdiff_t)i * kCPix, n);
+        }
+      }
+    }
+  }
+}
+
+// Instantiate the kernels for the subsampling and siting of the chroma, and for the layout of the RGB image.
+template <int kYPix, int kCPix>
+void FromYUVLayout(const YUVPlanes &yuv, NvCVImage *dst, int dx, int dy, unsigned width, unsigned height,
+                   unsigned y0, unsigned y1, float scale) {
+  const bool subX = NVCV_YUV444 != yuv.format, cositedX = ChromaCositedX(yuv.colorspace);
+  auto run = [&](auto store, float opaque) {
+    if (!subX)
+      FromYUVRowsAVX2<false, true, kYPix, kCPix>(yuv, store, dst, dx, dy, width, height, y0, y1, scale, opaque);
+    else if (cositedX)
+      FromYUVRowsAVX2<true, true, kYPix, kCPix>(yuv, store, dst, dx, dy, width, height, y0, y1, scale, opaque);
+    else
+      FromYUVRowsAVX2<true, false, kYPix, kCPix>(yuv, store, dst, dx, dy, width, height, y0, y1, scale, opaque);
+  };
+  const bool u8 = NVCV_U8 == dst->componentType, chunky = NVCV_PLANAR != dst->planar;
+  if (u8 && chunky)
+    run(PixelStore<true, true>(dst), 255.f);
+  else if (u8)
+    run(PixelStore<true, false>(dst), 255.f);
+  else if (chunky)
+    run(PixelStore<false, true>(dst), 1.f);
+  else
+    run(PixelStore<false, false>(dst), 1.f);
+}
+
+template <int kYPix, int kCPix>
+bool ToYUVLayout(const NvCVImage *src, int sx, int sy, unsigned width, unsigned height, const YUVPlanes &yuv,
+                 unsigned j0, unsigned j1, float scale) {
+  const bool subX = NVCV_YUV444 != yuv.format, cositedX = ChromaCositedX(yuv.colorspace);
+  auto run = [&](auto load) {
+    if (!load.Valid()) return false;
+    if (!subX)
+      ToYUVRowsAVX2<false, true, kYPix, kCPix>(load, src, sx, sy, width, height, yuv, j0, j1, scale);
+    else if (cositedX)
+      ToYUVRowsAVX2<true, true, kYPix, kCPix>(load, src, sx, sy, width, height, yuv, j0, j1, scale);
+    else
+      ToYUVRowsAVX2<true, false, kYPix, kCPix>(load, src, sx, sy, width, height, yuv, j0, j1, scale);
+    return true;
+  };
+  const bool u8 = NVCV_U8 == src->componentType, chunky = NVCV_PLANAR != src->planar;
+  if (u8 && chunky) return run(PixelLoad<true, true>(src));
+  if (u8) return run(PixelLoad<true, false>(src));
+  if (chunky) return run(PixelLoad<false, true>(src));
+  return run(PixelLoad<false, false>(src));
+}
+
+// The byte strides of luma and chroma of the YUV layouts with kernels: planar (I420, YV12, ...), semi-planar (NV12,
+// NV21, ...), and chunky 4:2:2 (YUY2, UYVY, ...) and 4:4:4.
+enum { YUV_PLANAR = 0x11, YUV_SEMIPLANAR = 0x12, YUV_CHUNKY422 = 0x24, YUV_CHUNKY444 = 0x33 };
+
+inline int KernelLayout(const YUVPlanes &yuv) {
+  return (yuv.yPixBytes < 16 && yuv.cPixBytes < 16) ? yuv.yPixBytes << 4 | yuv.cPixBytes : 0;
+}
+
+inline bool IsU8OrF32(const NvCVImage *im) {
+  return NVCV_U8 == im->componentType || NVCV_F32 == im->componentType;
+}
+
+#endif  // NVCVREF_X86
+
+}  // namespace
+
+unsigned TransferColumnsSIMD(const NvCVImage *src, int sx, int sy, NvCVImage *dst, int dx, int dy, unsigned width,
+                             unsigned height, const ComponentMap *map, int nd, float scale) {
+  const Isa isa = CurrentIsa();
+  Plan plan;
+  unsigned blocks = width / 8;
+  if (ISA_SCALAR == isa || !blocks || !MakePlan(src, dst, map, nd, scale, &plan)) return 0;
+#ifdef NVCVREF_X86
+  if (ISA_AVX2 == isa)
+    TransferRowsAVX2(plan, src, sx, sy, dst, dx, dy, blocks, height);
+  else
+    TransferRowsSSE41(plan, src, sx, sy, dst, dx, dy, blocks, height);
+  return blocks * 8;
+#else   // !NVCVREF_X86
+  (void)sx, (void)sy, (void)dx, (void)dy, (void)height;
+  return 0;
+#endif  // NVCVREF_X86
+}
+
+bool TransferFromYUVSIMD(const YUVPlanes &yuv, NvCVImage *dst, int dx, int dy, unsigned width, unsigned height,
+                         unsigned y0, unsigned y1, float scale) {
+#ifdef NVCVREF_X86
+  int sem[4];
+  if (ISA_AVX2 != CurrentIsa() || !IsU8OrF32(dst) || !FormatSemantics(dst->pixelFormat, sem)) return false;
+  switch (KernelLayout(yuv)) {
+    case YUV_PLANAR:     FromYUVLayout<1, 1>(yuv, dst, dx, dy, width, height, y0, y1, scale); return true;
+    case YUV_SEMIPLANAR: FromYUVLayout<1, 2>(yuv, dst, dx, dy, width, height, y0, y1, scale); return true;
+    case YUV_CHUNKY422:  FromYUVLayout<2, 4>(yuv, dst, dx, dy, width, height, y0, y1, scale); return true;
+    case YUV_CHUNKY444:  FromYUVLayout<3, 3>(yuv, dst, dx, dy, width, height, y0, y1, scale); return true;
+  }
+#endif  // NVCVREF_X86
+  (void)yuv, (void)dst, (void)dx, (void)dy, (void)width, (void)height, (void)y0, (void)y1, (void)scale;
+  return false;
+}
+
+bool TransferToYUVSIMD(const NvCVImage *src, int sx, int sy, unsigned width, unsigned height, const YUVPlanes &yuv,
+                       unsigned j0, unsigned j1, float scale) {
+#ifdef NVCVREF_X86
+  if (ISA_AVX2 != CurrentIsa() || !IsU8OrF32(src)) return false;
+  switch (KernelLayout(yuv)) {
+    case YUV_PLANAR:     return ToYUVLayout<1, 1>(src, sx, sy, width, height, yuv, j0, j1, scale);
+    case YUV_SEMIPLANAR: return ToYUVLayout<1, 2>(src, sx, sy, width, height, yuv, j0, j1, scale);
+    case YUV_CHUNKY422:  return ToYUVLayout<2, 4>(src, sx, sy, width, height, yuv, j0, j1, scale);
+    case YUV_CHUNKY444:  return ToYUVLayout<3, 3>(src, sx, sy, width, height, yuv, j0, j1, scale);
+  }
+#endif  // NVCVREF_X86
+  (void)src, (void)sx, (void)sy, (void)width, (void)height, (void)yuv, (void)j0, (void)j1, (void)scale;
+  return false;
+}
@@ -21,6 +21,10 @@ OUT OF OR IN # CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 #
 ###############################################################################*/
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
 #include "Converter.cpp"
 #include "nvVideoEffects.h"
 
@@ -40,12 +44,27 @@ SOFTWARE.
 #endif  // _WIN32
 
 bool FLAG_debug = false, FLAG_verbose = false, FLAG_show = false,
-     FLAG_progress = false, FLAG_webcam = false;
+     FLAG_progress = false, FLAG_webcam = false, FLAG_async = false,
+     FLAG_realtime = false, FLAG_latency = false, FLAG_latencyOverlay = false;
 float FLAG_strength = 0.f;
+float FLAG_skipDuplicates = -1.f;
+float FLAG_deadline = -1.f;
 int FLAG_mode = 0;
 int FLAG_resolution = 0;
+int FLAG_pipelineDepth = 0;
+int FLAG_batch = 0;
+int FLAG_modelBatch = 0;
+int FLAG_segments = 0;
+int FLAG_overlap = 0;
+int FLAG_poolMB = 0;
+int FLAG_dirtyTile = 0;
+int FLAG_dirtyRefresh = 60;
+int FLAG_cacheMB = 1024;
 std::string FLAG_codec = DEFAULT_CODEC, FLAG_camRes = "1280x720", FLAG_inFile,
-            FLAG_outFile, FLAG_outDir, FLAG_modelDir, FLAG_effect;
+            FLAG_outFile, FLAG_outDir, FLAG_inDir, FLAG_inList, FLAG_modelDir,
+            FLAG_effect, FLAG_stats, FLAG_statsCsv, FLAG_yuv,
+            FLAG_yuvColorspace, FLAG_rawFormat, FLAG_roiFile,
+            FLAG_cacheDir, FLAG_traceFile;
 
 static bool GetFlagArgVal(const char* flag, const char* arg, const char** val) {
   if (*arg != '-') return false;
@@ -87,6 +106,23 @@ static bool GetFlagArgVal(const char* flag, const char* arg, float* val) {
   return success;
 }
 
+// A flag whose value may be omitted, as in --flag or --flag=value.
+static bool GetOptionalFlagArgVal(const char* flag, const char* arg,
+                                  float dflt, float* val) {
+  const char* valStr;
+  bool success = GetFlagArgVal(flag, arg, &valStr);
+  if (success) *val = valStr ? strtof(valStr, NULL) : dflt;
+  return success;
+}
+
+static bool GetOptionalFlagArgVal(const char* flag, const char* arg, int dflt,
+                                  int* val) {
+  const char* valStr;
+  bool success = GetFlagArgVal(flag, arg, &valStr);
+  if (success) *val = valStr ? (int)strtol(valStr, NULL, 10) : dflt;
+  return success;
+}
+
 static bool GetFlagArgVal(const char* flag, const char* arg, long* val) {
   const char* valStr;
   bool success = GetFlagArgVal(flag, arg, &valStr);
@@ -101,14 +137,119 @@ static bool GetFlagArgVal(const char* flag, const char* arg, int* val) {
   return success;
 }
 
+static std::vector<std::string> SplitList(const std::string& str, char sep) {
+  std::vector<std::string> items;
+  size_t begin = 0, end;
+  if (str.empty()) return items;
+  do {
+    end = str.find(sep, begin);
+    items.push_back(str.substr(begin, end - begin));
+    begin = end + 1;
+  } while (end != std::string::npos);
+  return items;
+}
+
+// The images to be processed in batch are either all of the images in
+// --in_dir, or those listed one per line in the --in_list file.
+static bool GetInputImages(std::vector<std::string>* inFiles) {
+  namespace fs = std::filesystem;
+  inFiles->clear();
+  if (!FLAG_inDir.empty()) {
+    std::error_code ec;
+    for (const fs::directory_entry& entry :
+         fs::directory_iterator(FLAG_inDir, ec)) {
+      if (entry.is_regular_file() &&
+          IsImageFile(entry.path().string().c_str()))
+        inFiles->push_back(entry.path().string());
+    }
+    if (ec) {
+      std::cerr << "Cannot read directory \"" << FLAG_inDir << "\"\n";
+      return false;
+    }
+    std::sort(inFiles->begin(), inFiles->end());
+  } else {
+    std::ifstream list(FLAG_inList);
+    std::string line;
+    if (!list) {
+      std::cerr << "Cannot read \"" << FLAG_inList << "\"\n";
+      return false;
+    }
+    while (std::getline(list, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (!line.empty()) inFiles->push_back(line);
+    }
+  }
+  if (inFiles->empty()) {
+    std::cerr << "No images to process\n";
+    return false;
+  }
+  return true;
+}
+
+// Output files for a list of inputs are named either by a parallel list in
+// --out_file, or after the inputs, in --out_dir.
+static bool GetOutputFiles(const std::vector<std::string>& inFiles,
+                           std::vector<std::string>* outFiles) {
+  namespace fs = std::filesystem;
+  if (!FLAG_outDir.empty()) {
+    outFiles->clear();
+    for (const std::string& inFile : inFiles) {
+      fs::path outPath = fs::path(FLAG_outDir) / fs::path(inFile).filename();
+      std::error_code ec;
+      if (fs::equivalent(inFile, outPath, ec)) {
+        std::cerr << "--out_dir would overwrite \"" << inFile << "\"\n";
+        return false;
+      }
+      outFiles->push_back(outPath.string());
+    }
+  } else {
+    *outFiles = SplitList(FLAG_outFile, ',');
+    if (!outFiles->empty() && outFiles->size() != inFiles.size()) {
+      std::cerr << "--out_file lists " << outFiles->size()
+                << " files, but --in_file lists " << inFiles.size() << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
 static void Usage() {
   printf(
       "VideoEffectsApp [args ...]\n"
       "  where args is:\n"
       "  --in_file=<path>           input file to be processed\n"
+      "  --in_file=<path>,<path>... videos of the same size to be multiplexed "
+      "through one\n"
+      "                             effect instance, each with its own state\n"
+      "  --in_file=-                read frames from standard input, e.g. "
+      "from ffmpeg: raw\n"
+      "                             frames as given by --raw_format, else "
+      "Y4M\n"
+      "  --in_dir=<path>            process all of the images in a directory, "
+      "loading the\n"
+      "                             effect once; use with --out_dir\n"
+      "  --in_list=<path>           process the images listed one per line in "
+      "a file\n"
       "  --webcam                   use a webcam as the input\n"
-      "  --out_file=<path>          output file to be written\n"
-      "  --effect=<effect>          the effect to apply\n"
+      "  --realtime                 read the input video at its frame rate, "
+      "as a webcam\n"
+      "                             delivers, and process only the newest "
+      "frame, dropping the\n"
+      "                             rest\n"
+      "  --out_file=<path>          output file to be written (a comma-separated "
+      "list for\n"
+      "                             a list of inputs)\n"
+      "  --out_file=-               write raw frames to standard output, in "
+      "the format of\n"
+      "                             --raw_format or the raw input, else "
+      "I420; messages go\n"
+      "                             to stderr\n"
+      "  --out_dir=<path>           directory in which to write outputs named "
+      "after the inputs\n"
+      "  --effect=<effect>          the effect to apply, or a comma-separated "
+      "chain of effects\n"
+      "                             applied in order on the GPU, e.g.\n"
+      "                             --effect=ArtifactReduction,SuperRes\n"
       "  --show                     display the results in a window (for "
       "webcam, it is always true)\n"
       "  --strength=<value>         strength of the upscaling effect, [0.0, "
@@ -126,6 +267,89 @@ static void Usage() {
       "  --codec=<fourcc>           the fourcc code for the desired codec "
       "(default " DEFAULT_CODEC
       ")\n"
+      "  --pipeline_depth=<N>       decode, process and encode video on separate "
+      "threads,\n"
+      "                             with up to N frames in flight (default 0: "
+      "serial)\n"
+      "  --async                    double-buffer video frames in pinned memory "
+      "and overlap\n"
+      "                             upload, effect and download on separate "
+      "CUDA streams\n"
+      "  --batch=<N>                process video N frames per run of the effect, "
+      "and report\n"
+      "                             the frame rate achieved with that batch "
+      "size\n"
+      "  --model_batch=<N>          the batch size of the model to use "
+      "(default: --batch)\n"
+      "  --segments=<N>             split a video into N segments processed "
+      "concurrently,\n"
+      "                             each by its own effect instance\n"
+      "  --overlap=<K>              with --segments, run K frames before each "
+      "segment through\n"
+      "                             the effect to warm it up, but do not write "
+      "them\n"
+      "  --pool_mb=<N>              cap on the megabytes of image buffers kept "
+      "for reuse when\n"
+      "                             the image size changes (default: no cap)\n"
+      "  --stats=<file.json>        time the decode, upload, run, download, "
+      "encode and display\n"
+      "                             of each video frame, and write the "
+      "percentiles to a file\n"
+      "  --stats_csv=<file.csv>     write the time of each stage of each frame "
+      "to a file\n"
+      "  --latency                  print histograms of the latency of video "
+      "frames, from\n"
+      "                             capture to output, and between the "
+      "stages on the way\n"
+      "  --latency_overlay          draw on each output frame the time since "
+      "it was captured\n"
+      "  --trace_file=<file.json>   write the latency of each frame as a "
+      "chrome://tracing trace\n"
+      "  --yuv=<nv12|i420>          keep decoded video in YUV 4:2:0, "
+      "converting it directly to\n"
+      "                             and from the effect's format; a .yuv "
+      "--out_file is written\n"
+      "                             as raw frames of the same layout\n"
+      "  --yuv_colorspace=<list>    the YUV colorspace, e.g. 709,video,cosited "
+      "(default: 709\n"
+      "                             for 720p and up, otherwise 601, video "
+      "range, cosited chroma)\n"
+      "  --raw_format=<fmt[:WxH[@fps]]>\n"
+      "                             the frames of a headerless .yuv or .raw "
+      "file, e.g.\n"
+      "                             nv12:1920x1080@30; .y4m files describe "
+      "themselves. Raw and\n"
+      "                             .y4m outputs are written in this format, "
+      "else as the input\n"
+      "  --roi_file=<file>          run the effect only on the regions of "
+      "each video frame listed\n"
+      "                             in a CSV file of frame,x,y,width,height "
+      "lines, or a JSON\n"
+      "                             array of such objects, and resample the "
+      "rest of the frame\n"
+      "  --skip_duplicates[=<lvl>]  reuse the output of the last frame "
+      "processed for frames that\n"
+      "                             repeat it: exactly, or to within a mean "
+      "difference of lvl\n"
+      "                             8-bit levels between 32x32 thumbnails\n"
+      "  --dirty_tiles[=<N>]        run the effect only on the NxN tiles "
+      "of each video frame that\n"
+      "                             have changed (default N: 128)\n"
+      "  --dirty_refresh=<N>        with --dirty_tiles, run every Nth frame "
+      "whole, to bound drift;\n"
+      "                             0 for never (default: 60)\n"
+      "  --cache_dir=<path>         reuse results stored in this directory "
+      "for the same input\n"
+      "                             and settings, and store new ones there\n"
+      "  --cache_mb=<N>             evict the least recently used results "
+      "to keep the cache\n"
+      "                             under N MiB (default: 1024)\n"
+      "  --deadline[=<ms>]          keep the effect within ms per frame "
+      "(default: the frame\n"
+      "                             period), by stepping down to "
+      "conservative mode, lower\n"
+      "                             --resolution and alternate frames, and "
+      "back up when it can\n"
       "  --progress                 show progress\n"
       "  --verbose                  verbose output\n"
       "  --debug                    print extra debugging information\n");
@@ -147,17 +371,45 @@ static int ParseMyArgs(int argc, char** argv) {
                (GetFlagArgVal("verbose", arg, &FLAG_verbose) ||
                 GetFlagArgVal("in", arg, &FLAG_inFile) ||
                 GetFlagArgVal("in_file", arg, &FLAG_inFile) ||
+                GetFlagArgVal("in_dir", arg, &FLAG_inDir) ||
+                GetFlagArgVal("in_list", arg, &FLAG_inList) ||
                 GetFlagArgVal("out", arg, &FLAG_outFile) ||
                 GetFlagArgVal("out_file", arg, &FLAG_outFile) ||
+                GetFlagArgVal("out_dir", arg, &FLAG_outDir) ||
                 GetFlagArgVal("effect", arg, &FLAG_effect) ||
                 GetFlagArgVal("show", arg, &FLAG_show) ||
                 GetFlagArgVal("webcam", arg, &FLAG_webcam) ||
+                GetFlagArgVal("realtime", arg, &FLAG_realtime) ||
                 GetFlagArgVal("cam_res", arg, &FLAG_camRes) ||
                 GetFlagArgVal("strength", arg, &FLAG_strength) ||
                 GetFlagArgVal("mode", arg, &FLAG_mode) ||
                 GetFlagArgVal("resolution", arg, &FLAG_resolution) ||
                 GetFlagArgVal("model_dir", arg, &FLAG_modelDir) ||
                 GetFlagArgVal("codec", arg, &FLAG_codec) ||
+                GetFlagArgVal("pipeline_depth", arg, &FLAG_pipelineDepth) ||
+                GetFlagArgVal("async", arg, &FLAG_async) ||
+                GetFlagArgVal("batch", arg, &FLAG_batch) ||
+                GetFlagArgVal("model_batch", arg, &FLAG_modelBatch) ||
+                GetFlagArgVal("segments", arg, &FLAG_segments) ||
+                GetFlagArgVal("overlap", arg, &FLAG_overlap) ||
+                GetFlagArgVal("pool_mb", arg, &FLAG_poolMB) ||
+                GetFlagArgVal("stats", arg, &FLAG_stats) ||
+                GetFlagArgVal("stats_csv", arg, &FLAG_statsCsv) ||
+                GetFlagArgVal("latency", arg, &FLAG_latency) ||
+                GetFlagArgVal("latency_overlay", arg, &FLAG_latencyOverlay) ||
+                GetFlagArgVal("trace_file", arg, &FLAG_traceFile) ||
+                GetFlagArgVal("yuv", arg, &FLAG_yuv) ||
+                GetFlagArgVal("yuv_colorspace", arg, &FLAG_yuvColorspace) ||
+                GetFlagArgVal("raw_format", arg, &FLAG_rawFormat) ||
+                GetFlagArgVal("roi_file", arg, &FLAG_roiFile) ||
+                GetOptionalFlagArgVal("skip_duplicates", arg, 0.f,
+                                      &FLAG_skipDuplicates) ||
+                GetOptionalFlagArgVal("dirty_tiles", arg, 128,
+                                      &FLAG_dirtyTile) ||
+                GetFlagArgVal("dirty_refresh", arg, &FLAG_dirtyRefresh) ||
+                GetFlagArgVal("cache_dir", arg, &FLAG_cacheDir) ||
+                GetFlagArgVal("cache_mb", arg, &FLAG_cacheMB) ||
+                GetOptionalFlagArgVal("deadline", arg, 0.f, &FLAG_deadline) ||
                 GetFlagArgVal("progress", arg, &FLAG_progress) ||
                 GetFlagArgVal("debug", arg, &FLAG_debug))) {
       continue;
@@ -189,6 +441,8 @@ int main(int argc, char** argv) {
   FXApp app;
 
   nErrs = ParseMyArgs(argc, argv);
+  if (FLAG_outFile == "-")
+    RawVideoStdout();  // Frames go to stdout, and everything else to stderr
   if (nErrs) std::cerr << nErrs << " command line syntax problems\n";
 
   if (FLAG_verbose) {
@@ -202,12 +456,14 @@ int main(int argc, char** argv) {
     if (FLAG_progress) FLAG_progress = !FLAG_progress;
     if (!FLAG_show) FLAG_show = !FLAG_show;
   }
-  if (FLAG_inFile.empty() && !FLAG_webcam) {
-    std::cerr << "Please specify --in_file=XXX or --webcam=true\n";
+  if (FLAG_inFile.empty() && FLAG_inDir.empty() && FLAG_inList.empty() &&
+      !FLAG_webcam) {
+    std::cerr << "Please specify --in_file=XXX, --in_dir=XXX, --in_list=XXX "
+                 "or --webcam=true\n";
     ++nErrs;
   }
-  if (FLAG_outFile.empty() && !FLAG_show) {
-    std::cerr << "Please specify --out_file=XXX or --show\n";
+  if (FLAG_outFile.empty() && FLAG_outDir.empty() && !FLAG_show) {
+    std::cerr << "Please specify --out_file=XXX, --out_dir=XXX or --show\n";
     ++nErrs;
   }
   if (FLAG_effect.empty()) {
@@ -219,10 +475,33 @@ int main(int argc, char** argv) {
   finfo.camRes = FLAG_camRes;
   finfo.codec = FLAG_codec;
   finfo.mode = FLAG_mode;
+  finfo.pipelineDepth = FLAG_pipelineDepth;
+  finfo.async = FLAG_async;
+  finfo.batchSize = FLAG_batch;
+  finfo.modelBatch = FLAG_modelBatch;
+  finfo.segments = FLAG_segments;
+  finfo.overlap = FLAG_overlap;
+  finfo.poolMB = FLAG_poolMB;
+  finfo.statsFile = FLAG_stats;
+  finfo.statsCsv = FLAG_statsCsv;
+  finfo.latency = FLAG_latency;
+  finfo.latencyOverlay = FLAG_latencyOverlay;
+  finfo.traceFile = FLAG_traceFile;
+  finfo.yuv = FLAG_yuv;
+  finfo.yuvColorspace = FLAG_yuvColorspace;
+  finfo.rawFormat = FLAG_rawFormat;
+  finfo.roiFile = FLAG_roiFile;
+  finfo.skipDuplicates = FLAG_skipDuplicates;
+  finfo.dirtyTile = FLAG_dirtyTile;
+  finfo.dirtyRefresh = FLAG_dirtyRefresh;
+  finfo.cacheDir = FLAG_cacheDir;
+  finfo.cacheMB = FLAG_cacheMB;
+  finfo.deadline = FLAG_deadline;
   finfo.resolution = FLAG_resolution;
   finfo.strength = FLAG_strength;
   finfo.verbose = FLAG_verbose;
   finfo.webcam = FLAG_webcam;
+  finfo.realtime = FLAG_realtime;
 
   app.setShow(FLAG_show);
 
@@ -233,13 +512,30 @@ int main(int argc, char** argv) {
     fxErr = app.createEffect(FLAG_effect.c_str(), FLAG_modelDir.c_str());
     if (FXApp::errNone != fxErr) {
       std::cerr << "Error creating effect \"" << FLAG_effect << "\"\n";
-    } else {
-      if (IsImageFile(FLAG_inFile.c_str()))
-        fxErr = app.processImage(FLAG_inFile.c_str(), FLAG_outFile.c_str(),
-                                 finfo, *cb_consoleUpdateProgress);
+    } else if (!FLAG_inDir.empty() || !FLAG_inList.empty()) {
+      std::vector<std::string> inFiles, outFiles;
+      if (!GetInputImages(&inFiles) || !GetOutputFiles(inFiles, &outFiles))
+        fxErr = FXApp::errFlag;
       else
-        fxErr = app.processMovie(FLAG_inFile.c_str(), FLAG_outFile.c_str(),
-                                 finfo, *cb_consoleUpdateProgress);
+        fxErr = app.processImages(inFiles, outFiles, finfo,
+                                  FLAG_progress ? *cb_consoleUpdateProgress
+                                                : nullptr);
+    } else {
+      std::vector<std::string> inFiles = SplitList(FLAG_inFile, ','), outFiles;
+      if (!GetOutputFiles(inFiles, &outFiles)) {
+        fxErr = FXApp::errFlag;
+      } else if (inFiles.size() > 1) {
+        fxErr = app.processMovies(inFiles, outFiles, finfo,
+                                  *cb_consoleUpdateProgress);
+      } else {
+        if (!outFiles.empty()) FLAG_outFile = outFiles[0];
+        if (IsImageFile(FLAG_inFile.c_str()))
+          fxErr = app.processImage(FLAG_inFile.c_str(), FLAG_outFile.c_str(),
+                                   finfo, *cb_consoleUpdateProgress);
+        else
+          fxErr = app.processMovie(FLAG_inFile.c_str(), FLAG_outFile.c_str(),
+                                   finfo, *cb_consoleUpdateProgress);
+      }
     }
   }
 
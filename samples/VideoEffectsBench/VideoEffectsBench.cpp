@@ -0,0 +1,379 @@
+/*###############################################################################
+#
+# Copyright (c) 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+of # this software and associated documentation files (the "Software"), to deal
+in # the Software without restriction, including without limitation the rights
+to # use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of # the Software, and to permit persons to whom the Software is
+furnished to do so, # subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS # FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR # COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER # IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN # CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+#
+###############################################################################*/
+
+// Sweeps effect x input resolution x mode x strength x output resolution x
+// pipeline option through FXApp, and reports the load time, warm-up,
+// throughput and latency percentiles of each combination as one line of JSON.
+// The input is a synthetic clip generated for each input resolution, so no
+// input files are needed.
+
+#include <algorithm>
+#include <filesystem>
+
+#include "Converter.cpp"
+#include "nvVideoEffects.h"
+
+#ifdef _MSC_VER
+#define strcasecmp _stricmp
+#endif  // _MSC_VER
+
+#define NVCV_ERR_HELP 411
+
+bool FLAG_encode = false, FLAG_verbose = false;
+int FLAG_frames = 120, FLAG_warmup = 10;
+std::string FLAG_effects = "Transfer", FLAG_inRes = "360,720,1080",
+            FLAG_modes = "0,1", FLAG_strengths = "0,0.4",
+            FLAG_outRes = "1080,2160",
+            FLAG_pipelines = "serial,pipeline4,async,batch4", FLAG_modelDir,
+            FLAG_out;
+
+static bool GetFlagArgVal(const char* flag, const char* arg, const char** val) {
+  if (*arg != '-') return false;
+  while (*++arg == '-') continue;
+  const char* s = strchr(arg, '=');
+  if (s == NULL) {
+    if (strcmp(flag, arg) != 0) return false;
+    *val = NULL;
+    return true;
+  }
+  size_t n = s - arg;
+  if ((strlen(flag) != n) || (strncmp(flag, arg, n) != 0)) return false;
+  *val = s + 1;
+  return true;
+}
+
+static bool GetFlagArgVal(const char* flag, const char* arg, std::string* val) {
+  const char* valStr;
+  if (!GetFlagArgVal(flag, arg, &valStr)) return false;
+  val->assign(valStr ? valStr : "");
+  return true;
+}
+
+static bool GetFlagArgVal(const char* flag, const char* arg, bool* val) {
+  const char* valStr;
+  bool success = GetFlagArgVal(flag, arg, &valStr);
+  if (success) {
+    *val = (valStr == NULL || strcasecmp(valStr, "true") == 0 ||
+            strcasecmp(valStr, "on") == 0 || strcasecmp(valStr, "yes") == 0 ||
+            strcasecmp(valStr, "1") == 0);
+  }
+  return success;
+}
+
+static bool GetFlagArgVal(const char* flag, const char* arg, int* val) {
+  const char* valStr;
+  bool success = GetFlagArgVal(flag, arg, &valStr);
+  if (success) *val = valStr ? (int)strtol(valStr, NULL, 10) : 0;
+  return success;
+}
+
+static std::vector<std::string> SplitList(const std::string& str, char sep) {
+  std::vector<std::string> items;
+  size_t begin = 0, end;
+  if (str.empty()) return items;
+  do {
+    end = str.find(sep, begin);
+    items.push_back(str.substr(begin, end - begin));
+    begin = end + 1;
+  } while (end != std::string::npos);
+  return items;
+}
+
+static void Usage() {
+  printf(
+      "VideoEffectsBench [args ...]\n"
+      "  where args is:\n"
+      "  --effects=<e>,<e>...       effects to sweep (default: Transfer)\n"
+      "  --in_res=<h>,<h>...        heights of the 16:9 synthetic input "
+      "(default: 360,720,1080)\n"
+      "  --modes=<m>,<m>...         modes of ArtifactReduction and SuperRes "
+      "(default: 0,1)\n"
+      "  --strengths=<s>,<s>...     strengths of SuperRes, Upscale and "
+      "Denoising (default: 0,0.4)\n"
+      "  --out_res=<h>,<h>...       output heights of SuperRes and Upscale "
+      "(default: 1080,2160)\n"
+      "  --pipelines=<p>,<p>...     any of serial, pipeline<N>, async, "
+      "batch<N>\n"
+      "                             (default: serial,pipeline4,async,batch4)\n"
+      "  --frames=<N>               frames per run (default: 120)\n"
+      "  --warmup=<N>               leading frames left out of the "
+      "steady-state figures\n"
+      "                             (default: 10)\n"
+      "  --encode                   also encode the output, to include it in "
+      "the timing\n"
+      "  --model_dir=<path>         the path to the directory that contains "
+      "the models\n"
+      "  --out=<file>               write the results to a file, rather than "
+      "stdout\n"
+      "  --verbose                  verbose output\n");
+}
+
+static int ParseMyArgs(int argc, char** argv) {
+  int errs = 0;
+  for (--argc, ++argv; argc--; ++argv) {
+    bool help;
+    const char* arg = *argv;
+    if (arg[0] != '-') {
+      continue;
+    } else if ((arg[1] == '-') &&
+               (GetFlagArgVal("effects", arg, &FLAG_effects) ||
+                GetFlagArgVal("in_res", arg, &FLAG_inRes) ||
+                GetFlagArgVal("modes", arg, &FLAG_modes) ||
+                GetFlagArgVal("strengths", arg, &FLAG_strengths) ||
+                GetFlagArgVal("out_res", arg, &FLAG_outRes) ||
+                GetFlagArgVal("pipelines", arg, &FLAG_pipelines) ||
+                GetFlagArgVal("frames", arg, &FLAG_frames) ||
+                GetFlagArgVal("warmup", arg, &FLAG_warmup) ||
+                GetFlagArgVal("encode", arg, &FLAG_encode) ||
+                GetFlagArgVal("model_dir", arg, &FLAG_modelDir) ||
+                GetFlagArgVal("out", arg, &FLAG_out) ||
+                GetFlagArgVal("verbose", arg, &FLAG_verbose))) {
+      continue;
+    } else if (GetFlagArgVal("help", arg, &help)) {
+      return NVCV_ERR_HELP;
+    } else {
+      printf("Unknown flag: \"%s\"\n", arg);
+      ++errs;
+    }
+  }
+  return errs;
+}
+
+// A moving gradient with noise, so that the codec and the effects have
+// something to work on.
+static bool MakeSyntheticClip(const std::string& file, int width, int height,
+                              int frames) {
+  static const char* codecs[] = {"avc1", "H264", "MJPG"};  // Prefer H264
+  cv::VideoWriter writer;
+  for (const char* codec : codecs) {
+    if (writer.open(file, StringToFourcc(codec), 30., cv::Size(width, height)))
+      break;
+  }
+  if (!writer.isOpened()) return false;
+  cv::Mat frame(height, width, CV_8UC3), noise(height, width, CV_8UC3);
+  for (int n = 0; n < frames; ++n) {
+    for (int y = 0; y < height; ++y) {
+      unsigned char* p = frame.ptr<unsigned char>(y);
+      for (int x = 0; x < width; ++x, p += 3) {
+        p[0] = (unsigned char)(x + 4 * n);
+        p[1] = (unsigned char)(y + 2 * n);
+        p[2] = (unsigned char)(x + y);
+      }
+    }
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(8));
+    frame += noise;
+    writer.write(frame);
+  }
+  return true;
+}
+
+struct BenchConfig {
+  std::string effect, pipeline;
+  int inWidth, inHeight, mode, outHeight;
+  float strength;
+};
+
+static bool IsResizingEffect(const std::string& effect) {
+  return effect == NVVFX_FX_SUPER_RES || effect == NVVFX_FX_SR_UPSCALE;
+}
+
+static bool ParsePipeline(const std::string& pipeline, FlagInfo* finfo) {
+  if (pipeline == "serial") return true;
+  if (pipeline == "async") return (finfo->async = true);
+  if (!pipeline.compare(0, 8, "pipeline"))
+    return (finfo->pipelineDepth = atoi(pipeline.c_str() + 8)) > 1;
+  if (!pipeline.compare(0, 5, "batch"))
+    return (finfo->batchSize = atoi(pipeline.c_str() + 5)) > 0;
+  return false;
+}
+
+static void PrintPercentiles(FILE* fd, const char* name,
+                             std::vector<float> ms) {
+  std::sort(ms.begin(), ms.end());
+  auto pct = [&ms](double p) {  // nearest rank
+    size_t rank = (size_t)(p * ms.size() + 0.999999);
+    return ms[rank ? rank - 1 : 0];
+  };
+  fprintf(fd,
+          "\"%s\": {\"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, "
+          "\"max\": %.4f}",
+          name, pct(0.50), pct(0.90), pct(0.99), ms.back());
+}
+
+// Run one configuration, and write its results as one line of JSON.
+static void RunConfig(const BenchConfig& cfg, const std::string& inFile,
+                      const std::string& outFile, FILE* fd) {
+  typedef std::chrono::high_resolution_clock Clock;
+  const size_t warmup = (size_t)FLAG_warmup;
+  FXApp app;
+  FlagInfo finfo;
+  FXApp::Err fxErr;
+  double wallSecs = 0, secs;
+  std::vector<float> frameMs;
+  size_t n;
+  int stage;
+
+  finfo.codec = "MJPG";
+  finfo.mode = cfg.mode;
+  finfo.strength = cfg.strength;
+  finfo.resolution = cfg.outHeight;
+  finfo.verbose = FLAG_verbose;
+  finfo.collectStats = true;
+  ParsePipeline(cfg.pipeline, &finfo);
+
+  fxErr = app.createEffect(cfg.effect.c_str(), FLAG_modelDir.c_str());
+  if (FXApp::errNone == fxErr) {
+    Clock::time_point start = Clock::now();
+    fxErr = app.processMovie(inFile.c_str(), outFile.c_str(), finfo, nullptr);
+    wallSecs = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  fprintf(fd,
+          "{\"effect\": \"%s\", \"in_width\": %d, \"in_height\": %d, "
+          "\"out_height\": %d, \"mode\": %d, \"strength\": %.3f, "
+          "\"pipeline\": \"%s\", \"frames\": %d, \"status\": \"%s\"",
+          cfg.effect.c_str(), cfg.inWidth, cfg.inHeight,
+          cfg.outHeight ? cfg.outHeight : cfg.inHeight, cfg.mode, cfg.strength,
+          cfg.pipeline.c_str(), FLAG_frames, app.errorStringFromCode(fxErr));
+  if (FXApp::errNone != fxErr) {
+    fprintf(fd, "}\n");
+    return;
+  }
+
+  secs = wallSecs - app._loadSeconds;
+  fprintf(fd, ", \"load_ms\": %.3f, \"fps\": %.3f", 1e3 * app._loadSeconds,
+          (secs > 0) ? FLAG_frames / secs : 0.);
+
+  // The serial and pipelined modes time every stage of every frame; the others
+  // report throughput only.
+  for (stage = 0; stage < StageTimer::NUM_STAGES; ++stage) {
+    const std::vector<float>& samples = app._timer.samples(stage);
+    if (frameMs.size() < samples.size()) frameMs.resize(samples.size(), 0.f);
+    for (n = 0; n < samples.size(); ++n) frameMs[n] += samples[n];
+  }
+  if (frameMs.size() > warmup) {
+    double warmupMs = 0, steadyMs = 0;
+    const char* sep = "";
+    for (n = 0; n < warmup; ++n) warmupMs += frameMs[n];
+    for (; n < frameMs.size(); ++n) steadyMs += frameMs[n];
+    fprintf(fd, ", \"first_frame_ms\": %.3f, \"warmup_ms\": %.3f", frameMs[0],
+            warmupMs);
+    if (!finfo.pipelineDepth)  // Pipelined stages overlap, so do not add up
+      fprintf(fd, ", \"steady_fps\": %.3f",
+              1e3 * (frameMs.size() - warmup) / steadyMs);
+    fprintf(fd, ", ");
+    PrintPercentiles(
+        fd, "frame_ms",
+        std::vector<float>(frameMs.begin() + warmup, frameMs.end()));
+    fprintf(fd, ", \"stages_ms\": {");
+    for (stage = 0; stage < StageTimer::NUM_STAGES; ++stage) {
+      const std::vector<float>& samples = app._timer.samples(stage);
+      if (samples.size() <= warmup) continue;
+      fprintf(fd, "%s", sep);
+      PrintPercentiles(
+          fd, StageTimer::stageName(stage),
+          std::vector<float>(samples.begin() + warmup, samples.end()));
+      sep = ", ";
+    }
+    fprintf(fd, "}");
+  }
+  fprintf(fd, "}\n");
+  fflush(fd);
+}
+
+int main(int argc, char** argv) {
+  namespace fs = std::filesystem;
+  std::vector<std::string> effects, pipelines, inRes, modes, strengths, outRes,
+      noVariants(1, "0");
+  std::error_code ec;
+  fs::path tmpDir = fs::temp_directory_path(ec) / "VideoEffectsBench";
+  FILE* fd = stdout;
+  int nErrs, numRuns = 0;
+
+  nErrs = ParseMyArgs(argc, argv);
+  if (nErrs) {
+    Usage();
+    return (NVCV_ERR_HELP == nErrs) ? 0 : (int)FXApp::errFlag;
+  }
+  effects = SplitList(FLAG_effects, ',');
+  pipelines = SplitList(FLAG_pipelines, ',');
+  inRes = SplitList(FLAG_inRes, ',');
+  modes = SplitList(FLAG_modes, ',');
+  strengths = SplitList(FLAG_strengths, ',');
+  outRes = SplitList(FLAG_outRes, ',');
+  for (const std::string& pipeline : pipelines) {
+    FlagInfo finfo;
+    if (!ParsePipeline(pipeline, &finfo)) {
+      printf("Unknown pipeline \"%s\"\n", pipeline.c_str());
+      return (int)FXApp::errFlag;
+    }
+  }
+  if (!FLAG_out.empty() && !(fd = fopen(FLAG_out.c_str(), "w"))) {
+    printf("Cannot open \"%s\" for writing\n", FLAG_out.c_str());
+    return (int)FXApp::errWrite;
+  }
+  fs::create_directories(tmpDir, ec);
+
+  for (const std::string& res : inRes) {
+    BenchConfig cfg;
+    cfg.inHeight = atoi(res.c_str()) & ~1;
+    cfg.inWidth = (cfg.inHeight * 16 / 9 + 1) & ~1;
+    std::string inFile = (tmpDir / ("in_" + res + ".mp4")).string();
+    std::string outFile =
+        FLAG_encode ? (tmpDir / "out.avi").string() : std::string();
+    if (!MakeSyntheticClip(inFile, cfg.inWidth, cfg.inHeight, FLAG_frames)) {
+      printf("Cannot write the synthetic %dx%d clip \"%s\"\n", cfg.inWidth,
+             cfg.inHeight, inFile.c_str());
+      continue;
+    }
+    for (const std::string& effect : effects) {
+      const bool hasMode = (effect == NVVFX_FX_ARTIFACT_REDUCTION ||
+                            effect == NVVFX_FX_SUPER_RES);
+      const bool hasStrength =
+          IsResizingEffect(effect) || effect == NVVFX_FX_DENOISING;
+      cfg.effect = effect;
+      for (const std::string& mode : hasMode ? modes : noVariants) {
+        cfg.mode = atoi(mode.c_str());
+        for (const std::string& strength :
+             hasStrength ? strengths : noVariants) {
+          cfg.strength = strtof(strength.c_str(), nullptr);
+          for (const std::string& out :
+               IsResizingEffect(effect) ? outRes : noVariants) {
+            cfg.outHeight = atoi(out.c_str());
+            for (const std::string& pipeline : pipelines) {
+              cfg.pipeline = pipeline;
+              RunConfig(cfg, inFile, outFile, fd);
+              ++numRuns;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  fs::remove_all(tmpDir, ec);
+  if (fd != stdout) fclose(fd);
+  fprintf(stderr, "%d configurations\n", numRuns);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// Runs numbered frames through AsyncPingPong with the Transfer effect of the reference backend, and checks that each
+// set is retired in frame order with the result of the frame it was filled with.
+
+#include <cstdio>
+
+#include "AsyncPingPong.h"
+
+#define CHECK(x)                                                             \
+  do {                                                                       \
+    if (!(x)) {                                                              \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x);           \
+      return 1;                                                              \
+    }                                                                        \
+  } while (0)
+
+static const unsigned kWidth = 16, kHeight = 9, kFrames = 11;
+
+static unsigned char PixelValue(unsigned frameNum, unsigned x, unsigned y) {
+  return (unsigned char)(frameNum * 23 + x * 3 + y * 5);
+}
+
+static void FillFrame(NvCVImage *img, unsigned frameNum) {
+  for (unsigned y = 0; y < img->height; ++y) {
+    unsigned char *p = (unsigned char *)img->pixels + y * img->pitch;
+    for (unsigned x = 0; x < img->width * 3; ++x) p[x] = PixelValue(frameNum, x, y);
+  }
+}
+
+static bool FrameMatches(const NvCVImage *img, unsigned frameNum) {
+  for (unsigned y = 0; y < img->height; ++y) {
+    const unsigned char *p = (const unsigned char *)img->pixels + y * img->pitch;
+    for (unsigned x = 0; x < img->width * 3; ++x)
+      if (p[x] != PixelValue(frameNum, x, y)) return false;
+  }
+  return true;
+}
+
+static int RunFrames(NvVFX_Handle eff, CUstream stream) {
+  NvCVImage src(kWidth, kHeight, NVCV_BGR, NVCV_U8), dst(kWidth, kHeight, NVCV_BGR, NVCV_U8);
+  NvCVImage gpu(kWidth, kHeight, NVCV_BGR, NVCV_F32, NVCV_PLANAR, NVCV_GPU, 1), upTmp, downTmp;
+  AsyncPingPong pingPong;
+  unsigned frameNum, retired = 0;
+  bool held;
+
+  CHECK(NVCV_SUCCESS == pingPong.alloc(src, dst, gpu, 1, gpu, 1, stream));
+  for (frameNum = 0; frameNum < kFrames; ++frameNum) {
+    AsyncFrameSet &set = pingPong.set(frameNum);
+    CHECK(NVCV_SUCCESS == pingPong.retire(&set, &held));
+    CHECK(held == (frameNum >= 2));
+    if (held) {
+      CHECK(set.frameNum == retired);
+      CHECK(FrameMatches(&set.dstPinned, set.frameNum));
+      ++retired;
+    }
+    FillFrame(&set.srcPinned, frameNum);
+    CHECK(NVCV_SUCCESS == pingPong.enqueue(&set, frameNum, eff, &upTmp, &downTmp));
+  }
+  for (unsigned i = 0; i < 2; ++i) {  // Flush both sets, the older frame first
+    AsyncFrameSet &set = pingPong.set(frameNum + i);
+    CHECK(NVCV_SUCCESS == pingPong.retire(&set, &held));
+    CHECK(held && set.frameNum == retired);
+    CHECK(FrameMatches(&set.dstPinned, set.frameNum));
+    ++retired;
+  }
+  CHECK(retired == kFrames);
+  CHECK(NVCV_SUCCESS == pingPong.retire(&pingPong.set(0), &held) && !held);
+  pingPong.free();
+  return 0;
+}
+
+int main(int, char **) {
+  NvVFX_Handle eff = nullptr;
+  CUstream stream = nullptr;
+  CHECK(NVCV_SUCCESS == NvVFX_CreateEffect(NVVFX_FX_TRANSFER, &eff));
+  CHECK(NVCV_SUCCESS == NvVFX_CudaStreamCreate(&stream));
+  CHECK(NVCV_SUCCESS == NvVFX_SetCudaStream(eff, NVVFX_CUDA_STREAM, stream));
+  {  // The effect validates its images when loaded, so bind a pair of the right shape
+    NvCVImage in(kWidth, kHeight, NVCV_BGR, NVCV_F32, NVCV_PLANAR, NVCV_GPU, 1);
+    NvCVImage out(kWidth, kHeight, NVCV_BGR, NVCV_F32, NVCV_PLANAR, NVCV_GPU, 1);
+    CHECK(NVCV_SUCCESS == NvVFX_SetImage(eff, NVVFX_INPUT_IMAGE, &in));
+    CHECK(NVCV_SUCCESS == NvVFX_SetImage(eff, NVVFX_OUTPUT_IMAGE, &out));
+    CHECK(NVCV_SUCCESS == NvVFX_Load(eff));
+  }
+  if (RunFrames(eff, stream)) return 1;      // Upload, run and download on three streams
+  if (RunFrames(nullptr, stream)) return 1;  // The effect disabled
+  NvVFX_DestroyEffect(eff);
+  NvVFX_CudaStreamDestroy(stream);
+  printf("AsyncPingPong: OK\n");
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// Runs a ladder of SuperRes instances of the reference backend, as --deadline loads them, under a per-pixel and an
+// aggressive-mode latency, and checks that QualityController steps down through the ladder while another client
+// adds to the time of each frame, and settles back at the best level once it is gone. The times are kept well clear
+// of the deadline and of the headroom under it, since the latencies are sleeps, which a loaded machine lengthens.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "QualityController.h"
+#include "cuda_runtime_api.h"
+#include "nvCVImage.h"
+#include "nvVideoEffects.h"
+
+#define CHECK(x)                                                   \
+  do {                                                             \
+    if (!(x)) {                                                    \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+      return 1;                                                    \
+    }                                                              \
+  } while (0)
+
+static const unsigned kWidth = 32, kHeight = 18, kWindow = 5, kSettled = 3 * kWindow, kMaxFrames = 300;
+static const double kDeadlineMs = 40.;  // Stepping up needs under 30 ms
+static const std::chrono::milliseconds kContention(35);
+
+// Best first: 13.8 ms per frame at 4x, 4 ms more in aggressive mode, and 3.5 ms at 2x.
+static const struct {
+  unsigned mode, scale;
+} kLevels[] = {{1, 4}, {0, 4}, {0, 2}};
+static const unsigned kNumLevels = sizeof(kLevels) / sizeof(kLevels[0]);
+
+static void SetEnv(const char *name, const char *value) {
+#ifdef _WIN32
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 1);
+#endif
+}
+
+struct Level {
+  NvVFX_Handle eff = nullptr;
+  NvCVImage dst, out;
+};
+
+// Upload a frame, run the instance of the level and download its output, timed as FXApp times them.
+static double RunFrame(Level *lvl, NvCVImage *src, NvCVImage *srcGpu, CUstream stream, bool contended,
+                       NvCV_Status *err) {
+  auto start = std::chrono::steady_clock::now();
+  *err = NvCVImage_Transfer(src, srcGpu, 1.f / 255.f, stream, nullptr);
+  if (NVCV_SUCCESS == *err) *err = NvVFX_Run(lvl->eff, 0);
+  if (contended) std::this_thread::sleep_for(kContention);  // Another client shares the GPU
+  if (NVCV_SUCCESS == *err) *err = NvCVImage_Transfer(&lvl->dst, &lvl->out, 255.f, stream, nullptr);
+  if (NVCV_SUCCESS == *err && cudaSuccess != cudaStreamSynchronize(stream)) *err = NVCV_ERR_CUDA;
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int, char **) {
+  SetEnv("NVVFX_REF_PIXEL_LATENCY_NS", "1500");  // Read once, at the first NvVFX_Run()
+  SetEnv("NVVFX_REF_MODE_LATENCY_US", "4000");
+
+  NvCVImage src(kWidth, kHeight, NVCV_BGR, NVCV_U8);
+  NvCVImage srcGpu(kWidth, kHeight, NVCV_BGR, NVCV_F32, NVCV_PLANAR, NVCV_GPU, 1);
+  Level levels[kNumLevels];
+  QualityController quality;
+  CUstream stream = nullptr;
+  NvCV_Status err;
+  unsigned frameNum, level = 0, held = 0;
+
+  CHECK(NVCV_SUCCESS == NvVFX_CudaStreamCreate(&stream));
+  for (unsigned i = 0; i < kNumLevels; ++i) {
+    Level &lvl = levels[i];
+    unsigned w = kWidth * kLevels[i].scale, h = kHeight * kLevels[i].scale;
+    CHECK(NVCV_SUCCESS == NvCVImage_Alloc(&lvl.dst, w, h, NVCV_BGR, NVCV_F32, NVCV_PLANAR, NVCV_GPU, 1));
+    CHECK(NVCV_SUCCESS == NvCVImage_Alloc(&lvl.out, w, h, NVCV_BGR, NVCV_U8, NVCV_CHUNKY, NVCV_CPU_PINNED, 0));
+    CHECK(NVCV_SUCCESS == NvVFX_CreateEffect(NVVFX_FX_SUPER_RES, &lvl.eff));
+    CHECK(NVCV_SUCCESS == NvVFX_SetCudaStream(lvl.eff, NVVFX_CUDA_STREAM, stream));
+    CHECK(NVCV_SUCCESS == NvVFX_SetU32(lvl.eff, NVVFX_MODE, kLevels[i].mode));
+    CHECK(NVCV_SUCCESS == NvVFX_SetImage(lvl.eff, NVVFX_INPUT_IMAGE, &srcGpu));
+    CHECK(NVCV_SUCCESS == NvVFX_SetImage(lvl.eff, NVVFX_OUTPUT_IMAGE, &lvl.dst));
+    CHECK(NVCV_SUCCESS == NvVFX_Load(lvl.eff));
+  }
+  quality.init(kDeadlineMs, kNumLevels, kWindow);
+
+  // Contended, every level but the cheapest misses the deadline, so the controller steps down to it, one level at a
+  // time. Being late only ever makes this more certain.
+  for (frameNum = 0; frameNum < kMaxFrames && level + 1 < kNumLevels; ++frameNum) {
+    double ms = RunFrame(&levels[level], &src, &srcGpu, stream, true, &err);
+    CHECK(NVCV_SUCCESS == err);
+    unsigned next = quality.update(ms);
+    CHECK(next == level || next == level + 1);
+    level = next;
+  }
+  CHECK(level + 1 == kNumLevels);
+  CHECK(quality.switches() == kNumLevels - 1);
+
+  // Uncontended, every level has headroom but the best, which still keeps within the deadline, so the controller
+  // steps back up to it and settles there. A window slowed by a loaded machine may step it down again on the way,
+  // so only where it settles is checked.
+  for (frameNum = 0; frameNum < kMaxFrames && held < kSettled; ++frameNum) {
+    double ms = RunFrame(&levels[level], &src, &srcGpu, stream, false, &err);
+    CHECK(NVCV_SUCCESS == err);
+    level = quality.update(ms);
+    held = level ? 0 : held + 1;
+  }
+  CHECK(0 == level && held == kSettled);
+  CHECK(quality.switches() >= 2 * (kNumLevels - 1));
+
+  for (Level &lvl : levels) NvVFX_DestroyEffect(lvl.eff);
+  NvVFX_CudaStreamDestroy(stream);
+  printf("QualityController: OK\n");
+  return 0;
+}
@@ -0,0 +1,131 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+// Splits a synthetic video into segments, seeks to each with readers that seek exactly, to the preceding key frame,
+// past the frame requested, or not at all, and checks that the stitched output holds every frame once, in order, and
+// that each segment decoded its pre-roll.
+
+#include <cstdio>
+#include <vector>
+
+#include "SegmentedVideo.h"
+
+#define CHECK(x)                                                   \
+  do {                                                             \
+    if (!(x)) {                                                    \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+      return 1;                                                    \
+    }                                                              \
+  } while (0)
+
+enum SeekMode { SEEK_EXACT, SEEK_KEY_FRAME, SEEK_PAST, SEEK_FAILS };
+
+// A video whose frames hold their own index, with a key frame every keyInterval frames.
+struct FakeReader {
+  long long frameCount, keyInterval, pos = 0;
+  SeekMode mode;
+
+  bool seek(long long frame) {
+    switch (mode) {
+      case SEEK_EXACT:
+        pos = frame;
+        return true;
+      case SEEK_KEY_FRAME:
+        pos = frame / keyInterval * keyInterval;
+        return true;
+      case SEEK_PAST:
+        pos = frame + 1;
+        return true;
+      default:
+        return false;
+    }
+  }
+  long long position() { return pos; }
+  bool restart() {
+    pos = 0;
+    return true;
+  }
+  bool skip() { return pos < frameCount && ++pos; }
+  bool read(long long *frame) {
+    if (pos >= frameCount) return false;
+    *frame = pos++;
+    return true;
+  }
+};
+
+static int RunVideo(long long frameCount, unsigned numSegments, long long overlap, SeekMode mode) {
+  std::vector<VideoSegment> segments = SplitVideo(frameCount, numSegments, overlap);
+  std::vector<std::vector<long long>> outputs(numSegments);
+  std::vector<long long> preRolls(numSegments, 0), stitched;
+
+  CHECK(segments.size() == numSegments);
+  CHECK(segments[0].first == 0 && segments[0].begin == 0 && segments.back().end < 0);
+  bool ok = RunSegments(
+      numSegments,
+      [&](unsigned k) {
+        FakeReader reader{frameCount, 12, 0, mode};
+        const VideoSegment &seg = segments[k];
+        long long frame;
+        if (!SeekToFrame(reader, seg.first)) return false;
+        while ((seg.end < 0 || reader.position() < seg.end) && reader.read(&frame)) {
+          if (frame < seg.begin)
+            ++preRolls[k];
+          else
+            outputs[k].push_back(frame);
+        }
+        return true;
+      },
+      [&](unsigned k) {
+        stitched.insert(stitched.end(), outputs[k].begin(), outputs[k].end());
+        return true;
+      });
+  CHECK(ok);
+  CHECK((long long)stitched.size() == frameCount);
+  for (long long i = 0; i < frameCount; ++i) CHECK(stitched[i] == i);
+  for (unsigned k = 0; k < numSegments; ++k) CHECK(preRolls[k] == segments[k].begin - segments[k].first);
+  return 0;
+}
+
+int main(int, char **) {
+  static const SeekMode modes[] = {SEEK_EXACT, SEEK_KEY_FRAME, SEEK_PAST, SEEK_FAILS};
+  for (SeekMode mode : modes) {
+    if (RunVideo(100, 4, 0, mode) || RunVideo(100, 4, 5, mode) || RunVideo(101, 3, 40, mode) ||
+        RunVideo(7, 7, 2, mode) || RunVideo(50, 1, 3, mode))
+      return 1;
+  }
+
+  // A seek that cannot be satisfied fails, and a failed segment stops the stitching of it and all after it.
+  FakeReader shortReader{10, 4, 0, SEEK_FAILS};
+  unsigned numStitched = 0;
+  CHECK(!SeekToFrame(shortReader, 11));
+  CHECK(!RunSegments(
+      3, [](unsigned k) { return k != 1; },
+      [&](unsigned) {
+        ++numStitched;
+        return true;
+      }));
+  CHECK(1 == numStitched);
+
+  printf("SegmentedVideo: OK\n");
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __ASYNCPINGPONG_H__
+#define __ASYNCPINGPONG_H__
+
+#include "cuda_runtime_api.h"
+#include "nvCVImage.h"
+#include "nvVideoEffects.h"
+
+// The buffers of one of the two frames in flight in AsyncPingPong, and the events that mark its progress.
+struct AsyncFrameSet {
+  NvCVImage srcPinned, dstPinned;  // Filled by the caller, and read by the caller once retired
+  NvCVImage srcGpuBuf, dstGpuBuf;
+  cudaEvent_t uploaded = nullptr, ran = nullptr, downloaded = nullptr;
+  unsigned frameNum = 0;
+  bool pending = false;  // Work has been enqueued, but the set not yet retired
+};
+
+// Double-buffered scheduling of frames through three streams: an upload stream, the effect's stream and a download
+// stream, chained with events. Frames alternate between two sets of buffers, so frame N+1 is uploaded while frame N
+// runs and frame N-1 is downloaded, and the host decodes and encodes while the GPU is busy. Set N % 2 is retired
+// (its download waited on) before it is refilled with frame N; that single host wait also guarantees that frame N-2
+// is done with all of the set's buffers, since its download was enqueued behind its run, which was enqueued behind
+// its upload.
+class AsyncPingPong {
+ public:
+  ~AsyncPingPong() { free(); }
+
+  // Allocate both sets, with pinned host buffers shaped like src and dst, and GPU buffers like srcGpu and dstGpu.
+  // The effect is run on runStream; the upload and download streams are created here.
+  NvCV_Status alloc(const NvCVImage &src, const NvCVImage &dst, const NvCVImage &srcGpu, unsigned srcAlignment,
+                    const NvCVImage &dstGpu, unsigned dstAlignment, CUstream runStream) {
+    NvCV_Status err;
+    _runStream = runStream;
+    if (NVCV_SUCCESS != (err = NvVFX_CudaStreamCreate(&_upStream))) return err;
+    if (NVCV_SUCCESS != (err = NvVFX_CudaStreamCreate(&_downStream))) return err;
+    for (AsyncFrameSet &set : _sets) {
+      if (NVCV_SUCCESS != (err = NvCVImage_Alloc(&set.srcPinned, src.width, src.height, src.pixelFormat,
+                                                 src.componentType, src.planar, NVCV_CPU_PINNED, 0)) ||
+          NVCV_SUCCESS != (err = NvCVImage_Alloc(&set.dstPinned, dst.width, dst.height, dst.pixelFormat,
+                                                 dst.componentType, dst.planar, NVCV_CPU_PINNED, 0)) ||
+          NVCV_SUCCESS != (err = NvCVImage_Alloc(&set.srcGpuBuf, srcGpu.width, srcGpu.height, srcGpu.pixelFormat,
+                                                 srcGpu.componentType, srcGpu.planar, NVCV_GPU, srcAlignment)) ||
+          NVCV_SUCCESS != (err = NvCVImage_Alloc(&set.dstGpuBuf, dstGpu.width, dstGpu.height, dstGpu.pixelFormat,
+                                                 dstGpu.componentType, dstGpu.planar, NVCV_GPU, dstAlignment)))
+        return err;
+      if (cudaSuccess != cudaEventCreateWithFlags(&set.uploaded, cudaEventDisableTiming) ||
+          cudaSuccess != cudaEventCreateWithFlags(&set.ran, cudaEventDisableTiming) ||
+          cudaSuccess != cudaEventCreateWithFlags(&set.downloaded, cudaEventDisableTiming))
+        return NVCV_ERR_CUDA;
+    }
+    return NVCV_SUCCESS;
+  }
+
+  // Wait for all work to finish, and free everything but the run stream, which belongs to the caller.
+  void free() {
+    synchronize();
+    for (AsyncFrameSet &set : _sets) {
+      if (set.uploaded) cudaEventDestroy(set.uploaded);
+      if (set.ran) cudaEventDestroy(set.ran);
+      if (set.downloaded) cudaEventDestroy(set.downloaded);
+      set.uploaded = set.ran = set.downloaded = nullptr;
+      set.pending = false;
+      NvCVImage_Dealloc(&set.srcPinned);
+      NvCVImage_Dealloc(&set.dstPinned);
+      NvCVImage_Dealloc(&set.srcGpuBuf);
+      NvCVImage_Dealloc(&set.dstGpuBuf);
+    }
+    if (_upStream) NvVFX_CudaStreamDestroy(_upStream);
+    if (_downStream) NvVFX_CudaStreamDestroy(_downStream);
+    _upStream = _downStream = nullptr;
+  }
+
+  void synchronize() {
+    if (_upStream) cudaStreamSynchronize(_upStream);
+    if (_runStream) cudaStreamSynchronize(_runStream);
+    if (_downStream) cudaStreamSynchronize(_downStream);
+  }
+
+  AsyncFrameSet &set(unsigned frameNum) { return _sets[frameNum & 1]; }
+
+  // Wait for the download of the frame that the set holds, if it holds one, after which its dstPinned may be read
+  // and its srcPinned refilled. *held tells whether it held one.
+  NvCV_Status retire(AsyncFrameSet *set, bool *held) {
+    *held = set->pending;
+    if (!set->pending) return NVCV_SUCCESS;
+    set->pending = false;
+    return (cudaSuccess == cudaEventSynchronize(set->downloaded)) ? NVCV_SUCCESS : NVCV_ERR_CUDA;
+  }
+
+  // Upload the set's srcPinned, run the effect on it, and download the result into its dstPinned, or, without an
+  // effect, convert srcPinned straight into dstPinned. The set must have been retired.
+  NvCV_Status enqueue(AsyncFrameSet *set, unsigned frameNum, NvVFX_Handle eff, NvCVImage *upTmp,
+                      NvCVImage *downTmp) {
+    NvCV_Status err;
+    if (eff) {
+      if (NVCV_SUCCESS != (err = NvCVImage_Transfer(&set->srcPinned, &set->srcGpuBuf, 1.f / 255.f, _upStream, upTmp)))
+        return err;
+      if (cudaSuccess != cudaEventRecord(set->uploaded, _upStream) ||
+          cudaSuccess != cudaStreamWaitEvent(_runStream, set->uploaded, 0))
+        return NVCV_ERR_CUDA;
+      if (NVCV_SUCCESS != (err = NvVFX_SetImage(eff, NVVFX_INPUT_IMAGE, &set->srcGpuBuf)) ||
+          NVCV_SUCCESS != (err = NvVFX_SetImage(eff, NVVFX_OUTPUT_IMAGE, &set->dstGpuBuf)) ||
+          NVCV_SUCCESS != (err = NvVFX_Run(eff, 1)))
+        return err;
+      if (cudaSuccess != cudaEventRecord(set->ran, _runStream) ||
+          cudaSuccess != cudaStreamWaitEvent(_downStream, set->ran, 0))
+        return NVCV_ERR_CUDA;
+      if (NVCV_SUCCESS != (err = NvCVImage_Transfer(&set->dstGpuBuf, &set->dstPinned, 255.f, _downStream, downTmp)))
+        return err;
+    } else if (NVCV_SUCCESS != (err = NvCVImage_Transfer(&set->srcPinned, &set->dstPinned, 1.f, _downStream,
+                                                          downTmp))) {
+      return err;
+    }
+    if (cudaSuccess != cudaEventRecord(set->downloaded, _downStream)) return NVCV_ERR_CUDA;
+    set->frameNum = frameNum;
+    set->pending = true;
+    return NVCV_SUCCESS;
+  }
+
+ private:
+  AsyncFrameSet _sets[2];
+  CUstream _upStream = nullptr, _downStream = nullptr, _runStream = nullptr;
+};
+
+#endif  // __ASYNCPINGPONG_H__
@@ -0,0 +1,51 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __BATCHUTILITIES_H__
+#define __BATCHUTILITIES_H__
+
+#include <cstddef>
+
+#include "nvCVImage.h"
+
+// A batch of images is stored as one tall image: batchSize images of the given height, stacked vertically.
+// For planar images, each image in the batch has all of its planes contiguous, i.e. [B][G][R][B][G][R]...,
+// which is why the batch is not simply a planar image of height (height * batchSize).
+inline NvCV_Status AllocateBatchBuffer(NvCVImage *im, unsigned batchSize, unsigned width, unsigned height,
+                                       NvCVImage_PixelFormat format, NvCVImage_ComponentType type, unsigned layout,
+                                       unsigned memSpace, unsigned alignment) {
+  return NvCVImage_Alloc(im, width, height * batchSize, format, type, layout, memSpace, alignment);
+}
+
+// Initialize a view of the nth image in a batch buffer allocated with AllocateBatchBuffer().
+// No memory is allocated. The returned view is suitable for NvVFX_SetImage() and NvCVImage_Transfer().
+inline NvCVImage *NthImage(unsigned n, unsigned height, NvCVImage *full, NvCVImage *view) {
+  unsigned rows = (NVCV_PLANAR == full->planar) ? height * full->numComponents : height;
+  NvCVImage_InitView(view, full, 0, 0, full->width, full->height);  // A shallow copy works for all layouts
+  view->height = height;
+  view->pixels = (unsigned char *)full->pixels + (size_t)n * rows * full->pitch;
+  view->bufferBytes = (unsigned long long)rows * full->pitch;
+  return view;
+}
+
+#endif  // __BATCHUTILITIES_H__
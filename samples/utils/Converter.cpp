@@ -21,13 +21,37 @@ OUT OF OR IN # CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 #
 ###############################################################################*/
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "AsyncPingPong.h"
+#include "BatchUtilities.h"
+#include "FrameQueue.h"
+#include "FrameSignature.h"
+#include "ImagePool.h"
+#include "LatencyTrace.h"
+#include "QualityController.h"
+#include "RawVideo.h"
+#include "ResultCache.h"
+#include "RoiTrack.h"
+#include "SegmentedVideo.h"
+#include "StageTimer.h"
+#include "cuda_runtime_api.h"
 #include "nvCVOpenCV.h"
 #include "nvVideoEffects.h"
 #include "opencv2/opencv.hpp"
 
+#ifdef _MSC_VER
 #define strcasecmp _stricmp
 #include <Windows.h>
 #include <shellapi.h>
+#else  // !_MSC_VER
+#define sscanf_s sscanf
+#endif  // _MSC_VER
 
 #define BAIL_IF_ERR(err) \
   do {                   \
@@ -49,6 +73,30 @@ struct FlagInfo {
   float strength;
   int mode;
   int resolution;
+  int pipelineDepth = 0;  // Frames in flight in the decode/effect/encode pipeline; 0 or 1 runs serially
+  bool async = false;     // Double-buffered asynchronous upload/run/download on dedicated CUDA streams
+  int batchSize = 0;      // Frames per NvVFX_Run(); 0 runs one frame at a time without batch buffers
+  int modelBatch = 0;     // NVVFX_MODEL_BATCH; 0 chooses batchSize
+  int segments = 0;       // Process a movie as this many concurrent segments
+  int overlap = 0;        // Pre-roll frames processed, but not written, before each segment
+  int poolMB = 0;         // Cap on the size of the buffer pool; 0 for no cap
+  std::string statsFile;  // JSON summary of per-stage frame times
+  std::string statsCsv;   // Per-frame stage times
+  bool collectStats = false;  // Time stages without reporting, for FXApp::_timer users
+  std::string yuv;            // "nv12" or "i420": keep video frames in YUV 4:2:0
+  std::string yuvColorspace;  // e.g. "709,video,cosited"; empty chooses by size
+  std::string rawFormat;      // e.g. "nv12:1920x1080@30", of headerless video
+  std::string roiFile;        // Per-frame regions to run the effect on; the rest is resampled
+  float skipDuplicates = -1.f;  // Mean level difference within which a frame repeats the last; < 0 runs every frame
+  int dirtyTile = 0;          // Tile size of incremental processing of video; 0 runs whole frames
+  int dirtyRefresh = 60;      // With dirtyTile, run every this many frames whole; 0 never does
+  std::string cacheDir;       // Store of results, addressed by their input and settings; empty for none
+  int cacheMB = 1024;         // Bound on the size of the store
+  float deadline = -1.f;      // Time per frame, in ms, to keep the effect within; 0 for the frame period, < 0 for none
+  bool realtime = false;      // Read a video file at its frame rate, as a camera delivers, processing the newest frame
+  bool latency = false;         // Report histograms of the latency of frames from capture to output
+  bool latencyOverlay = false;  // Draw the latency of each frame, so far, on it as it is output
+  std::string traceFile;        // Chrome trace of the latency of each frame
   std::string codec;
   std::string camRes;
 };
@@ -87,6 +135,20 @@ static bool IsLossyImageFile(const char *str) {
   return HasOneOfTheseSuffixes(str, ".jpg", ".jpeg", nullptr);
 }
 
+static bool IsY4MFile(const char *str) { return HasSuffix(str, ".y4m"); }
+
+// Uncompressed frames without a header, described by --raw_format.
+static bool IsHeaderlessVideoFile(const char *str) {
+  return HasOneOfTheseSuffixes(str, ".yuv", ".raw", ".nv12", ".i420", ".rgb",
+                               ".bgr", ".rgba", nullptr);
+}
+
+// Video that is read with RawVideoReader and written with RawVideoWriter,
+// including "-", standard input or output.
+static bool IsRawVideoFile(const char *str) {
+  return IsY4MFile(str) || IsHeaderlessVideoFile(str) || IsStdioPath(str);
+}
+
 static const char *DurationString(double sc) {
   static char buf[16];
   int hr, mn;
@@ -106,6 +168,20 @@ struct VideoInfo {
   long long frameCount;
 };
 
+static void PrintVideoInfo(const char *fileName, const VideoInfo &vinfo) {
+  printf(
+      "       file \"%s\"\n"
+      "      codec %.4s\n"
+      "      width %4d\n"
+      "     height %4d\n"
+      " frame rate %.3f\n"
+      "frame count %4lld\n"
+      "   duration %s\n",
+      fileName, (const char *)&vinfo.codec, vinfo.width, vinfo.height,
+      vinfo.frameRate, vinfo.frameCount,
+      DurationString(vinfo.frameCount / vinfo.frameRate));
+}
+
 static void GetVideoInfo(cv::VideoCapture &reader, const char *fileName,
                          VideoInfo *vinfo, const FlagInfo &finfo) {
   vinfo->codec = (int)reader.get(cv::CAP_PROP_FOURCC);
@@ -113,18 +189,7 @@ static void GetVideoInfo(cv::VideoCapture &reader, const char *fileName,
   vinfo->height = (int)reader.get(cv::CAP_PROP_FRAME_HEIGHT);
   vinfo->frameRate = (double)reader.get(cv::CAP_PROP_FPS);
   vinfo->frameCount = (long long)reader.get(cv::CAP_PROP_FRAME_COUNT);
-  if (finfo.verbose)
-    printf(
-        "       file \"%s\"\n"
-        "      codec %.4s\n"
-        "      width %4d\n"
-        "     height %4d\n"
-        " frame rate %.3f\n"
-        "frame count %4lld\n"
-        "   duration %s\n",
-        fileName, (char *)&vinfo->codec, vinfo->width, vinfo->height,
-        vinfo->frameRate, vinfo->frameCount,
-        DurationString(vinfo->frameCount / vinfo->frameRate));
+  if (finfo.verbose) PrintVideoInfo(fileName, *vinfo);
 }
 
 static int StringToFourcc(const std::string &str) {
@@ -137,8 +202,143 @@ static int StringToFourcc(const std::string &str) {
   return x.i;
 }
 
+// The NvCVImage layout of the 4:2:0 frames named by --yuv, or 0 if there are
+// none.
+static unsigned YUVLayoutFromName(const std::string &name) {
+  if (!strcasecmp(name.c_str(), "nv12")) return NVCV_NV12;
+  if (!strcasecmp(name.c_str(), "i420")) return NVCV_I420;
+  return 0;
+}
+
+// Parse a comma-separated --yuv_colorspace, e.g. "709,video,cosited", into
+// NvCVImage colorspace bits. Unspecified axes default to those of H.264:
+// Rec.709 for HD, otherwise Rec.601, video range, and MPEG-2 chroma siting.
+static bool ParseYUVColorspace(const std::string &spec, unsigned height,
+                               unsigned *colorspace) {
+  unsigned axes = (height >= 720) ? NVCV_709 : NVCV_601,
+           range = NVCV_VIDEO_RANGE, chroma = NVCV_CHROMA_MPEG2;
+  size_t begin = 0, end;
+  while (begin < spec.size()) {
+    end = spec.find(',', begin);
+    if (end == std::string::npos) end = spec.size();
+    std::string word = spec.substr(begin, end - begin);
+    begin = end + 1;
+    if (word == "601" || word == "bt601") axes = NVCV_601;
+    else if (word == "709" || word == "bt709") axes = NVCV_709;
+    else if (word == "2020" || word == "bt2020") axes = NVCV_2020;
+    else if (word == "video" || word == "limited") range = NVCV_VIDEO_RANGE;
+    else if (word == "full") range = NVCV_FULL_RANGE;
+    else if (word == "cosited" || word == "mpeg2") chroma = NVCV_CHROMA_MPEG2;
+    else if (word == "interstitial" || word == "mpeg1" || word == "jpeg")
+      chroma = NVCV_CHROMA_INTERSTITIAL;
+    else if (word == "topleft") chroma = NVCV_CHROMA_TOPLEFT;
+    else {
+      printf("Unknown colorspace \"%s\"\n", word.c_str());
+      return false;
+    }
+  }
+  *colorspace = axes | range | chroma;
+  return true;
+}
+
+static NvCV_Status CudaStatus(cudaError_t err) {
+  return (cudaSuccess == err) ? NVCV_SUCCESS : NVCV_ERR_CUDA;
+}
+
 typedef void (*progressCallback)(float percentComplete);
 
+// One recycled frame in the decode --> effect --> encode pipeline.
+// The cv::Mats are allocated once, and the NvCVImages alias them.
+struct PipelineSlot {
+  cv::Mat srcImg;
+  cv::Mat dstImg;
+  NvCVImage srcVFX;
+  NvCVImage dstVFX;
+  unsigned frameNum;
+  LatencyTrace::Stamps stamps;
+};
+
+// An image in flight through processImages(); index is into the file lists.
+struct ImageSlot {
+  cv::Mat img;
+  size_t index = 0;
+};
+
+// One input video of processMovies(), with its own writer and effect state.
+struct MuxStream {
+  cv::VideoCapture reader;
+  cv::VideoWriter writer;
+  VideoInfo vinfo;
+  NvVFX_StateObjectHandle state = nullptr;
+  bool write = false;
+};
+
+// An effect after the first one in a chain. Its input is the output of the
+// previous effect, converted on the GPU only if the two effects' buffer
+// formats differ.
+struct ChainLink {
+  NvVFX_Handle eff = nullptr;
+  std::string name;
+  NvVFX_StateObjectHandle state = nullptr;
+  NvCVImage in;       // The input of this effect
+  NvCVImage prevOut;  // The output of the previous effect, if convert
+  NvCVImage *pooledIn = nullptr, *pooledPrevOut = nullptr;
+  bool convert = false;
+};
+
+// One of the fixed shapes that regions of interest are grown to, with its own
+// instance of the effect, loaded for that shape, and its own buffers, so that
+// regions of any size are processed without reloading or reallocating.
+struct RoiBucket {
+  unsigned width = 0, height = 0;  // Of the source window
+  NvVFX_Handle eff = nullptr;
+  NvCVImage src, dst;  // GPU
+  NvCVImage *srcPooled = nullptr, *dstPooled = nullptr;
+  NvCVImage out;    // The effect output, downloaded for compositing
+  NvCVImage matte;  // Feathered along the edges that are within the frame
+  unsigned matteEdges = ~0u;
+  unsigned long long regions = 0;
+};
+
+// Incremental processing with --dirty_tiles: the frame is divided into a grid
+// of tiles, and only the tiles that have changed are run through a second
+// instance of the effect, loaded for a tile and its halo, into the output of
+// the last whole frame, which is kept in _dstGpuBuf.
+struct DirtyTiles {
+  unsigned tile = 0, halo = 0;  // Source pixels
+  unsigned windowWidth = 0, windowHeight = 0;  // A tile and its halo
+  unsigned cols = 0, rows = 0;
+  unsigned num = 1, den = 1;  // The scale of the effect
+  NvVFX_Handle eff = nullptr;
+  NvCVImage src, dst;  // GPU
+  NvCVImage *srcPooled = nullptr, *dstPooled = nullptr;
+  cv::Mat refImg;  // The source as of when each tile was last run
+  std::vector<unsigned> changed;  // The indices of the tiles of this frame
+  bool valid = false;  // Whether _dstVFX is the output of refImg
+  unsigned sinceWhole = 0;  // Frames since the last whole one
+  unsigned long long wholeFrames = 0, partialFrames = 0, tilesRun = 0;
+};
+
+// An instance of the effect loaded for a level of the --deadline ladder, other
+// than the one asked for, so that switching to it needs no NvVFX_Load(). Its
+// input is _srcGpuBuf.
+struct QualityInstance {
+  NvVFX_Handle eff = nullptr;
+  NvCVImage dst;  // GPU
+  NvCVImage *dstPooled = nullptr;
+  NvCVImage out;   // The effect output, downloaded to be resized
+  cv::Mat outImg;  // Aliases out
+};
+
+// A configuration of the effects that --deadline steps through.
+struct QualityLevel {
+  int mode;
+  int resolution;
+  bool alternate;  // Run the effects on every other frame only
+  QualityInstance *instance = nullptr;  // Null for the effects as loaded
+  unsigned long long frames = 0;        // Processed at this level
+};
+
 struct FXApp {
   enum Err {
     errQuit = +1,  // Application errors
@@ -179,24 +379,102 @@ struct FXApp {
 
   FXApp() {
     _eff = nullptr;
+    _state = nullptr;
     _effectName = nullptr;
     _inited = false;
+    _srcPooled = nullptr;
+    _dstPooled = nullptr;
     _showFPS = false;
     _show = false;
     _enableEffect = true, _drawVisualization = true, _framePeriod = 0.f;
+    _srcYUVImg.allocator = &_hostAllocator;
   }
-  ~FXApp() { NvVFX_DestroyEffect(_eff); }
+  ~FXApp() { destroyEffect(); }
 
   void setShow(bool show) { _show = show; }
   Err createEffect(const char *effectSelector, const char *modelDir);
   void destroyEffect();
+  NvCV_Status setEffectParams(const FlagInfo &finfo, CUstream stream);
+  NvCV_Status bindEffectImages();
+  NvCV_Status loadEffects();
+  NvCV_Status runEffects(CUstream stream, size_t done = 0);
+  NvCV_Status bindSingleStreamState();
   NvCV_Status allocBuffers(unsigned width, unsigned height,
                            const FlagInfo &finfo);
   NvCV_Status allocTempBuffers();
+  NvCV_Status allocGpuBuf(NvCVImage *view, NvCVImage **pooled, unsigned width,
+                          unsigned height, NvCVImage_PixelFormat format,
+                          NvCVImage_ComponentType type, unsigned layout,
+                          unsigned memSpace, unsigned alignment);
+  void printPoolStats();
+  void beginStats(const FlagInfo &finfo, long long expectedFrames);
+  Err endStats(const FlagInfo &finfo, unsigned long long frames,
+               unsigned long long repeated = 0);
   Err processImage(const char *inFile, const char *outFile,
                    const FlagInfo &finfo, progressCallback cb);
+  NvCV_Status chainOutputSize(unsigned width, unsigned height,
+                              const FlagInfo &finfo, unsigned *dstWidth,
+                              unsigned *dstHeight);
+  NvCV_Status processTiles(const cv::Mat &src, cv::Mat *dst,
+                           const FlagInfo &finfo, CUstream stream,
+                           progressCallback cb);
+  NvCV_Status allocRoiBuckets(const FlagInfo &finfo, CUstream stream);
+  void freeRoiBuckets();
+  NvCV_Status processRegions(const NvCVImage *src,
+                             const std::vector<RoiRect> &regions,
+                             CUstream stream);
+  void printRoiStats();
+  NvCV_Status allocDirtyTiles(const FlagInfo &finfo, CUstream stream);
+  void freeDirtyTiles();
+  NvCV_Status processDirtyTiles(const NvCVImage *src, unsigned refresh,
+                                CUstream stream);
+  void printDirtyTileStats();
+  bool openCache(const FlagInfo &finfo);
+  const std::string &modelDirHash();
+  std::string cacheKey(const std::string &content, size_t numEffects,
+                       const FlagInfo &finfo);
+  NvCV_Status resumeFromCache(const std::string &content,
+                              const FlagInfo &finfo, CUstream stream,
+                              size_t *done);
+  NvCV_Status cacheStages(const std::string &content, const FlagInfo &finfo,
+                          CUstream stream, size_t done);
+  bool chainHasMode() const;
+  void buildQualityLadder(const FlagInfo &finfo, unsigned height,
+                          bool resize);
+  std::string describeQualityLevel(unsigned level) const;
+  NvCV_Status allocQualityInstances(const FlagInfo &finfo, CUstream stream);
+  void freeQualityInstances();
+  void printQualityStats(const QualityController &controller);
+  Err processImages(const std::vector<std::string> &inFiles,
+                    const std::vector<std::string> &outFiles,
+                    const FlagInfo &finfo, progressCallback cb);
   Err processMovie(const char *inFile, const char *outFile,
                    const FlagInfo &finfo, progressCallback cb);
+  Err processMovieCached(const char *inFile, const char *outFile,
+                         const FlagInfo &finfo, progressCallback cb);
+  Err processMoviePipelined(cv::VideoCapture &reader, cv::VideoWriter &writer,
+                            bool write, const VideoInfo &vinfo,
+                            const FlagInfo &finfo, progressCallback cb);
+  Err processMovies(const std::vector<std::string> &inFiles,
+                    const std::vector<std::string> &outFiles,
+                    const FlagInfo &finfo, progressCallback cb);
+  Err processMovieSegments(const char *inFile, const char *outFile,
+                           const FlagInfo &finfo, progressCallback cb);
+  Err processMovieSegment(const char *inFile, const VideoSegment &segment,
+                          const FlagInfo &finfo, cv::VideoWriter &writer,
+                          std::atomic<long long> *framesDone,
+                          long long totalFrames, progressCallback cb);
+  Err processMovieBatched(cv::VideoCapture &reader, cv::VideoWriter &writer,
+                          bool write, const VideoInfo &vinfo,
+                          const FlagInfo &finfo, progressCallback cb);
+  NvCV_Status allocBatchBuffers(unsigned batchSize);
+  Err processMovieAsync(cv::VideoCapture &reader, cv::VideoWriter &writer,
+                        bool write, CUstream runStream, const VideoInfo &vinfo,
+                        const FlagInfo &finfo, progressCallback cb);
+  Err retireAsyncFrameSet(AsyncPingPong &pingPong, AsyncFrameSet *set,
+                          cv::Mat &dstImg, cv::VideoWriter &writer,
+                          bool write, const VideoInfo &vinfo,
+                          const FlagInfo &finfo, progressCallback cb);
   Err initCamera(cv::VideoCapture &cap, const FlagInfo &finfo);
   Err processKey(int key, const FlagInfo &finfo);
   void drawFrameRate(cv::Mat &img);
@@ -205,21 +483,50 @@ struct FXApp {
   const char *errorStringFromCode(Err code);
 
   NvVFX_Handle _eff;
+  NvVFX_StateObjectHandle _state;  // For a single stream of a stateful effect
+  PinnedMatAllocator _hostAllocator;  // Must outlive the Mats below
   cv::Mat _srcImg;
   cv::Mat _dstImg;
+  StageTimer _timer;
+  LatencyTrace _trace;  // With --latency, --latency_overlay or --trace_file
+  NvCVImagePool _pool;  // Must outlive the views below
+  NvCVImage *_srcPooled;  // The pool buffers that _srcGpuBuf and _dstGpuBuf
+  NvCVImage *_dstPooled;  // are views of
   NvCVImage _srcGpuBuf;
   NvCVImage _dstGpuBuf;
   NvCVImage _srcVFX;
   NvCVImage _dstVFX;
   NvCVImage _tmpVFX;  // We use the same temporary buffer for source and dst,
                       // since it auto-shapes as needed
+  NvCVImage _tmpDstVFX;  // The async mode downloads on its own stream, so it
+                         // needs a second temporary buffer
+  NvCVImage _srcBatchBuf;  // batchSize images shaped like _srcGpuBuf
+  NvCVImage _dstBatchBuf;  // batchSize images shaped like _dstGpuBuf
+  cv::Mat _srcYUVImg;  // With --yuv, decoded 4:2:0 frames, Y above the chroma
+  unsigned _yuvLayout = 0;  // NVCV_NV12 or NVCV_I420 with --yuv, otherwise 0
+  unsigned _yuvColorspace = 0;
   bool _show;
   bool _inited;
   bool _showFPS;
   bool _enableEffect;
   bool _drawVisualization;
-  const char *_effectName;
+  const char *_effectName;  // The first effect in the chain
+  std::string _firstEffectName;
+  std::string _effectSpec;  // All of them, e.g. "ArtifactReduction,SuperRes"
+  std::string _modelDir;
+  std::deque<ChainLink> _chain;  // The effects after the first; a deque since
+                                 // its elements must not move
+  std::deque<RoiBucket> _roiBuckets;  // Smallest first, with --roi_file
+  unsigned _roiNum = 1, _roiDen = 1;  // The scale of the effect
+  unsigned long long _roiFullFrames = 0, _roiFrames = 0;
+  unsigned long long _roiPixels = 0;  // Source pixels run through the effect
+  DirtyTiles _dirty;  // With --dirty_tiles
+  ResultCache _cache;  // With --cache_dir
+  std::string _modelDirHash;  // Of the contents of _modelDir, once computed
+  std::vector<QualityLevel> _quality;  // Best first, with --deadline
+  std::deque<QualityInstance> _qualityInstances;
   float _framePeriod;
+  float _loadSeconds = 0.f;  // The time taken by the last loadEffects()
   std::chrono::high_resolution_clock::time_point _lastTime;
 };
 
@@ -265,6 +572,15 @@ void FXApp::drawFrameRate(cv::Mat &img) {
   _lastTime = now;
 }
 
+// With --latency_overlay, the time since the frame was captured, in the top
+// left corner, where it does not collide with the frame rate.
+static void DrawLatency(cv::Mat &img, float ms) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.1f ms", ms);
+  cv::putText(img, buf, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1,
+              cv::Scalar(255, 255, 255), 1);
+}
+
 FXApp::Err FXApp::processKey(int key, const FlagInfo &finfo) {
   static const int ESC_KEY = 27;
   switch (key) {
@@ -327,24 +643,208 @@ void FXApp::drawEffectStatus(cv::Mat &img) {
               1, cv::Scalar(255, 255, 255), 1);
 }
 
-FXApp::Err FXApp::createEffect(const char *effectSelector,
-                               const char *modelDir) {
+static NvCV_Status CreateOneEffect(const char *effectSelector,
+                                   const char *modelDir, NvVFX_Handle *eff) {
   NvCV_Status vfxErr;
-  BAIL_IF_ERR(vfxErr = NvVFX_CreateEffect(effectSelector, &_eff));
-  _effectName = effectSelector;
+  BAIL_IF_ERR(vfxErr = NvVFX_CreateEffect(effectSelector, eff));
   // Do not set NVVFX_MODEL_DIRECTORY for NVVFX_FX_SR_UPSCALE feature as it is
   // not a valid selector for that feature
-  if (modelDir[0] != '\0' && strcmp(_effectName, NVVFX_FX_SR_UPSCALE)) {
+  if (modelDir[0] != '\0' && strcmp(effectSelector, NVVFX_FX_SR_UPSCALE)) {
     BAIL_IF_ERR(vfxErr =
-                    NvVFX_SetString(_eff, NVVFX_MODEL_DIRECTORY, modelDir));
+                    NvVFX_SetString(*eff, NVVFX_MODEL_DIRECTORY, modelDir));
+  }
+bail:
+  return vfxErr;
+}
+
+// effectSelector is one effect, or a comma-separated chain of them, applied in
+// order, e.g. "ArtifactReduction,SuperRes".
+FXApp::Err FXApp::createEffect(const char *effectSelector,
+                               const char *modelDir) {
+  NvCV_Status vfxErr;
+  size_t begin, end;
+
+  destroyEffect();
+  _effectSpec = effectSelector;
+  _modelDir = modelDir;
+  end = _effectSpec.find(',');
+  _firstEffectName = _effectSpec.substr(0, end);
+  _effectName = _firstEffectName.c_str();
+  BAIL_IF_ERR(vfxErr = CreateOneEffect(_effectName, modelDir, &_eff));
+  while (end != std::string::npos) {
+    begin = end + 1;
+    end = _effectSpec.find(',', begin);
+    _chain.emplace_back();
+    _chain.back().name = _effectSpec.substr(begin, end - begin);
+    BAIL_IF_ERR(vfxErr = CreateOneEffect(_chain.back().name.c_str(), modelDir,
+                                         &_chain.back().eff));
   }
 bail:
   return appErrFromVfxStatus(vfxErr);
 }
 
 void FXApp::destroyEffect() {
+  freeRoiBuckets();
+  freeQualityInstances();
+  freeDirtyTiles();
+  for (ChainLink &link : _chain) {
+    if (link.state) NvVFX_DeallocateState(link.eff, link.state);
+    NvVFX_DestroyEffect(link.eff);
+    _pool.release(link.pooledIn);
+    _pool.release(link.pooledPrevOut);
+  }
+  _chain.clear();
+  if (_state) NvVFX_DeallocateState(_eff, _state);
+  _state = nullptr;
   NvVFX_DestroyEffect(_eff);
   _eff = nullptr;
+  _inited = false;
+}
+
+// Whether the effect has an NVVFX_MODE, conservative (0) or aggressive (1).
+static bool HasModeParam(const char *effectName) {
+  return !strcmp(effectName, NVVFX_FX_ARTIFACT_REDUCTION) ||
+         !strcmp(effectName, NVVFX_FX_SUPER_RES);
+}
+
+static NvCV_Status SetOneEffectParams(NvVFX_Handle eff, const char *effectName,
+                                      const FlagInfo &finfo, CUstream stream) {
+  NvCV_Status vfxErr;
+  BAIL_IF_ERR(vfxErr = NvVFX_SetCudaStream(eff, NVVFX_CUDA_STREAM, stream));
+  if (HasModeParam(effectName))
+    BAIL_IF_ERR(vfxErr =
+                    NvVFX_SetU32(eff, NVVFX_MODE, (unsigned int)finfo.mode));
+bail:
+  return vfxErr;
+}
+
+// Set the parameters that must be in place before NvVFX_Load().
+NvCV_Status FXApp::setEffectParams(const FlagInfo &finfo, CUstream stream) {
+  NvCV_Status vfxErr;
+  BAIL_IF_ERR(vfxErr = SetOneEffectParams(_eff, _effectName, finfo, stream));
+  for (ChainLink &link : _chain)
+    BAIL_IF_ERR(vfxErr = SetOneEffectParams(link.eff, link.name.c_str(), finfo,
+                                            stream));
+bail:
+  return vfxErr;
+}
+
+// Bind _srcGpuBuf as the input of the first effect, _dstGpuBuf as the output of
+// the last, and the intermediate buffers between them.
+NvCV_Status FXApp::bindEffectImages() {
+  NvCV_Status vfxErr;
+  NvVFX_Handle eff = _eff;
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_INPUT_IMAGE, &_srcGpuBuf));
+  for (ChainLink &link : _chain) {
+    BAIL_IF_ERR(vfxErr = NvVFX_SetImage(eff, NVVFX_OUTPUT_IMAGE,
+                                        link.convert ? &link.prevOut : &link.in));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetImage(link.eff, NVVFX_INPUT_IMAGE, &link.in));
+    eff = link.eff;
+  }
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(eff, NVVFX_OUTPUT_IMAGE, &_dstGpuBuf));
+bail:
+  return vfxErr;
+}
+
+NvCV_Status FXApp::loadEffects() {
+  std::chrono::high_resolution_clock::time_point start =
+      std::chrono::high_resolution_clock::now();
+  NvCV_Status vfxErr;
+  BAIL_IF_ERR(vfxErr = NvVFX_Load(_eff));
+  for (ChainLink &link : _chain) BAIL_IF_ERR(vfxErr = NvVFX_Load(link.eff));
+  _loadSeconds = std::chrono::duration<float>(
+                     std::chrono::high_resolution_clock::now() - start)
+                     .count();
+bail:
+  return vfxErr;
+}
+
+// The scale to give NvCVImage_Transfer() between images of these types.
+static float TransferScale(const NvCVImage *src, const NvCVImage *dst) {
+  if (NVCV_U8 == src->componentType && NVCV_F32 == dst->componentType)
+    return 1.f / 255.f;
+  if (NVCV_F32 == src->componentType && NVCV_U8 == dst->componentType)
+    return 255.f;
+  return 1.f;
+}
+
+// Run the chain of effects, _srcGpuBuf --> _dstGpuBuf, entirely on the GPU, or
+// only those after the first done, whose output is already in the input of
+// the next.
+NvCV_Status FXApp::runEffects(CUstream stream, size_t done) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  if (!done) BAIL_IF_ERR(vfxErr = NvVFX_Run(_eff, 0));
+  for (size_t i = done ? done - 1 : 0; i < _chain.size(); ++i) {
+    ChainLink &link = _chain[i];
+    if (link.convert && i + 1 != done)
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &link.prevOut, &link.in,
+                      TransferScale(&link.prevOut, &link.in), stream, nullptr));
+    BAIL_IF_ERR(vfxErr = NvVFX_Run(link.eff, 0));
+  }
+bail:
+  return vfxErr;
+}
+
+// Stateful (temporal) effects need a state object per input stream.
+static bool IsStatefulEffect(const char *effectName) {
+  return !strcmp(effectName, NVVFX_FX_DENOISING);
+}
+
+// Allocate and bind the state object for a single stream, if the effect is
+// stateful. This must be called after NvVFX_Load().
+NvCV_Status FXApp::bindSingleStreamState() {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  if (IsStatefulEffect(_effectName)) {
+    if (!_state) BAIL_IF_ERR(vfxErr = NvVFX_AllocateState(_eff, &_state));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetStateObjectHandleArray(_eff, NVVFX_STATE, &_state));
+  }
+  for (ChainLink &link : _chain) {
+    if (!IsStatefulEffect(link.name.c_str())) continue;
+    if (!link.state)
+      BAIL_IF_ERR(vfxErr = NvVFX_AllocateState(link.eff, &link.state));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetStateObjectHandleArray(link.eff, NVVFX_STATE,
+                                                         &link.state));
+  }
+bail:
+  return vfxErr;
+}
+
+static bool IsYUVImage(const NvCVImage *im) {
+  return NVCV_YUV420 == im->pixelFormat || NVCV_YUV422 == im->pixelFormat ||
+         NVCV_YUV444 == im->pixelFormat;
+}
+
+// NvCVImage_Transfer(), extended to YUV images in CPU memory, e.g. a decoded
+// 4:2:0 frame or a raw video frame, which are converted straight into or out of
+// the effect's buffers rather than by way of BGR, in their own colorspace.
+static NvCV_Status TransferImage(const NvCVImage *src, NvCVImage *dst,
+                                 float scale, CUstream stream,
+                                 NvCVImage *tmp) {
+  unsigned char *y, *u, *v;
+  int yPixBytes, cPixBytes, yPitch, cPitch;
+  NvCV_Status vfxErr;
+  if (IsYUVImage(src)) {
+    BAIL_IF_ERR(vfxErr = NvCVImage_GetYUVPointers(
+                    const_cast<NvCVImage *>(src), &y, &u, &v, &yPixBytes,
+                    &cPixBytes, &yPitch, &cPitch));
+    BAIL_IF_ERR(vfxErr = NvCVImage_TransferFromYUV(
+                    y, yPixBytes, yPitch, u, v, cPixBytes, cPitch,
+                    src->pixelFormat, NVCV_U8, src->colorspace, src->gpuMem,
+                    dst, nullptr, scale, stream, tmp));
+  } else if (IsYUVImage(dst)) {
+    BAIL_IF_ERR(vfxErr = NvCVImage_GetYUVPointers(dst, &y, &u, &v, &yPixBytes,
+                                                  &cPixBytes, &yPitch,
+                                                  &cPitch));
+    BAIL_IF_ERR(vfxErr = NvCVImage_TransferToYUV(
+                    src, nullptr, y, yPixBytes, yPitch, u, v, cPixBytes,
+                    cPitch, dst->pixelFormat, NVCV_U8, dst->colorspace,
+                    dst->gpuMem, scale, stream, tmp));
+  } else {
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(src, dst, scale, stream, tmp));
+  }
+bail:
+  return vfxErr;
 }
 
 // Allocate one temp buffer to be used for input and output. Reshaping of the
@@ -356,7 +856,7 @@ void FXApp::destroyEffect() {
 // load time.
 NvCV_Status FXApp::allocTempBuffers() {
   NvCV_Status vfxErr;
-  BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(
+  BAIL_IF_ERR(vfxErr = NvCVImage_Realloc(
                   &_tmpVFX, _dstVFX.width, _dstVFX.height, _dstVFX.pixelFormat,
                   _dstVFX.componentType, _dstVFX.planar, NVCV_GPU, 0));
   BAIL_IF_ERR(vfxErr = NvCVImage_Realloc(
@@ -378,70 +878,191 @@ static NvCV_Status CheckScaleIsotropy(const NvCVImage *src,
   return NVCV_SUCCESS;
 }
 
-NvCV_Status FXApp::allocBuffers(unsigned width, unsigned height,
-                                const FlagInfo &finfo) {
-  NvCV_Status vfxErr = NVCV_SUCCESS;
+// Make view a GPU buffer of the given shape, drawn from the pool. The buffer it
+// was previously a view of, if any, is returned to the pool.
+NvCV_Status FXApp::allocGpuBuf(NvCVImage *view, NvCVImage **pooled,
+                               unsigned width, unsigned height,
+                               NvCVImage_PixelFormat format,
+                               NvCVImage_ComponentType type, unsigned layout,
+                               unsigned memSpace, unsigned alignment) {
+  NvCVImage *im;
+  NvCV_Status vfxErr = _pool.acquire(width, height, format, type, layout,
+                                     memSpace, alignment, &im);
+  if (NVCV_SUCCESS != vfxErr) return vfxErr;
+  _pool.release(*pooled);
+  *pooled = im;
+  NvCVImage_InitView(view, im, 0, 0, width, height);
+  return NVCV_SUCCESS;
+}
 
-  if (_inited) return NVCV_SUCCESS;
-
-  if (!_srcImg.data) {
-    _srcImg.create(height, width, CV_8UC3);  // src CPU
-    BAIL_IF_NULL(_srcImg.data, vfxErr, NVCV_ERR_MEMORY);
-  }
-  if (!strcmp(_effectName, NVVFX_FX_TRANSFER)) {
-    _dstImg.create(_srcImg.rows, _srcImg.cols, _srcImg.type());  // dst CPU
-    BAIL_IF_NULL(_dstImg.data, vfxErr, NVCV_ERR_MEMORY);
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_srcGpuBuf, _srcImg.cols,
-                                         _srcImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // src GPU
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_dstGpuBuf, _dstImg.cols,
-                                         _dstImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // dst GPU
-  } else if (!strcmp(_effectName, NVVFX_FX_ARTIFACT_REDUCTION)) {
-    _dstImg.create(_srcImg.rows, _srcImg.cols, _srcImg.type());  // dst CPU
-    BAIL_IF_NULL(_dstImg.data, vfxErr, NVCV_ERR_MEMORY);
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_srcGpuBuf, _srcImg.cols,
-                                         _srcImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // src GPU
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_dstGpuBuf, _dstImg.cols,
-                                         _dstImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // dst GPU
-  } else if (!strcmp(_effectName, NVVFX_FX_SUPER_RES)) {
-    if (!finfo.resolution) {
-      printf("--resolution has not been specified\n");
-      return NVCV_ERR_PARAMETER;
+void FXApp::beginStats(const FlagInfo &finfo, long long expectedFrames) {
+  _timer.enable(finfo.collectStats || !finfo.statsFile.empty() ||
+                    !finfo.statsCsv.empty(),
+                (expectedFrames > 0) ? (size_t)expectedFrames : 0);
+  _timer.start();
+  _trace.enable(finfo.latency || finfo.latencyOverlay ||
+                    !finfo.traceFile.empty(),
+                (expectedFrames > 0) ? (size_t)expectedFrames : 0);
+}
+
+FXApp::Err FXApp::endStats(const FlagInfo &finfo, unsigned long long frames,
+                           unsigned long long repeated) {
+  Err appErr = errNone;
+  if (_trace.enabled()) {
+    _trace.enable(false);
+    if (finfo.latency) _trace.print();
+    if (!finfo.traceFile.empty() &&
+        !_trace.writeChromeTrace(finfo.traceFile.c_str())) {
+      printf("Error writing: \"%s\"\n", finfo.traceFile.c_str());
+      appErr = errWrite;
     }
-    BAIL_IF_ERR(vfxErr = NvVFX_SetF32(_eff, NVVFX_STRENGTH, finfo.strength));
-    int dstWidth = _srcImg.cols * finfo.resolution / _srcImg.rows;
-    _dstImg.create(finfo.resolution, dstWidth, _srcImg.type());  // dst CPU
-    BAIL_IF_NULL(_dstImg.data, vfxErr, NVCV_ERR_MEMORY);
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_srcGpuBuf, _srcImg.cols,
-                                         _srcImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // src GPU
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&_dstGpuBuf, _dstImg.cols,
-                                         _dstImg.rows, NVCV_BGR, NVCV_F32,
-                                         NVCV_PLANAR, NVCV_GPU, 1));  // dst GPU
-    BAIL_IF_ERR(vfxErr = CheckScaleIsotropy(&_srcGpuBuf, &_dstGpuBuf));
-  } else if (!strcmp(_effectName, NVVFX_FX_SR_UPSCALE)) {
+  }
+  if (!_timer.enabled()) return appErr;
+  _timer.stop(frames, repeated);
+  _timer.enable(false);
+  if (finfo.statsFile.empty() && finfo.statsCsv.empty()) return appErr;
+  printf("\n");
+  _timer.print();
+  if (!finfo.statsFile.empty() && !_timer.writeJson(finfo.statsFile.c_str())) {
+    printf("Error writing: \"%s\"\n", finfo.statsFile.c_str());
+    appErr = errWrite;
+  }
+  if (!finfo.statsCsv.empty() && !_timer.writeCsv(finfo.statsCsv.c_str())) {
+    printf("Error writing: \"%s\"\n", finfo.statsCsv.c_str());
+    appErr = errWrite;
+  }
+  return appErr;
+}
+
+void FXApp::printPoolStats() {
+  const NvCVImagePool::Stats &st = _pool.stats();
+  const PinnedHostPool::Stats hst = _hostAllocator.stats();
+  printf("Buffer pool: %llu hits, %llu misses, %llu evictions, %.1f MB "
+         "(peak %.1f MB)\n",
+         st.hits, st.misses, st.evictions, st.bytes / 1048576.,
+         st.peakBytes / 1048576.);
+  printf("Pinned host pool: %llu hits, %llu misses, %.1f MB (peak %.1f MB)",
+         hst.hits, hst.misses, hst.bytes / 1048576., hst.peakBytes / 1048576.);
+  if (hst.fallbacks)
+    printf(", %llu not pinned (%llu of them not locked either)",
+           hst.fallbacks, hst.unlocked);
+  printf("\n");
+}
+
+static unsigned AlignmentFor(const NvCVImage *im) {
+  return (NVCV_PLANAR == im->planar) ? 1 : 32;  // As chosen in allocBuffers()
+}
+
+// The GPU buffers that an effect takes as input and output.
+struct EffectBufferSpec {
+  NvCVImage_PixelFormat format;
+  NvCVImage_ComponentType type;
+  unsigned layout, alignment;
+  unsigned dstWidth, dstHeight;  // For a source of the given size
+};
+
+// Determine the buffers for an effect, given the size of its input, and set its
+// strength, if it has one.
+static NvCV_Status GetEffectBufferSpec(NvVFX_Handle eff, const char *effectName,
+                                       unsigned width, unsigned height,
+                                       const FlagInfo &finfo,
+                                       EffectBufferSpec *spec) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  spec->format = NVCV_BGR;
+  spec->type = NVCV_F32;
+  spec->layout = NVCV_PLANAR;
+  spec->alignment = 1;
+  spec->dstWidth = width;
+  spec->dstHeight = height;
+  if (!strcmp(effectName, NVVFX_FX_TRANSFER) ||
+      !strcmp(effectName, NVVFX_FX_ARTIFACT_REDUCTION)) {
+    // BGR f32 planar, the same size
+  } else if (!strcmp(effectName, NVVFX_FX_DENOISING)) {
+    BAIL_IF_ERR(vfxErr = NvVFX_SetF32(eff, NVVFX_STRENGTH, finfo.strength));
+  } else if (!strcmp(effectName, NVVFX_FX_SUPER_RES) ||
+             !strcmp(effectName, NVVFX_FX_SR_UPSCALE)) {
     if (!finfo.resolution) {
       printf("--resolution has not been specified\n");
       return NVCV_ERR_PARAMETER;
     }
+    BAIL_IF_ERR(vfxErr = NvVFX_SetF32(eff, NVVFX_STRENGTH, finfo.strength));
+    spec->dstWidth = width * finfo.resolution / height;
+    spec->dstHeight = finfo.resolution;
+    if (!strcmp(effectName, NVVFX_FX_SR_UPSCALE)) {
+      spec->format = NVCV_RGBA;
+      spec->type = NVCV_U8;
+      spec->layout = NVCV_INTERLEAVED;
+      spec->alignment = 32;
+    }
+  } else {
+    printf("Unknown effect \"%s\"\n", effectName);
+    return NVCV_ERR_FEATURENOTFOUND;
+  }
+bail:
+  return vfxErr;
+}
 
-    BAIL_IF_ERR(vfxErr = NvVFX_SetF32(_eff, NVVFX_STRENGTH, finfo.strength));
-    int dstWidth = _srcImg.cols * finfo.resolution / _srcImg.rows;
-    _dstImg.create(finfo.resolution, dstWidth, _srcImg.type());  // dst CPU
-    BAIL_IF_NULL(_dstImg.data, vfxErr, NVCV_ERR_MEMORY);
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(
-                    &_srcGpuBuf, _srcImg.cols, _srcImg.rows, NVCV_RGBA, NVCV_U8,
-                    NVCV_INTERLEAVED, NVCV_GPU, 32));  // src GPU
-    BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(
-                    &_dstGpuBuf, _dstImg.cols, _dstImg.rows, NVCV_RGBA, NVCV_U8,
-                    NVCV_INTERLEAVED, NVCV_GPU, 32));  // dst GPU
-    BAIL_IF_ERR(vfxErr = CheckScaleIsotropy(&_srcGpuBuf, &_dstGpuBuf));
+static bool SameBufferFormat(const EffectBufferSpec &a,
+                             const EffectBufferSpec &b) {
+  return a.format == b.format && a.type == b.type && a.layout == b.layout &&
+         a.alignment == b.alignment;
+}
+
+NvCV_Status FXApp::allocBuffers(unsigned width, unsigned height,
+                                const FlagInfo &finfo) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  EffectBufferSpec spec, next;
+
+  // A change of shape costs a pool lookup, plus NvVFX_Load() by the caller.
+  if (_inited && width == (unsigned)_srcImg.cols &&
+      height == (unsigned)_srcImg.rows)
+    return NVCV_SUCCESS;
+  if (finfo.poolMB > 0)
+    _pool.setMaxBytes((unsigned long long)finfo.poolMB << 20);
+
+  _srcImg.allocator = &_hostAllocator;  // Decoded straight into pinned memory
+  _srcImg.create(height, width, CV_8UC3);  // src CPU
+  BAIL_IF_NULL(_srcImg.data, vfxErr, NVCV_ERR_MEMORY);
+  BAIL_IF_ERR(vfxErr = GetEffectBufferSpec(_eff, _effectName, width, height,
+                                           finfo, &spec));
+  BAIL_IF_ERR(vfxErr = allocGpuBuf(&_srcGpuBuf, &_srcPooled, width, height,
+                                   spec.format, spec.type, spec.layout,
+                                   NVCV_GPU, spec.alignment));  // src GPU
+
+  // Each chained effect takes the previous one's output directly, unless it
+  // needs a different format, in which case there is a conversion on the GPU.
+  for (ChainLink &link : _chain) {
+    BAIL_IF_ERR(vfxErr = GetEffectBufferSpec(link.eff, link.name.c_str(),
+                                             spec.dstWidth, spec.dstHeight,
+                                             finfo, &next));
+    link.convert = !SameBufferFormat(spec, next);
+    BAIL_IF_ERR(vfxErr = allocGpuBuf(&link.in, &link.pooledIn, spec.dstWidth,
+                                     spec.dstHeight, next.format, next.type,
+                                     next.layout, NVCV_GPU, next.alignment));
+    if (link.convert) {
+      BAIL_IF_ERR(vfxErr = allocGpuBuf(
+                      &link.prevOut, &link.pooledPrevOut, spec.dstWidth,
+                      spec.dstHeight, spec.format, spec.type, spec.layout,
+                      NVCV_GPU, spec.alignment));
+    } else {
+      _pool.release(link.pooledPrevOut);
+      link.pooledPrevOut = nullptr;
+    }
+    spec = next;
   }
-  NVWrapperForCVMat(&_srcImg, &_srcVFX);  // _srcVFX is an alias for _srcImg
-  NVWrapperForCVMat(&_dstImg, &_dstVFX);  // _dstVFX is an alias for _dstImg
+
+  BAIL_IF_ERR(vfxErr = allocGpuBuf(&_dstGpuBuf, &_dstPooled, spec.dstWidth,
+                                   spec.dstHeight, spec.format, spec.type,
+                                   spec.layout, NVCV_GPU,
+                                   spec.alignment));  // dst GPU
+  _dstImg.allocator = &_hostAllocator;
+  _dstImg.create(spec.dstHeight, spec.dstWidth, _srcImg.type());  // dst CPU
+  BAIL_IF_NULL(_dstImg.data, vfxErr, NVCV_ERR_MEMORY);
+  if (_srcGpuBuf.width != _dstGpuBuf.width ||
+      _srcGpuBuf.height != _dstGpuBuf.height)
+    BAIL_IF_ERR(vfxErr = CheckScaleIsotropy(&_srcGpuBuf, &_dstGpuBuf));
+  NVWrapperForPinnedCVMat(&_srcImg, &_srcVFX);  // An alias for _srcImg
+  NVWrapperForPinnedCVMat(&_dstImg, &_dstVFX);  // An alias for _dstImg
 
 // #define ALLOC_TEMP_BUFFERS_AT_RUN_TIME    // Deferring temp buffer allocation
 // is easier
@@ -453,45 +1074,95 @@ NvCV_Status FXApp::allocBuffers(unsigned width, unsigned height,
                                 // one buffer to be a temporary for src and dst
 #endif                          // ALLOC_TEMP_BUFFERS_AT_RUN_TIME
 
+  if (_inited) BAIL_IF_ERR(vfxErr = bindEffectImages());  // Reshaped
   _inited = true;
 
 bail:
   return vfxErr;
 }
 
+// The largest input that an effect accepts, or 0 if it does not say.
+static void GetMaxInputSize(NvVFX_Handle eff, unsigned *width,
+                            unsigned *height) {
+  if (NVCV_SUCCESS != NvVFX_GetU32(eff, NVVFX_MAX_INPUT_WIDTH, width))
+    *width = 0;
+  if (NVCV_SUCCESS != NvVFX_GetU32(eff, NVVFX_MAX_INPUT_HEIGHT, height))
+    *height = 0;
+}
+
 FXApp::Err FXApp::processImage(const char *inFile, const char *outFile,
                                const FlagInfo &finfo,
                                progressCallback cb = nullptr) {
   CUstream stream = 0;
-  NvCV_Status vfxErr;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  cv::Mat img, tiled, result;
+  unsigned maxWidth, maxHeight;
+  std::string content, key;
+  ResultCache::Entry entry;
+  size_t done = 0;
 
   if (!_eff) return errEffect;
-  _srcImg = cv::imread(inFile);
-  if (!_srcImg.data) return errRead;
-
-  BAIL_IF_ERR(vfxErr = allocBuffers(_srcImg.cols, _srcImg.rows, finfo));
+  if (openCache(finfo)) {  // Results are addressed by the bytes of the file
+    MappedFile in;
+    if (!in.open(inFile)) return errRead;
+    content = ContentHash().update(in.data(), in.size()).hex();
+    key = cacheKey(content, 1 + _chain.size(), finfo);
+  }
 
-  // Since images are uploaded asynchronously, we may as well do this first.
-  BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
-                  &_srcVFX, &_srcGpuBuf, 1.f / 255.f, stream,
-                  &_tmpVFX));  // _srcVFX--> _tmpVFX --> _srcGpuBuf
-  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_INPUT_IMAGE, &_srcGpuBuf));
-  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_OUTPUT_IMAGE, &_dstGpuBuf));
-  BAIL_IF_ERR(vfxErr = NvVFX_SetCudaStream(_eff, NVVFX_CUDA_STREAM, stream));
-  if (!strcmp(_effectName, NVVFX_FX_ARTIFACT_REDUCTION)) {
-    BAIL_IF_ERR(vfxErr =
-                    NvVFX_SetU32(_eff, NVVFX_MODE, (unsigned int)finfo.mode));
-  } else if (!strcmp(_effectName, NVVFX_FX_SUPER_RES)) {
-    BAIL_IF_ERR(vfxErr =
-                    NvVFX_SetU32(_eff, NVVFX_MODE, (unsigned int)finfo.mode));
+  if (!key.empty() && _cache.lookup(key, &entry) &&
+      NVCV_BGR == entry.header().pixelFormat &&
+      NVCV_U8 == entry.header().componentType) {
+    result = cv::Mat(entry.header().height, entry.header().width, CV_8UC3,
+                     const_cast<unsigned char *>(entry.payload()),
+                     entry.header().rowBytes);  // A view of the mapped file
+    if (finfo.verbose) printf("%s is cached\n", inFile);
+    goto write;
   }
 
-  BAIL_IF_ERR(vfxErr = NvVFX_Load(_eff));
-  BAIL_IF_ERR(vfxErr = NvVFX_Run(_eff, 0));  // _srcGpuBuf --> _dstGpuBuf
-  BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
-                  &_dstGpuBuf, &_dstVFX, 255.f, stream,
-                  &_tmpVFX));  // _dstGpuBuf --> _tmpVFX --> _dstVFX
+  img = cv::imread(inFile);
+  if (!img.data) return errRead;
+
+  GetMaxInputSize(_eff, &maxWidth, &maxHeight);
+  if ((maxWidth && (unsigned)img.cols > maxWidth) ||
+      (maxHeight && (unsigned)img.rows > maxHeight)) {
+    if (finfo.verbose)
+      printf("%dx%d is larger than the %ux%u that %s accepts; tiling\n",
+             img.cols, img.rows, maxWidth, maxHeight, _effectName);
+    BAIL_IF_ERR(vfxErr = processTiles(img, &tiled, finfo, stream, cb));
+    result = tiled;
+  } else {
+    _srcImg = img;
+    BAIL_IF_ERR(vfxErr = allocBuffers(_srcImg.cols, _srcImg.rows, finfo));
+    BAIL_IF_ERR(vfxErr = bindEffectImages());
+    BAIL_IF_ERR(vfxErr = setEffectParams(finfo, stream));
 
+    BAIL_IF_ERR(vfxErr = loadEffects());
+    BAIL_IF_ERR(vfxErr = bindSingleStreamState());
+    if (!content.empty())  // Start after the last effect whose output is cached
+      BAIL_IF_ERR(vfxErr = resumeFromCache(content, finfo, stream, &done));
+    if (!done)
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &_srcVFX, &_srcGpuBuf, 1.f / 255.f, stream,
+                      &_tmpVFX));  // _srcVFX--> _tmpVFX --> _srcGpuBuf
+    BAIL_IF_ERR(vfxErr = runEffects(stream, done));  // --> _dstGpuBuf
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                    &_dstGpuBuf, &_dstVFX, 255.f, stream,
+                    &_tmpVFX));  // _dstGpuBuf --> _tmpVFX --> _dstVFX
+    // _dstVFX is pinned, so the download is asynchronous.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    if (!content.empty())
+      BAIL_IF_ERR(vfxErr = cacheStages(content, finfo, stream, done));
+    result = _dstImg;
+  }
+  if (!key.empty()) {
+    NvCVImage resultVFX;
+    NVWrapperForCVMat(&result, &resultVFX);
+    if (!_cache.store(key, &resultVFX))
+      printf("Cannot cache the result of %s in \"%s\"\n", inFile,
+             finfo.cacheDir.c_str());
+  }
+
+write:
   if (cb != nullptr) {
     cb(50.f);
   }
@@ -502,7 +1173,7 @@ FXApp::Err FXApp::processImage(const char *inFile, const char *outFile,
               "WARNING: JPEG output file format will reduce image quality\n");
 
     try {
-      cv::imwrite(outFile, _dstImg);
+      cv::imwrite(outFile, result);
     } catch (...) {
       printf("Error writing: \"%s\"\n", outFile);
       return errWrite;
@@ -514,111 +1185,2298 @@ FXApp::Err FXApp::processImage(const char *inFile, const char *outFile,
   }
 
   if (_show) {
-    cv::imshow("Output", _dstImg);
+    cv::imshow("Output", result);
   }
+  if (finfo.verbose && _cache.enabled()) _cache.print();
 bail:
   return appErrFromVfxStatus(vfxErr);
 }
 
-FXApp::Err FXApp::processMovie(const char *inFile, const char *outFile,
-                               const FlagInfo &finfo,
-                               progressCallback cb = nullptr) {
-  const int fourcc_h264 = cv::VideoWriter::fourcc('H', '2', '6', '4');
-  CUstream stream = 0;
-  FXApp::Err appErr = errNone;
-  bool ok;
-  cv::VideoCapture reader;
-  cv::VideoWriter writer;
-  NvCV_Status vfxErr;
-  unsigned frameNum;
-  VideoInfo vinfo;
+// Open the store of results named by --cache_dir, if it is not already.
+bool FXApp::openCache(const FlagInfo &finfo) {
+  if (finfo.cacheDir.empty()) return false;
+  if (_cache.enabled()) return true;
+  if (_cache.open(finfo.cacheDir,
+                  (unsigned long long)std::max(finfo.cacheMB, 0) << 20))
+    return true;
+  printf("Cannot use \"%s\" as a cache; continuing without\n",
+         finfo.cacheDir.c_str());
+  return false;
+}
 
-  if (inFile && !inFile[0])
-    inFile = nullptr;  // Set file paths to NULL if zero length
+// A digest of the relative paths and contents of the files in the model
+// directory, so that results are not reused once the models change.
+const std::string &FXApp::modelDirHash() {
+  if (!_modelDirHash.empty()) return _modelDirHash;
+  std::vector<std::filesystem::path> files;
+  std::error_code ec;
+  ContentHash hash;
+  for (std::filesystem::recursive_directory_iterator
+           it(_modelDir, std::filesystem::directory_options::
+                             skip_permission_denied, ec), end;
+       !ec && it != end; it.increment(ec))
+    if (it->is_regular_file(ec)) files.push_back(it->path());
+  std::sort(files.begin(), files.end());
+  for (const std::filesystem::path &path : files) {
+    MappedFile file;
+    hash.update(std::filesystem::relative(path, _modelDir, ec).string());
+    if (file.open(path.string().c_str()))
+      hash.value((uint64_t)file.size()).update(file.data(), file.size());
+  }
+  return _modelDirHash = hash.hex();
+}
 
-  if (!finfo.webcam && inFile) {
-    reader.open(inFile);
-  } else {
-    appErr = initCamera(reader, finfo);
-    if (appErr != errNone) return appErr;
+// The key of the output of the first numEffects effects of the chain, given
+// a digest of their input: everything that the output depends upon.
+std::string FXApp::cacheKey(const std::string &content, size_t numEffects,
+                            const FlagInfo &finfo) {
+  std::string effects = _firstEffectName;
+  unsigned version = 0;
+  for (size_t i = 0; i + 1 < numEffects; ++i)
+    effects += "," + _chain[i].name;
+  NvVFX_GetVersion(&version);
+  return ContentHash()
+      .update(content)
+      .update(effects)
+      .value(finfo.mode)
+      .value(finfo.strength)
+      .value(finfo.resolution)
+      .value(version)
+      .update(modelDirHash())
+      .hex();
+}
+
+// Find the longest leading part of the chain whose output is cached, and put
+// that output into the input of the next effect, so that runEffects() starts
+// there; *done is the number of effects that need not be run.
+NvCV_Status FXApp::resumeFromCache(const std::string &content,
+                                   const FlagInfo &finfo, CUstream stream,
+                                   size_t *done) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  *done = 0;
+  for (size_t k = _chain.size(); k; --k) {
+    ResultCache::Entry entry;
+    NvCVImage &in = _chain[k - 1].in;
+    if (!_cache.lookup(cacheKey(content, k, finfo), &entry)) continue;
+    const ResultCacheHeader &h = entry.header();
+    if (h.width != in.width || h.height != in.height ||
+        h.pixelFormat != (unsigned)in.pixelFormat ||
+        h.componentType != (unsigned)in.componentType ||
+        h.planar != in.planar)
+      continue;
+    NvCVImage view;
+    BAIL_IF_ERR(vfxErr = entry.wrap(&view));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&view, &in, 1.f, stream, &_tmpVFX));
+    cudaStreamSynchronize(stream);  // Before the file is unmapped
+    *done = k;
+    break;
+  }
+bail:
+  return vfxErr;
+}
+
+// Cache the outputs of the effects of the chain after the first done, other
+// than the last, which are still in the inputs of the effects that follow.
+NvCV_Status FXApp::cacheStages(const std::string &content,
+                               const FlagInfo &finfo, CUstream stream,
+                               size_t done) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  for (size_t k = done + 1; k <= _chain.size(); ++k) {
+    const NvCVImage &in = _chain[k - 1].in;
+    NvCVImage host(in.width, in.height, in.pixelFormat, in.componentType,
+                   in.planar, NVCV_CPU, 1);
+    if (!host.pixels) {
+      vfxErr = NVCV_ERR_MEMORY;
+      goto bail;
+    }
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&in, &host, 1.f, stream, nullptr));
+    cudaStreamSynchronize(stream);
+    _cache.store(cacheKey(content, k, finfo), &host);
   }
+bail:
+  return vfxErr;
+}
 
-  if (!reader.isOpened()) {
-    if (!finfo.webcam)
-      printf("Error: Could not open video: \"%s\"\n", inFile);
-    else
-      printf("Error: Webcam not found\n");
-    return errRead;
+// The size of the output of the chain of effects, for an input of the given
+// size, as allocBuffers() would make it.
+NvCV_Status FXApp::chainOutputSize(unsigned width, unsigned height,
+                                   const FlagInfo &finfo, unsigned *dstWidth,
+                                   unsigned *dstHeight) {
+  EffectBufferSpec spec;
+  NvCV_Status vfxErr;
+  BAIL_IF_ERR(vfxErr = GetEffectBufferSpec(_eff, _effectName, width, height,
+                                           finfo, &spec));
+  for (ChainLink &link : _chain)
+    BAIL_IF_ERR(vfxErr = GetEffectBufferSpec(link.eff, link.name.c_str(),
+                                             spec.dstWidth, spec.dstHeight,
+                                             finfo, &spec));
+  *dstWidth = spec.dstWidth;
+  *dstHeight = spec.dstHeight;
+bail:
+  return vfxErr;
+}
+
+static unsigned GreatestCommonDivisor(unsigned a, unsigned b) {
+  while (b) {
+    unsigned r = a % b;
+    a = b;
+    b = r;
   }
+  return a;
+}
 
-  GetVideoInfo(reader, (inFile ? inFile : "webcam"), &vinfo, finfo);
-  if (!(fourcc_h264 == vinfo.codec ||
-        cv::VideoWriter::fourcc('a', 'v', 'c', '1') ==
-            vinfo.codec))  // avc1 is alias for h264
-    printf("Filters only target H264 videos, not %.4s\n", (char *)&vinfo.codec);
+// The origins of tiles that cover [0, length) and overlap by at least the
+// given amount. All are multiples of step, given that the arguments are, and
+// the last is flush with the end, so that every tile is the same size.
+static std::vector<unsigned> TileOrigins(unsigned length, unsigned tile,
+                                         unsigned overlap) {
+  std::vector<unsigned> origins;
+  unsigned x;
+  for (x = 0; x + tile < length; x += tile - overlap) origins.push_back(x);
+  origins.push_back(length - tile);
+  return origins;
+}
 
-  BAIL_IF_ERR(vfxErr = allocBuffers(vinfo.width, vinfo.height, finfo));
+// A matte that ramps up from 0 at each edge to 255 across the given number of
+// pixels in from it, e.g. across the overlaps of a tile with the tiles already
+// composited to its left and above.
+static float FeatherRamp(unsigned x, unsigned n, unsigned lo, unsigned hi) {
+  float a = (x < lo) ? (x + .5f) / lo : 1.f;
+  if (n - x <= hi) a = std::min(a, (n - x - .5f) / hi);
+  return a;
+}
 
-  if (outFile && !outFile[0]) outFile = nullptr;
-  if (outFile) {
-    ok = writer.open(outFile, StringToFourcc(finfo.codec), vinfo.frameRate,
-                     cv::Size(_dstVFX.width, _dstVFX.height));
-    if (!ok) {
-      printf("Cannot open \"%s\" for video writing\n", outFile);
-      outFile = nullptr;
-      if (!_show) return errWrite;
+static void MakeFeatherMatte(unsigned left, unsigned top, unsigned right,
+                             unsigned bottom, NvCVImage *matte) {
+  for (unsigned y = 0; y < matte->height; ++y) {
+    unsigned char *m =
+        (unsigned char *)matte->pixels + (size_t)y * matte->pitch;
+    float ay = FeatherRamp(y, matte->height, top, bottom);
+    for (unsigned x = 0; x < matte->width; ++x) {
+      float ax = FeatherRamp(x, matte->width, left, right);
+      m[x] = (unsigned char)(255.f * ax * ay + .5f);
     }
   }
+}
 
-  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_INPUT_IMAGE, &_srcGpuBuf));
-  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_OUTPUT_IMAGE, &_dstGpuBuf));
-  BAIL_IF_ERR(vfxErr = NvVFX_SetCudaStream(_eff, NVVFX_CUDA_STREAM, stream));
-  if (!strcmp(_effectName, NVVFX_FX_ARTIFACT_REDUCTION)) {
-    BAIL_IF_ERR(vfxErr =
-                    NvVFX_SetU32(_eff, NVVFX_MODE, (unsigned int)finfo.mode));
-  } else if (!strcmp(_effectName, NVVFX_FX_SUPER_RES)) {
-    BAIL_IF_ERR(vfxErr =
-                    NvVFX_SetU32(_eff, NVVFX_MODE, (unsigned int)finfo.mode));
+// Run the effects over an image that is larger than the first effect accepts,
+// in overlapping tiles of the largest size it does accept. The tiles are all
+// the same size, so the effects are loaded once, and the GPU buffers are those
+// of one tile, plus a second input buffer, into which the next tile is uploaded
+// on a stream of its own while the effects run on this one. The tiles are
+// composited into dst on the CPU, feathered across the overlaps to hide the
+// seams, which is where the effects see the edges of the tiles.
+NvCV_Status FXApp::processTiles(const cv::Mat &src, cv::Mat *dst,
+                                const FlagInfo &finfo, CUstream stream,
+                                progressCallback cb) {
+  const unsigned kOverlap = 32;  // Source pixels
+  const unsigned width = (unsigned)src.cols, height = (unsigned)src.rows;
+  unsigned dstWidth, dstHeight, num, den, g, maxWidth, maxHeight, mw, mh;
+  unsigned tileWidth, tileHeight, overlap, left = ~0u, top = ~0u;
+  std::vector<unsigned> xs, ys;
+  NvCVImage srcFull, dstFull, view, matte, *spare = nullptr, *upload[2];
+  cv::Mat pinned;
+  CUstream upStream = nullptr;
+  cudaEvent_t uploaded[2] = {nullptr, nullptr}, ran[2] = {nullptr, nullptr};
+  FlagInfo tinfo = finfo;
+  NvCV_Status vfxErr;
+  size_t k, numTiles;
+
+  // Tiles are placed on multiples of den source pixels, which scale to whole
+  // numbers of destination pixels.
+  BAIL_IF_ERR(vfxErr = chainOutputSize(width, height, finfo, &dstWidth,
+                                       &dstHeight));
+  g = GreatestCommonDivisor(dstHeight, height);
+  num = dstHeight / g;
+  den = height / g;
+  if (width % den ||
+      (unsigned long long)width * num != (unsigned long long)dstWidth * den) {
+    printf("Error: %ux%u --> %ux%u cannot be divided into tiles\n", width,
+           height, dstWidth, dstHeight);
+    return NVCV_ERR_RESOLUTION;
   }
-  BAIL_IF_ERR(vfxErr = NvVFX_Load(_eff));
 
-  for (frameNum = 0; reader.read(_srcImg); ++frameNum) {
-    if (_srcImg.empty()) {
-      printf("Frame %u is empty\n", frameNum);
-    }
+  // The tile is as large as every effect in the chain accepts.
+  GetMaxInputSize(_eff, &maxWidth, &maxHeight);
+  tileWidth = (maxWidth && maxWidth < width) ? maxWidth : width;
+  tileHeight = (maxHeight && maxHeight < height) ? maxHeight : height;
+  for (ChainLink &link : _chain) {  // Assuming that each sees the final scale
+    GetMaxInputSize(link.eff, &mw, &mh);
+    if (mw && mw * (unsigned long long)den / num < tileWidth)
+      tileWidth = (unsigned)(mw * (unsigned long long)den / num);
+    if (mh && mh * (unsigned long long)den / num < tileHeight)
+      tileHeight = (unsigned)(mh * (unsigned long long)den / num);
+  }
+  overlap = (kOverlap + den - 1) / den * den;
+  tileWidth -= tileWidth % den;
+  tileHeight -= tileHeight % den;
+  if ((tileWidth < width && tileWidth <= overlap) ||
+      (tileHeight < height && tileHeight <= overlap)) {
+    printf("Error: a %ux%u tile is too small to be overlapped by %u\n",
+           tileWidth, tileHeight, overlap);
+    return NVCV_ERR_RESOLUTION;
+  }
+  xs = TileOrigins(width, tileWidth, overlap);
+  ys = TileOrigins(height, tileHeight, overlap);
+  numTiles = xs.size() * ys.size();
+  if (finfo.verbose)
+    printf("%zu tiles of %ux%u\n", numTiles, tileWidth, tileHeight);
 
-    // _srcVFX   --> _srcTmpVFX --> _srcGpuBuf --> _dstGpuBuf --> _dstTmpVFX -->
-    // _dstVFX
-    if (_enableEffect) {
-      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_srcGpuBuf,
-                                              1.f / 255.f, stream, &_tmpVFX));
-      BAIL_IF_ERR(vfxErr = NvVFX_Run(_eff, 0));
-      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
-                                              stream, &_tmpVFX));
-    } else {
-      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_dstVFX, 1.f / 255.f,
-                                              stream, &_tmpVFX));
-    }
+  // Super resolution takes its scale from --resolution, the output height.
+  tinfo.resolution = (int)(tileHeight * num / den);
+  BAIL_IF_ERR(vfxErr = allocBuffers(tileWidth, tileHeight, tinfo));
+  BAIL_IF_ERR(vfxErr = _pool.acquire(
+                  _srcGpuBuf.width, _srcGpuBuf.height, _srcGpuBuf.pixelFormat,
+                  _srcGpuBuf.componentType, _srcGpuBuf.planar, NVCV_GPU,
+                  AlignmentFor(&_srcGpuBuf), &spare));
+  upload[0] = &_srcGpuBuf;
+  upload[1] = spare;
+  BAIL_IF_ERR(vfxErr = bindEffectImages());
+  BAIL_IF_ERR(vfxErr = setEffectParams(tinfo, stream));
+  BAIL_IF_ERR(vfxErr = loadEffects());
+  BAIL_IF_ERR(vfxErr = bindSingleStreamState());
 
-    if (outFile) writer.write(_dstImg);
+  dst->create(dstHeight, dstWidth, src.type());
+  BAIL_IF_NULL(dst->data, vfxErr, NVCV_ERR_MEMORY);
+  if (src.u && src.u->currAllocator == &_hostAllocator) {
+    pinned = src;
+  } else {  // Uploads from pageable memory would not be asynchronous
+    pinned.allocator = &_hostAllocator;
+    src.copyTo(pinned);
+    BAIL_IF_NULL(pinned.data, vfxErr, NVCV_ERR_MEMORY);
+  }
+  NVWrapperForPinnedCVMat(&pinned, &srcFull);
+  NVWrapperForCVMat(dst, &dstFull);
+  BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(&matte, _dstVFX.width, _dstVFX.height,
+                                       NVCV_A, NVCV_U8, NVCV_CHUNKY, NVCV_CPU,
+                                       0));
+  BAIL_IF_ERR(vfxErr = NvVFX_CudaStreamCreate(&upStream));
+  for (k = 0; k < 2; ++k) {
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaEventCreateWithFlags(
+                    &uploaded[k], cudaEventDisableTiming)));
+    BAIL_IF_ERR(vfxErr = CudaStatus(
+                    cudaEventCreateWithFlags(&ran[k], cudaEventDisableTiming)));
+  }
 
-    if (_show) {
-      drawFrameRate(_dstImg);
-      cv::imshow("Output", _dstImg);
-      int key = cv::waitKey(1);
-      if (key > 0) {
-        appErr = processKey(key, finfo);
-        if (errQuit == appErr) break;
-      }
+  // Tile k is uploaded into upload[k & 1] on upStream, and run on stream once
+  // it has arrived. The upload of tile k + 1 waits only for the run of tile
+  // k - 1, which last read its buffer, so it overlaps the run of tile k.
+  NvCVImage_InitView(&view, &srcFull, (int)xs[0], (int)ys[0], tileWidth,
+                     tileHeight);
+  BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&view, upload[0], 1.f / 255.f,
+                                          upStream, &_tmpVFX));
+  BAIL_IF_ERR(vfxErr = CudaStatus(cudaEventRecord(uploaded[0], upStream)));
+  for (k = 0; k < numTiles; ++k) {
+    size_t i = k % xs.size(), j = k / xs.size();
+    BAIL_IF_ERR(vfxErr = CudaStatus(
+                    cudaStreamWaitEvent(stream, uploaded[k & 1], 0)));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetImage(_eff, NVVFX_INPUT_IMAGE,
+                                        upload[k & 1]));
+    BAIL_IF_ERR(vfxErr = runEffects(stream));
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaEventRecord(ran[k & 1], stream)));
+    if (k + 1 < numTiles) {  // Upload the next tile while this one runs
+      if (k)
+        BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamWaitEvent(
+                        upStream, ran[(k + 1) & 1], 0)));
+      NvCVImage_InitView(&view, &srcFull, (int)xs[(k + 1) % xs.size()],
+                         (int)ys[(k + 1) / xs.size()], tileWidth, tileHeight);
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&view, upload[(k + 1) & 1],
+                                              1.f / 255.f, upStream,
+                                              &_tmpVFX));
+      BAIL_IF_ERR(vfxErr = CudaStatus(
+                      cudaEventRecord(uploaded[(k + 1) & 1], upStream)));
     }
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
+                                            stream, &_tmpDstVFX));
+    // _dstVFX is pinned, so the download must complete before compositing.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
 
-    if (cb != nullptr) {
-      cb(100.f * frameNum / vinfo.frameCount);
-    }
+    // Blend across the overlaps with the tiles to the left and above.
+    unsigned l = i ? (xs[i - 1] + tileWidth - xs[i]) * num / den : 0,
+             t = j ? (ys[j - 1] + tileHeight - ys[j]) * num / den : 0;
+    if (l != left || t != top)
+      MakeFeatherMatte(left = l, top = t, 0, 0, &matte);
+    NvCVPoint2i org = {(int)(xs[i] * num / den), (int)(ys[j] * num / den)};
+    BAIL_IF_ERR(vfxErr = NvCVImage_CompositeRect(&_dstVFX, nullptr, &dstFull,
+                                                 &org, &matte, 0, &dstFull,
+                                                 &org, stream));
+    if (cb != nullptr) cb(50.f * (k + 1) / numTiles);
   }
 
-  reader.release();
-  if (outFile) writer.release();
 bail:
-  return appErrFromVfxStatus(vfxErr);
+  if (upStream) {
+    cudaStreamSynchronize(upStream);
+    NvVFX_CudaStreamDestroy(upStream);
+  }
+  for (k = 0; k < 2; ++k) {
+    if (uploaded[k]) cudaEventDestroy(uploaded[k]);
+    if (ran[k]) cudaEventDestroy(ran[k]);
+  }
+  if (spare) {
+    NvVFX_SetImage(_eff, NVVFX_INPUT_IMAGE, &_srcGpuBuf);
+    _pool.release(spare);
+  }
+  return vfxErr;
+}
+
+// The shapes of the region buckets, as fractions of the frame. A region larger
+// than the largest is processed as a whole frame.
+static const float kRoiBucketFractions[] = {.25f, .375f, .5f, .75f};
+static const unsigned kRoiFeather = 16;  // Destination pixels
+
+// Create the region buckets for the frame size of _srcGpuBuf, each with an
+// instance of the effect loaded for its shape. A shape that the effect rejects,
+// e.g. as too small, is dropped. Bucket origins and sizes are multiples of
+// _roiDen source pixels, so that they scale to whole destination pixels.
+NvCV_Status FXApp::allocRoiBuckets(const FlagInfo &finfo, CUstream stream) {
+  const unsigned width = _srcGpuBuf.width, height = _srcGpuBuf.height;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  EffectBufferSpec spec;
+  unsigned g;
+
+  freeRoiBuckets();
+  if (!_chain.empty() || IsStatefulEffect(_effectName)) {
+    printf("Error: --roi_file needs a single effect that is not temporal\n");
+    return NVCV_ERR_FEATURENOTFOUND;
+  }
+  g = GreatestCommonDivisor(_dstGpuBuf.height, height);
+  _roiNum = _dstGpuBuf.height / g;
+  _roiDen = height / g;
+  if (width % _roiDen || height % _roiDen ||
+      (unsigned long long)width * _roiNum !=
+          (unsigned long long)_dstGpuBuf.width * _roiDen) {
+    printf("Error: %ux%u --> %ux%u cannot be divided into regions\n", width,
+           height, _dstGpuBuf.width, _dstGpuBuf.height);
+    return NVCV_ERR_RESOLUTION;
+  }
+
+  for (float f : kRoiBucketFractions) {
+    unsigned bw = ((unsigned)(width * f) + _roiDen - 1) / _roiDen * _roiDen,
+             bh = ((unsigned)(height * f) + _roiDen - 1) / _roiDen * _roiDen;
+    FlagInfo binfo = finfo;
+    if (!_roiBuckets.empty() && bw == _roiBuckets.back().width &&
+        bh == _roiBuckets.back().height)
+      continue;
+    _roiBuckets.emplace_back();
+    RoiBucket &b = _roiBuckets.back();
+    b.width = bw;
+    b.height = bh;
+    binfo.resolution = (int)(bh * _roiNum / _roiDen);  // For SuperRes
+    vfxErr = CreateOneEffect(_effectName, _modelDir.c_str(), &b.eff);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = SetOneEffectParams(b.eff, _effectName, binfo, stream);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = GetEffectBufferSpec(b.eff, _effectName, bw, bh, binfo, &spec);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = _pool.acquire(bw, bh, _srcGpuBuf.pixelFormat,
+                             _srcGpuBuf.componentType, _srcGpuBuf.planar,
+                             NVCV_GPU, AlignmentFor(&_srcGpuBuf), &b.srcPooled);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = _pool.acquire(spec.dstWidth, spec.dstHeight, spec.format,
+                             spec.type, spec.layout, NVCV_GPU, spec.alignment,
+                             &b.dstPooled);
+    if (NVCV_SUCCESS == vfxErr) {
+      NvCVImage_InitView(&b.src, b.srcPooled, 0, 0, bw, bh);
+      NvCVImage_InitView(&b.dst, b.dstPooled, 0, 0, spec.dstWidth,
+                         spec.dstHeight);
+      vfxErr = NvVFX_SetImage(b.eff, NVVFX_INPUT_IMAGE, &b.src);
+    }
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = NvVFX_SetImage(b.eff, NVVFX_OUTPUT_IMAGE, &b.dst);
+    if (NVCV_SUCCESS == vfxErr) vfxErr = NvVFX_Load(b.eff);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = NvCVImage_Alloc(&b.out, spec.dstWidth, spec.dstHeight,
+                               _dstVFX.pixelFormat, _dstVFX.componentType,
+                               _dstVFX.planar, NVCV_CPU_PINNED, 0);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = NvCVImage_Alloc(&b.matte, spec.dstWidth, spec.dstHeight, NVCV_A,
+                               NVCV_U8, NVCV_CHUNKY, NVCV_CPU, 0);
+    if (NVCV_SUCCESS != vfxErr) {
+      if (finfo.verbose)
+        printf("No %ux%u regions: %s\n", bw, bh,
+               NvCV_GetErrorStringFromCode(vfxErr));
+      NvVFX_DestroyEffect(b.eff);
+      _pool.release(b.srcPooled);
+      _pool.release(b.dstPooled);
+      _roiBuckets.pop_back();
+      vfxErr = NVCV_SUCCESS;
+    }
+  }
+  _roiFullFrames = _roiFrames = _roiPixels = 0;
+  if (finfo.verbose) {
+    printf("Region shapes:");
+    for (RoiBucket &b : _roiBuckets) printf(" %ux%u", b.width, b.height);
+    printf("%s\n", _roiBuckets.empty() ? " none; whole frames only" : "");
+  }
+  return vfxErr;
+}
+
+void FXApp::freeRoiBuckets() {
+  for (RoiBucket &b : _roiBuckets) {
+    NvVFX_DestroyEffect(b.eff);
+    _pool.release(b.srcPooled);
+    _pool.release(b.dstPooled);
+  }
+  _roiBuckets.clear();
+}
+
+// The smallest bucket that holds the source rectangle [x0, x1) x [y0, y1), or
+// nullptr if none does.
+static RoiBucket *FindRoiBucket(std::deque<RoiBucket> &buckets, unsigned x0,
+                                unsigned y0, unsigned x1, unsigned y1) {
+  for (RoiBucket &b : buckets)
+    if (x1 - x0 <= b.width && y1 - y0 <= b.height) return &b;
+  return nullptr;
+}
+
+// Place a window of the given size, a multiple of step, centered on [r0, r1),
+// on a multiple of step within [0, length).
+static unsigned PlaceRoiWindow(unsigned r0, unsigned r1, unsigned size,
+                               unsigned length, unsigned step) {
+  unsigned c = (r0 + r1) / 2, x = (c > size / 2) ? c - size / 2 : 0;
+  x -= x % step;
+  x = std::min(x, std::min(r0, length - size));
+  if (x + size < r1) x = r1 - size;
+  return x;
+}
+
+// Produce _dstVFX from src: the whole frame is resampled, then each region of
+// interest is run through the effect, in the smallest bucket that holds it, and
+// composited over the resampled frame, feathered along the edges that are not
+// those of the frame. The whole frame is run through the effect instead if a
+// region is larger than every bucket. The result is complete in _dstVFX on
+// return.
+NvCV_Status FXApp::processRegions(const NvCVImage *src,
+                                  const std::vector<RoiRect> &regions,
+                                  CUstream stream) {
+  const unsigned width = _srcVFX.width, height = _srcVFX.height;
+  const unsigned step = _roiDen;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  std::vector<std::pair<RoiBucket *, NvCVPoint2i>> jobs;
+  NvCVImage view;
+  bool whole = false;
+
+  ++_roiFrames;
+  for (const RoiRect &r : regions) {
+    // Round out to multiples of the step, clipped to the frame.
+    unsigned x0 = (unsigned)std::min(r.x, (int)width) / step * step,
+             y0 = (unsigned)std::min(r.y, (int)height) / step * step,
+             x1 = (unsigned)std::min((long long)r.x + r.width,
+                                     (long long)width),
+             y1 = (unsigned)std::min((long long)r.y + r.height,
+                                     (long long)height);
+    x1 = (x1 + step - 1) / step * step;
+    y1 = (y1 + step - 1) / step * step;
+    if (x1 <= x0 || y1 <= y0) continue;
+    RoiBucket *b = FindRoiBucket(_roiBuckets, x0, y0, x1, y1);
+    if (!b) {
+      whole = true;
+      break;
+    }
+    NvCVPoint2i org = {(int)PlaceRoiWindow(x0, x1, b->width, width, step),
+                       (int)PlaceRoiWindow(y0, y1, b->height, height, step)};
+    jobs.emplace_back(b, org);
+  }
+
+  if (src != &_srcVFX)  // YUV frames are converted for the resampler
+    BAIL_IF_ERR(vfxErr = TransferImage(src, &_srcVFX, 1.f, stream, &_tmpVFX));
+  if (whole) {  // A region too large for any bucket
+    ++_roiFullFrames;
+    _roiPixels += (unsigned long long)width * height;
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_srcGpuBuf, 1.f / 255.f,
+                                            stream, &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = runEffects(stream));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
+                                            stream, &_tmpVFX));
+    goto bail;
+  }
+  cv::resize(_srcImg, _dstImg, _dstImg.size(), 0, 0, cv::INTER_LINEAR);
+
+  for (auto &job : jobs) {
+    RoiBucket &b = *job.first;
+    NvCVPoint2i org = {(int)(job.second.x * _roiNum / _roiDen),
+                       (int)(job.second.y * _roiNum / _roiDen)};
+    unsigned edges = (job.second.x > 0 ? 1 : 0) |
+                     (job.second.y > 0 ? 2 : 0) |
+                     (job.second.x + b.width < width ? 4 : 0) |
+                     (job.second.y + b.height < height ? 8 : 0);
+    ++b.regions;
+    _roiPixels += (unsigned long long)b.width * b.height;
+    NvCVImage_InitView(&view, &_srcVFX, job.second.x, job.second.y, b.width,
+                       b.height);
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&view, &b.src, 1.f / 255.f, stream,
+                                            &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = NvVFX_Run(b.eff, 0));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&b.dst, &b.out, 255.f, stream,
+                                            &_tmpVFX));
+    // b.out is pinned, so the download must complete before compositing.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    if (edges != b.matteEdges)
+      MakeFeatherMatte((edges & 1) ? kRoiFeather : 0,
+                       (edges & 2) ? kRoiFeather : 0,
+                       (edges & 4) ? kRoiFeather : 0,
+                       (edges & 8) ? kRoiFeather : 0, &b.matte);
+    b.matteEdges = edges;
+    BAIL_IF_ERR(vfxErr = NvCVImage_CompositeRect(&b.out, nullptr, &_dstVFX,
+                                                 &org, &b.matte, 0, &_dstVFX,
+                                                 &org, stream));
+  }
+bail:
+  if (NVCV_SUCCESS == vfxErr)  // The whole frame is downloaded asynchronously
+    vfxErr = CudaStatus(cudaStreamSynchronize(stream));
+  return vfxErr;
+}
+
+void FXApp::printRoiStats() {
+  if (!_roiFrames) return;
+  printf("Regions:");
+  for (RoiBucket &b : _roiBuckets)
+    printf(" %llu of %ux%u,", b.regions, b.width, b.height);
+  printf(" %llu whole frames; the effect ran on %.1f%% of the frame area\n",
+         _roiFullFrames,
+         100. * _roiPixels /
+             ((double)_roiFrames * _srcGpuBuf.width * _srcGpuBuf.height));
+}
+
+static const unsigned kDirtyHalo = 16;  // Source pixels of context
+static const unsigned char kDirtyTolerance = 2;  // Levels of codec noise
+
+// Load the tile instance of the effect, for the frame size of _srcGpuBuf. Tiles
+// and halos are multiples of den source pixels, so that they scale to whole
+// destination pixels.
+NvCV_Status FXApp::allocDirtyTiles(const FlagInfo &finfo, CUstream stream) {
+  const unsigned width = _srcGpuBuf.width, height = _srcGpuBuf.height;
+  DirtyTiles &d = _dirty;
+  NvCV_Status vfxErr;
+  EffectBufferSpec spec;
+  FlagInfo tinfo = finfo;
+  unsigned g;
+
+  freeDirtyTiles();
+  if (!_chain.empty() || IsStatefulEffect(_effectName)) {
+    printf("Error: --dirty_tiles needs a single effect that is not temporal\n");
+    return NVCV_ERR_FEATURENOTFOUND;
+  }
+  g = GreatestCommonDivisor(_dstGpuBuf.height, height);
+  d.num = _dstGpuBuf.height / g;
+  d.den = height / g;
+  d.tile = ((unsigned)finfo.dirtyTile + d.den - 1) / d.den * d.den;
+  d.halo = (kDirtyHalo + d.den - 1) / d.den * d.den;
+  d.windowWidth = std::min(d.tile + 2 * d.halo, width);
+  d.windowHeight = std::min(d.tile + 2 * d.halo, height);
+  if (width % d.den || height % d.den ||
+      (unsigned long long)width * d.num !=
+          (unsigned long long)_dstGpuBuf.width * d.den) {
+    printf("Error: %ux%u --> %ux%u cannot be divided into tiles\n", width,
+           height, _dstGpuBuf.width, _dstGpuBuf.height);
+    return NVCV_ERR_RESOLUTION;
+  }
+  d.cols = (width + d.tile - 1) / d.tile;
+  d.rows = (height + d.tile - 1) / d.tile;
+
+  tinfo.resolution = (int)(d.windowHeight * d.num / d.den);  // For SuperRes
+  BAIL_IF_ERR(vfxErr = CreateOneEffect(_effectName, _modelDir.c_str(), &d.eff));
+  BAIL_IF_ERR(vfxErr = SetOneEffectParams(d.eff, _effectName, tinfo, stream));
+  BAIL_IF_ERR(vfxErr = GetEffectBufferSpec(d.eff, _effectName, d.windowWidth,
+                                           d.windowHeight, tinfo, &spec));
+  BAIL_IF_ERR(vfxErr = allocGpuBuf(
+                  &d.src, &d.srcPooled, d.windowWidth, d.windowHeight,
+                  _srcGpuBuf.pixelFormat, _srcGpuBuf.componentType,
+                  _srcGpuBuf.planar, NVCV_GPU, AlignmentFor(&_srcGpuBuf)));
+  BAIL_IF_ERR(vfxErr = allocGpuBuf(&d.dst, &d.dstPooled, spec.dstWidth,
+                                   spec.dstHeight, spec.format, spec.type,
+                                   spec.layout, NVCV_GPU, spec.alignment));
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(d.eff, NVVFX_INPUT_IMAGE, &d.src));
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(d.eff, NVVFX_OUTPUT_IMAGE, &d.dst));
+  BAIL_IF_ERR(vfxErr = NvVFX_Load(d.eff));
+  d.refImg.allocator = &_hostAllocator;
+  d.refImg.create(_srcImg.rows, _srcImg.cols, _srcImg.type());
+  BAIL_IF_NULL(d.refImg.data, vfxErr, NVCV_ERR_MEMORY);
+  if (finfo.verbose)
+    printf("%ux%u tiles of %ux%u, run in %ux%u windows\n", d.cols, d.rows,
+           d.tile, d.tile, d.windowWidth, d.windowHeight);
+bail:
+  return vfxErr;
+}
+
+void FXApp::freeDirtyTiles() {
+  NvVFX_DestroyEffect(_dirty.eff);
+  _pool.release(_dirty.srcPooled);
+  _pool.release(_dirty.dstPooled);
+  _dirty = DirtyTiles();
+}
+
+// Produce _dstVFX from src, running only the tiles that differ from the source
+// they were last run with, or the whole frame every refresh frames, or if so
+// many tiles have changed that it would be quicker. Each tile is run with a halo of
+// context around it, which is then cropped away, and the rest of its output is
+// transferred into the output of the last whole frame on the GPU, and then
+// downloaded, so only the tiles that change are transferred either way.
+// Comparing with the source of the output, rather than with the last frame,
+// keeps a slow drift from going unnoticed. The result is complete in _dstVFX
+// on return.
+NvCV_Status FXApp::processDirtyTiles(const NvCVImage *src, unsigned refresh,
+                                     CUstream stream) {
+  const unsigned width = _srcVFX.width, height = _srcVFX.height;
+  DirtyTiles &d = _dirty;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  bool whole = !d.valid || (refresh > 0 && ++d.sinceWhole >= refresh);
+
+  if (src != &_srcVFX)  // YUV frames are converted for the comparison
+    BAIL_IF_ERR(vfxErr = TransferImage(src, &_srcVFX, 1.f, stream, &_tmpVFX));
+  d.changed.clear();
+  for (unsigned i = 0; !whole && i < d.cols * d.rows; ++i) {
+    unsigned x = i % d.cols * d.tile, y = i / d.cols * d.tile,
+             w = std::min(d.tile, width - x), h = std::min(d.tile, height - y);
+    size_t offset =
+        (size_t)y * _srcImg.step[0] + (size_t)x * _srcImg.elemSize();
+    if (RegionsDiffer(_srcImg.data + offset, (int)_srcImg.step[0],
+                      d.refImg.data + offset, (int)d.refImg.step[0],
+                      w * (unsigned)_srcImg.elemSize(), h, kDirtyTolerance))
+      d.changed.push_back(i);
+  }
+
+  if (whole || 2 * d.changed.size() > (size_t)d.cols * d.rows) {
+    ++d.wholeFrames;
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_srcGpuBuf, 1.f / 255.f,
+                                            stream, &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = runEffects(stream));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
+                                            stream, &_tmpVFX));
+    _srcImg.copyTo(d.refImg);
+    d.valid = true;
+    d.sinceWhole = 0;
+    goto bail;
+  }
+
+  ++d.partialFrames;
+  for (unsigned i : d.changed) {
+    unsigned x = i % d.cols * d.tile, y = i / d.cols * d.tile,
+             w = std::min(d.tile, width - x), h = std::min(d.tile, height - y);
+    unsigned wx = std::min(x > d.halo ? x - d.halo : 0, width - d.windowWidth),
+             wy = std::min(y > d.halo ? y - d.halo : 0,
+                           height - d.windowHeight);
+    NvCVRect2i window = {(int)wx, (int)wy, (int)d.windowWidth,
+                         (int)d.windowHeight};
+    NvCVRect2i inner = {(int)((x - wx) * d.num / d.den),
+                        (int)((y - wy) * d.num / d.den),
+                        (int)(w * d.num / d.den), (int)(h * d.num / d.den)};
+    NvCVRect2i tile = {(int)(x * d.num / d.den), (int)(y * d.num / d.den),
+                       inner.width, inner.height};
+    NvCVPoint2i at = {tile.x, tile.y};
+    ++d.tilesRun;
+    BAIL_IF_ERR(vfxErr = NvCVImage_TransferRect(&_srcVFX, &window, &d.src,
+                                                nullptr, 1.f / 255.f, stream,
+                                                &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = NvVFX_Run(d.eff, 0));
+    BAIL_IF_ERR(vfxErr = NvCVImage_TransferRect(&d.dst, &inner, &_dstGpuBuf,
+                                                &at, 1.f, stream, nullptr));
+    BAIL_IF_ERR(vfxErr = NvCVImage_TransferRect(&_dstGpuBuf, &tile, &_dstVFX,
+                                                &at, 255.f, stream, &_tmpVFX));
+    _srcImg(cv::Rect(x, y, w, h)).copyTo(d.refImg(cv::Rect(x, y, w, h)));
+  }
+bail:
+  // _dstVFX is pinned, so its downloads complete only after synchronizing.
+  if (NVCV_SUCCESS == vfxErr)
+    vfxErr = CudaStatus(cudaStreamSynchronize(stream));
+  return vfxErr;
+}
+
+void FXApp::printDirtyTileStats() {
+  unsigned long long frames = _dirty.wholeFrames + _dirty.partialFrames;
+  if (!frames) return;
+  printf("Dirty tiles: %llu whole frames, and %llu tiles of %llu in the other "
+         "%llu frames (%.1f%%)\n",
+         _dirty.wholeFrames, _dirty.tilesRun,
+         _dirty.partialFrames * _dirty.cols * _dirty.rows, _dirty.partialFrames,
+         _dirty.partialFrames
+             ? 100. * _dirty.tilesRun /
+                   (_dirty.partialFrames * _dirty.cols * _dirty.rows)
+             : 0.);
+}
+
+bool FXApp::chainHasMode() const {
+  if (HasModeParam(_effectName)) return true;
+  for (const ChainLink &link : _chain)
+    if (HasModeParam(link.name.c_str())) return true;
+  return false;
+}
+
+// Whether the effect's output is the height given by --resolution.
+static bool HasResolutionParam(const char *effectName) {
+  return !strcmp(effectName, NVVFX_FX_SUPER_RES) ||
+         !strcmp(effectName, NVVFX_FX_SR_UPSCALE);
+}
+
+// The configurations that --deadline steps down through, from the one asked
+// for to the cheapest: conservative mode, then lower output resolutions that
+// are still whole scales of the input, then the last of those on alternate
+// frames only. Conservative mode and lower resolutions are only offered for a
+// single effect, which is loaded once for each, and lower resolutions only for
+// an upscaling effect whose output can be resized back up to the size it was
+// opened at.
+void FXApp::buildQualityLadder(const FlagInfo &finfo, unsigned height,
+                               bool resize) {
+  static const unsigned kScales[][2] = {{4, 1}, {3, 1}, {2, 1}, {3, 2}, {4, 3}};
+  QualityLevel q = {finfo.mode, finfo.resolution, false};
+  _quality.assign(1, q);
+  if (q.mode && HasModeParam(_effectName) && _chain.empty()) {
+    q.mode = 0;
+    _quality.push_back(q);
+  }
+  if (resize && finfo.resolution > 0 && HasResolutionParam(_effectName) &&
+      _chain.empty()) {
+    for (const unsigned *scale : kScales) {
+      unsigned res = height * scale[0] / scale[1];
+      if (res * scale[1] != height * scale[0] || res >= (unsigned)q.resolution)
+        continue;
+      q.resolution = (int)res;
+      _quality.push_back(q);
+    }
+  }
+  q.alternate = true;
+  _quality.push_back(q);
+}
+
+std::string FXApp::describeQualityLevel(unsigned level) const {
+  const QualityLevel &q = _quality[level];
+  std::string str;
+  if (chainHasMode())
+    str = q.mode ? "aggressive mode, " : "conservative mode, ";
+  if (q.resolution) str += std::to_string(q.resolution) + "p, ";
+  return str + (q.alternate ? "alternate frames" : "every frame");
+}
+
+// Load an instance of the effect for each level of the ladder whose mode or
+// resolution differs from those of the level above, so that switching levels
+// while the video plays does not stall. Levels for which the effect cannot be
+// loaded are dropped.
+NvCV_Status FXApp::allocQualityInstances(const FlagInfo &finfo,
+                                         CUstream stream) {
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  EffectBufferSpec spec;
+
+  freeQualityInstances();
+  for (size_t i = 1; i < _quality.size(); ++i) {
+    QualityLevel &q = _quality[i];
+    const QualityLevel &above = _quality[i - 1];
+    FlagInfo linfo = finfo;
+    q.instance = above.instance;
+    if (q.mode == above.mode && q.resolution == above.resolution) continue;
+    linfo.mode = q.mode;
+    linfo.resolution = q.resolution;
+    _qualityInstances.emplace_back();
+    QualityInstance &qi = _qualityInstances.back();
+    vfxErr = CreateOneEffect(_effectName, _modelDir.c_str(), &qi.eff);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = SetOneEffectParams(qi.eff, _effectName, linfo, stream);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = GetEffectBufferSpec(qi.eff, _effectName, _srcGpuBuf.width,
+                                   _srcGpuBuf.height, linfo, &spec);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = _pool.acquire(spec.dstWidth, spec.dstHeight, spec.format,
+                             spec.type, spec.layout, NVCV_GPU, spec.alignment,
+                             &qi.dstPooled);
+    if (NVCV_SUCCESS == vfxErr) {
+      NvCVImage_InitView(&qi.dst, qi.dstPooled, 0, 0, spec.dstWidth,
+                         spec.dstHeight);
+      vfxErr = NvVFX_SetImage(qi.eff, NVVFX_INPUT_IMAGE, &_srcGpuBuf);
+    }
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = NvVFX_SetImage(qi.eff, NVVFX_OUTPUT_IMAGE, &qi.dst);
+    if (NVCV_SUCCESS == vfxErr) vfxErr = NvVFX_Load(qi.eff);
+    if (NVCV_SUCCESS == vfxErr)
+      vfxErr = NvCVImage_Alloc(&qi.out, spec.dstWidth, spec.dstHeight,
+                               _dstVFX.pixelFormat, _dstVFX.componentType,
+                               _dstVFX.planar, NVCV_CPU_PINNED, 0);
+    if (NVCV_SUCCESS != vfxErr) {
+      if (finfo.verbose)
+        printf("No level of %s: %s\n",
+               describeQualityLevel((unsigned)i).c_str(),
+               NvCV_GetErrorStringFromCode(vfxErr));
+      NvVFX_DestroyEffect(qi.eff);
+      _pool.release(qi.dstPooled);
+      _qualityInstances.pop_back();
+      _quality.erase(_quality.begin() + i--);
+      vfxErr = NVCV_SUCCESS;
+      continue;
+    }
+    CVWrapperForNvCVImage(&qi.out, &qi.outImg);
+    q.instance = &qi;
+  }
+  return vfxErr;
+}
+
+void FXApp::freeQualityInstances() {
+  for (QualityInstance &qi : _qualityInstances) {
+    NvVFX_DestroyEffect(qi.eff);
+    _pool.release(qi.dstPooled);
+  }
+  _qualityInstances.clear();
+  for (QualityLevel &q : _quality) q.instance = nullptr;
+}
+
+void FXApp::printQualityStats(const QualityController &controller) {
+  printf("Deadline: %llu switches of level\n", controller.switches());
+  for (const QualityLevel &q : _quality)
+    printf("  %s: %llu frames\n",
+           describeQualityLevel((unsigned)(&q - _quality.data())).c_str(),
+           q.frames);
+}
+
+FXApp::Err FXApp::processMovie(const char *inFile, const char *outFile,
+                               const FlagInfo &finfo,
+                               progressCallback cb = nullptr) {
+  const int fourcc_h264 = cv::VideoWriter::fourcc('H', '2', '6', '4');
+  CUstream stream = 0;
+  FXApp::Err appErr = errNone;
+  bool ok;
+  cv::VideoCapture reader;
+  cv::VideoWriter writer;
+  RawVideoReader rawReader;  // Y4M or headerless input, mapped into memory
+  RawVideoWriter rawWriter;  // Y4M or headerless output, written behind
+  RawVideoFormat rawFmt, outFmt;
+  RoiTrack roiTrack;
+  FrameSignature sig, lastSig;  // Of this frame, and of the last one processed
+  const std::vector<RoiRect> *lastRegions = nullptr;
+  bool lastEnabled = false, skipping = finfo.skipDuplicates >= 0.f;
+  float threshold = finfo.skipDuplicates;
+  unsigned long long repeated = 0;
+  QualityController quality;  // With --deadline
+  bool capturing = false;  // On a thread of its own, with --webcam or --realtime
+  FrameMailbox mailbox;
+  cv::Mat captured[FrameMailbox::kSlots];
+  unsigned capturedNum[FrameMailbox::kSlots] = {};
+  LatencyTrace::Stamps capturedStamps[FrameMailbox::kSlots];
+  std::thread capture;
+  auto stopCapture = [&]() {
+    mailbox.close();
+    if (capture.joinable()) capture.join();
+  };
+  bool controlling = finfo.deadline >= 0.f;
+  unsigned level = 0;
+  cv::Mat overlaid;
+  NvCV_Status vfxErr;
+  unsigned frameNum = 0;
+  VideoInfo vinfo;
+  NvCVImage srcView, dstView;
+  bool rawIn, y4mIn, rawOut = false, bgrNoticed = false, writeFailed = false;
+
+  if (inFile && !inFile[0])
+    inFile = nullptr;  // Set file paths to NULL if zero length
+  if (outFile && !outFile[0]) outFile = nullptr;
+
+  _yuvLayout = YUVLayoutFromName(finfo.yuv);
+  if (!finfo.yuv.empty()) {
+    if (!_yuvLayout) {
+      printf("Error: unknown --yuv format \"%s\"\n", finfo.yuv.c_str());
+      return errFlag;
+    }
+    if (finfo.segments > 1 || finfo.batchSize > 0 || finfo.async ||
+        finfo.pipelineDepth > 1) {
+      printf("Error: --yuv cannot be used with --segments, --batch, --async "
+             "or --pipeline_depth\n");
+      return errFlag;
+    }
+  }
+  if (!finfo.rawFormat.empty() &&
+      !ParseRawVideoFormat(finfo.rawFormat, &rawFmt))
+    return errFlag;
+  rawIn = inFile && !finfo.webcam && IsRawVideoFile(inFile);
+  y4mIn = rawIn && (IsY4MFile(inFile) ||
+                    (IsStdioPath(inFile) && finfo.rawFormat.empty()));
+  if ((rawIn || (outFile && IsRawVideoFile(outFile))) &&
+      (finfo.segments > 1 || finfo.batchSize > 0 || finfo.async ||
+       finfo.pipelineDepth > 1)) {
+    printf("Error: Y4M and raw video cannot be used with --segments, --batch, "
+           "--async or --pipeline_depth\n");
+    return errFlag;
+  }
+
+  if ((!finfo.roiFile.empty() || skipping || finfo.dirtyTile > 0) &&
+      (finfo.segments > 1 || finfo.batchSize > 0 || finfo.async ||
+       finfo.pipelineDepth > 1)) {
+    printf("Error: --roi_file, --skip_duplicates and --dirty_tiles cannot be "
+           "used with --segments, --batch, --async or --pipeline_depth\n");
+    return errFlag;
+  }
+  if (!finfo.roiFile.empty() && finfo.dirtyTile > 0) {
+    printf("Error: --roi_file cannot be used with --dirty_tiles\n");
+    return errFlag;
+  }
+  if (!finfo.roiFile.empty() && !roiTrack.load(finfo.roiFile.c_str()))
+    return errRead;
+  if (finfo.realtime && (rawIn || finfo.webcam || !inFile)) {
+    printf("Error: --realtime needs a video file that is neither Y4M nor raw\n");
+    return errFlag;
+  }
+  if (finfo.realtime && (finfo.segments > 1 || finfo.batchSize > 0 ||
+                         finfo.async || finfo.pipelineDepth > 1)) {
+    printf("Error: --realtime cannot be used with --segments, --batch, "
+           "--async or --pipeline_depth\n");
+    return errFlag;
+  }
+  if ((finfo.latency || finfo.latencyOverlay || !finfo.traceFile.empty()) &&
+      (finfo.segments > 1 || finfo.batchSize > 0 || finfo.async)) {
+    printf("Error: --latency, --latency_overlay and --trace_file cannot be "
+           "used with --segments, --batch or --async\n");
+    return errFlag;
+  }
+  if (controlling &&
+      (finfo.segments > 1 || finfo.batchSize > 0 || finfo.async ||
+       finfo.pipelineDepth > 1 || !finfo.roiFile.empty() ||
+       finfo.dirtyTile > 0)) {
+    printf("Error: --deadline cannot be used with --segments, --batch, "
+           "--async, --pipeline_depth, --roi_file or --dirty_tiles\n");
+    return errFlag;
+  }
+
+  if (!finfo.cacheDir.empty() && inFile && outFile && !finfo.webcam &&
+      !_show && !controlling && !finfo.realtime && !IsStdioPath(inFile) &&
+      !IsStdioPath(outFile))
+    return processMovieCached(inFile, outFile, finfo, cb);
+
+  // A temporal effect integrates the small differences between frames, so for
+  // it only exact repeats are skipped; a run of them is seen as one frame.
+  if (skipping && IsStatefulEffect(_effectName)) threshold = 0.f;
+  for (ChainLink &link : _chain)
+    if (skipping && IsStatefulEffect(link.name.c_str())) threshold = 0.f;
+
+  if (finfo.segments > 1 && !finfo.webcam)
+    return processMovieSegments(inFile, outFile, finfo, cb);
+  if (!_chain.empty() && (finfo.batchSize > 0 || finfo.async)) {
+    printf("Error: a chain of effects cannot be used with --batch or --async\n");
+    return errFlag;
+  }
+  // A batch runs consecutive frames at once, each with a state of its own,
+  // which would break the temporal continuity that the state carries.
+  if (finfo.batchSize > 0 && IsStatefulEffect(_effectName)) {
+    printf("Error: --batch cannot be used with %s, which keeps state from "
+           "frame to frame\n",
+           _effectName);
+    return errFlag;
+  }
+
+  if (rawIn) {
+    if (!y4mIn && finfo.rawFormat.empty()) {
+      printf("Error: the format of \"%s\" must be given, e.g. "
+             "--raw_format=nv12:1920x1080@30\n",
+             inFile);
+      return errFlag;
+    }
+    if (!rawReader.open(inFile, y4mIn ? nullptr : &rawFmt)) return errRead;
+    vinfo.codec = StringToFourcc(y4mIn ? "Y4M " : "raw ");
+    vinfo.width = (int)rawReader.format().width;
+    vinfo.height = (int)rawReader.format().height;
+    vinfo.frameRate = rawReader.format().frameRate;
+    vinfo.frameCount = rawReader.frameCount();
+    if (finfo.verbose) PrintVideoInfo(inFile, vinfo);
+  } else {
+    if (!finfo.webcam && inFile) {
+      reader.open(inFile);
+    } else {
+      appErr = initCamera(reader, finfo);
+      if (appErr != errNone) return appErr;
+    }
+
+    if (!reader.isOpened()) {
+      if (!finfo.webcam)
+        printf("Error: Could not open video: \"%s\"\n", inFile);
+      else
+        printf("Error: Webcam not found\n");
+      return errRead;
+    }
+
+    GetVideoInfo(reader, (inFile ? inFile : "webcam"), &vinfo, finfo);
+    if (_yuvLayout && !finfo.webcam)  // Backends that can, deliver 4:2:0 as is
+      reader.set(cv::CAP_PROP_CONVERT_RGB, 0.);
+    if (!(fourcc_h264 == vinfo.codec ||
+          cv::VideoWriter::fourcc('a', 'v', 'c', '1') ==
+              vinfo.codec))  // avc1 is alias for h264
+      printf("Filters only target H264 videos, not %.4s\n",
+             (char *)&vinfo.codec);
+  }
+
+  if (!ParseYUVColorspace(finfo.yuvColorspace, vinfo.height, &_yuvColorspace))
+    return errFlag;
+  BAIL_IF_ERR(vfxErr = allocBuffers(vinfo.width, vinfo.height, finfo));
+  if (rawIn && finfo.yuvColorspace.empty() &&
+      rawReader.format().hasColorspace)  // As tagged in the Y4M header
+    _yuvColorspace = (_yuvColorspace & ~(NVCV_FULL_RANGE |
+                                         NVCV_CHROMA_INTSTITIAL |
+                                         NVCV_CHROMA_TOPLEFT)) |
+                     rawReader.format().colorspace;
+
+  if (outFile && IsRawVideoFile(outFile)) {
+    // Frames are written in the format of --raw_format, else that of the raw
+    // input, else that of --yuv, else I420, at the size of the effect output.
+    if (!finfo.rawFormat.empty()) {
+      outFmt = rawFmt;
+    } else if (rawIn) {
+      outFmt = rawReader.format();
+    } else {
+      outFmt.format = NVCV_YUV420;
+      outFmt.layout = _yuvLayout ? _yuvLayout : NVCV_I420;
+    }
+    if (IsY4MFile(outFile)) outFmt = Y4MFormatFor(outFmt);
+    outFmt.width = _dstVFX.width;
+    outFmt.height = _dstVFX.height;
+    outFmt.frameRate = vinfo.frameRate;
+    outFmt.colorspace = _yuvColorspace;
+    if ((NVCV_YUV420 == outFmt.format && ((outFmt.width | outFmt.height) & 1)) ||
+        (NVCV_YUV422 == outFmt.format && (outFmt.width & 1))) {
+      printf("Error: a %ux%u output is not a whole number of chroma samples\n",
+             outFmt.width, outFmt.height);
+      return errResolution;
+    }
+    if (!rawWriter.open(outFile, outFmt, IsY4MFile(outFile))) return errWrite;
+    rawOut = true;
+  } else if (outFile) {
+    ok = writer.open(outFile, StringToFourcc(finfo.codec), vinfo.frameRate,
+                     cv::Size(_dstVFX.width, _dstVFX.height));
+    if (!ok) {
+      printf("Cannot open \"%s\" for video writing\n", outFile);
+      outFile = nullptr;
+      if (!_show) return errWrite;
+    }
+  }
+
+  // Created only once nothing returns without going through bail, which
+  // destroys it.
+  if (finfo.async) BAIL_IF_ERR(vfxErr = NvVFX_CudaStreamCreate(&stream));
+  if (finfo.batchSize > 0) {
+    // The effect is bound to the first image of each batch buffer, and told
+    // how many images follow it.
+    BAIL_IF_ERR(vfxErr = allocBatchBuffers((unsigned)finfo.batchSize));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetImage(
+                    _eff, NVVFX_INPUT_IMAGE,
+                    NthImage(0, _srcGpuBuf.height, &_srcBatchBuf, &srcView)));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetImage(
+                    _eff, NVVFX_OUTPUT_IMAGE,
+                    NthImage(0, _dstGpuBuf.height, &_dstBatchBuf, &dstView)));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetU32(_eff, NVVFX_BATCH_SIZE,
+                                      (unsigned)finfo.batchSize));
+    BAIL_IF_ERR(vfxErr = NvVFX_SetU32(
+                    _eff, NVVFX_MODEL_BATCH,
+                    (unsigned)(finfo.modelBatch ? finfo.modelBatch
+                                                : finfo.batchSize)));
+  } else {
+    BAIL_IF_ERR(vfxErr = bindEffectImages());
+  }
+  BAIL_IF_ERR(vfxErr = setEffectParams(finfo, stream));
+  BAIL_IF_ERR(vfxErr = loadEffects());
+  BAIL_IF_ERR(vfxErr = bindSingleStreamState());
+  if (!finfo.roiFile.empty())
+    BAIL_IF_ERR(vfxErr = allocRoiBuckets(finfo, stream));
+  if (finfo.dirtyTile > 0)
+    BAIL_IF_ERR(vfxErr = allocDirtyTiles(finfo, stream));
+  if (controlling) {  // Raw frames cannot be resized as they are written
+    buildQualityLadder(finfo, vinfo.height, !rawOut);
+    BAIL_IF_ERR(vfxErr = allocQualityInstances(finfo, stream));
+    quality.init(finfo.deadline > 0.f ? finfo.deadline
+                 : vinfo.frameRate > 0. ? 1000. / vinfo.frameRate
+                                        : 1000. / 30.,
+                 (unsigned)_quality.size());
+    if (finfo.verbose) {
+      printf("Keeping the effect within %.1f ms per frame, with:\n",
+             quality.deadline());
+      for (unsigned i = 0; i < _quality.size(); ++i)
+        printf("  %u: %s\n", i, describeQualityLevel(i).c_str());
+    }
+  }
+
+  if (finfo.batchSize > 0) {
+    appErr = processMovieBatched(reader, writer, outFile != nullptr, vinfo,
+                                 finfo, cb);
+    if (stream) NvVFX_CudaStreamDestroy(stream);  // --async, overridden
+    reader.release();
+    if (outFile) writer.release();
+    return appErr;
+  }
+
+  if (finfo.async) {
+    appErr = processMovieAsync(reader, writer, outFile != nullptr, stream,
+                               vinfo, finfo, cb);
+    NvVFX_CudaStreamDestroy(stream);
+    reader.release();
+    if (outFile) writer.release();
+    return appErr;
+  }
+
+  if (finfo.pipelineDepth > 1) {
+    appErr = processMoviePipelined(reader, writer, outFile != nullptr, vinfo,
+                                   finfo, cb);
+    reader.release();
+    if (outFile) writer.release();
+    return appErr;
+  }
+
+  beginStats(finfo, vinfo.frameCount);
+
+  // A camera, or a file read as if it were one, is captured on a thread of its
+  // own, so that frames do not queue up in the driver while the effect is busy:
+  // the effect always takes the newest frame, and the others are dropped.
+  if (finfo.webcam || finfo.realtime) {
+    capturing = true;
+    for (cv::Mat &m : captured) {
+      m.allocator = &_hostAllocator;  // Decoded straight into pinned memory
+      m.create(_srcImg.rows, _srcImg.cols, _srcImg.type());
+    }
+    capture = std::thread([&]() {
+      const double period = 1. / (vinfo.frameRate > 0. ? vinfo.frameRate : 30.);
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (unsigned n = 0; !mailbox.closed(); ++n) {
+        unsigned slot = mailbox.fillSlot();
+        if (finfo.realtime)  // At the pace of the file
+          std::this_thread::sleep_until(
+              start + std::chrono::duration_cast<
+                          std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(n * period)));
+        if (!reader.read(captured[slot])) break;
+        _trace.stamp(&capturedStamps[slot], LatencyTrace::CAPTURE);
+        capturedNum[slot] = n;
+        mailbox.publish();
+      }
+      mailbox.close();
+    });
+  }
+
+  for (frameNum = 0;; ++frameNum) {
+    StageTimer::Clock::time_point t = _timer.now();
+    LatencyTrace::Stamps stamps;
+    unsigned slot = 0;
+    if (capturing && !mailbox.take(&slot)) break;
+    cv::Mat &frame = capturing    ? captured[slot]
+                     : _yuvLayout ? _srcYUVImg
+                                  : _srcImg;
+    NvCVImage *srcVFX = &_srcVFX, frameVFX, outVFX;
+    if (rawIn) {  // A view of the mapped file; nothing is decoded or copied
+      if (!rawReader.read(&frameVFX)) break;
+      frameVFX.colorspace = (unsigned char)_yuvColorspace;
+      srcVFX = &frameVFX;
+    } else if (!capturing && !reader.read(frame)) {
+      break;
+    }
+    if (!skipping)  // Else marked once the signature is also computed
+      t = _timer.mark(StageTimer::DECODE, t);
+    if (capturing) {
+      stamps = capturedStamps[slot];
+    } else {
+      _trace.stamp(&stamps, LatencyTrace::CAPTURE);
+    }
+    stamps.frame = capturing ? capturedNum[slot] : frameNum;
+    if (!rawIn && frame.empty()) {
+      printf("Frame %u is empty\n", frameNum);
+    }
+    if (capturing && !_yuvLayout) {  // The captured frame, rather than _srcImg
+      NVWrapperForPinnedCVMat(&frame, &frameVFX);
+      srcVFX = &frameVFX;
+    }
+
+    // With --yuv, the decoder's 4:2:0 frames are converted directly to and
+    // from the effect's format, unless the backend could only deliver BGR.
+    if (!rawIn && _yuvLayout) {
+      if (CV_8UC1 == frame.type() && frame.cols == vinfo.width &&
+          frame.rows == vinfo.height * 3 / 2) {
+        NvCVImage_Init(&frameVFX, vinfo.width, vinfo.height, (int)frame.step[0],
+                       frame.data, NVCV_YUV420, NVCV_U8, _yuvLayout,
+                       PinnedMatAllocator::memSpaceOf(&frame));
+        frameVFX.colorspace = (unsigned char)_yuvColorspace;
+      } else {
+        if (CV_8UC3 != frame.type()) {
+          printf("Frame %u is neither 4:2:0 nor BGR\n", frameNum);
+          BAIL_IF_ERR(vfxErr = NVCV_ERR_PIXELFORMAT);
+        }
+        if (!bgrNoticed)
+          printf("The video backend decodes to BGR; converting from BGR\n");
+        bgrNoticed = true;
+        NVWrapperForPinnedCVMat(&frame, &frameVFX);
+      }
+      srcVFX = &frameVFX;
+    }
+
+    // A frame that repeats the last one processed, with the same regions and
+    // the effect in the same state, reuses its output, which is still in
+    // _dstVFX. Comparing with the last frame processed, rather than the last
+    // frame, keeps a slow drift from being skipped indefinitely.
+    bool repeat = false;
+    const std::vector<RoiRect> *regions = &roiTrack.regions(frameNum);
+    if (skipping) {
+      sig.compute(srcVFX, threshold > 0.f);
+      repeat = _enableEffect == lastEnabled && regions == lastRegions &&
+               sig.matches(lastSig, threshold);
+      t = _timer.mark(StageTimer::DECODE, t);  // With the signature, as ingest
+    }
+
+    // The writer thread hands back a buffer once it has written it out, so
+    // the time spent waiting here is that of the output.
+    if (rawOut) {
+      if (!rawWriter.acquire(&outVFX)) {
+        printf("Error writing: \"%s\"\n", outFile);
+        writeFailed = true;
+        break;
+      }
+      t = _timer.mark(StageTimer::ENCODE, t);
+    }
+
+    // At the cheapest level of --deadline, the effect is bypassed on alternate
+    // frames, which repeat the output of the frame before.
+    bool bypass = controlling && _enableEffect && !repeat &&
+                  _quality[level].alternate && (frameNum & 1);
+    QualityInstance *qi = controlling ? _quality[level].instance : nullptr;
+    std::chrono::steady_clock::time_point effectStart =
+        std::chrono::steady_clock::now();
+    _trace.stamp(&stamps, LatencyTrace::PRE_UPLOAD);
+
+    // _srcVFX   --> _srcTmpVFX --> _srcGpuBuf --> _dstGpuBuf --> _dstTmpVFX -->
+    // _dstVFX
+    if (repeat || bypass) {
+      if (repeat) ++repeated;
+      t = _timer.mark(StageTimer::UPLOAD, t);  // Keep the stage rows aligned
+      t = _timer.mark(StageTimer::RUN, t);
+      if (rawOut)
+        BAIL_IF_ERR(vfxErr = TransferImage(&_dstVFX, &outVFX, 1.f, stream,
+                                           &_tmpVFX));
+    } else if (_enableEffect && finfo.dirtyTile > 0) {
+      // Uploads and runs are interleaved, tile by tile, and timed as a run.
+      t = _timer.mark(StageTimer::UPLOAD, t);  // Keep the stage rows aligned
+      BAIL_IF_ERR(vfxErr = processDirtyTiles(
+                      srcVFX, (unsigned)std::max(finfo.dirtyRefresh, 0),
+                      stream));
+      t = _timer.mark(StageTimer::RUN, t);
+      _trace.stamp(&stamps, LatencyTrace::POST_RUN);
+      if (rawOut)
+        BAIL_IF_ERR(vfxErr = TransferImage(&_dstVFX, &outVFX, 1.f, stream,
+                                           &_tmpVFX));
+    } else if (_enableEffect && !finfo.roiFile.empty()) {
+      // Uploads and runs are interleaved, region by region, and timed as a run.
+      t = _timer.mark(StageTimer::UPLOAD, t);  // Keep the stage rows aligned
+      BAIL_IF_ERR(vfxErr = processRegions(srcVFX, *regions, stream));
+      t = _timer.mark(StageTimer::RUN, t);
+      _trace.stamp(&stamps, LatencyTrace::POST_RUN);
+      if (rawOut)
+        BAIL_IF_ERR(vfxErr = TransferImage(&_dstVFX, &outVFX, 1.f, stream,
+                                           &_tmpVFX));
+    } else if (_enableEffect) {
+      BAIL_IF_ERR(vfxErr = TransferImage(srcVFX, &_srcGpuBuf, 1.f / 255.f,
+                                         stream, &_tmpVFX));
+      t = _timer.mark(StageTimer::UPLOAD, t);
+      if (qi)  // A lower level of --deadline, on its own instance
+        BAIL_IF_ERR(vfxErr = NvVFX_Run(qi->eff, 0));
+      else
+        BAIL_IF_ERR(vfxErr = runEffects(stream));
+      t = _timer.mark(StageTimer::RUN, t);
+      _trace.stamp(&stamps, LatencyTrace::POST_RUN);
+      if (rawOut)  // Only ever at the resolution it was opened at
+        BAIL_IF_ERR(vfxErr = TransferImage(qi ? &qi->dst : &_dstGpuBuf,
+                                           &outVFX, 255.f, stream, &_tmpVFX));
+      if (!rawOut || _show || skipping ||
+          controlling)  // BGR is needed by the writer, display and repeats
+        BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(qi ? &qi->dst : &_dstGpuBuf,
+                                                qi ? &qi->out : &_dstVFX, 255.f,
+                                                stream, &_tmpVFX));
+    } else {
+      _dirty.valid = false;  // _dstVFX no longer holds the effect output
+      BAIL_IF_ERR(vfxErr = TransferImage(srcVFX, &_dstVFX,
+                                         TransferScale(srcVFX, &_dstVFX),
+                                         stream, &_tmpVFX));
+      if (rawOut)
+        BAIL_IF_ERR(vfxErr = TransferImage(&_dstVFX, &outVFX, 1.f, stream,
+                                           &_tmpVFX));
+    }
+
+    // The host buffers are pinned, so the transfers to them are asynchronous,
+    // and complete only once the stream has been synchronized.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    t = _timer.mark(StageTimer::DOWNLOAD, t);
+    _trace.stamp(&stamps, LatencyTrace::POST_DOWNLOAD);
+    double effectMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - effectStart)
+                          .count();
+
+    // The output of an instance is brought to the size of _dstImg, so that it
+    // can stand in for any frame that follows.
+    if (qi && !repeat && !bypass && _enableEffect)
+      cv::resize(qi->outImg, _dstImg, _dstImg.size(), 0, 0, cv::INTER_LINEAR);
+
+    if (skipping && !repeat && !bypass) {
+      std::swap(sig, lastSig);
+      lastRegions = regions;
+      lastEnabled = _enableEffect;
+    }
+
+    const cv::Mat *out = &_dstImg;
+    if (finfo.latencyOverlay) {  // On a copy, since _dstImg may be reused
+      out->copyTo(overlaid);
+      DrawLatency(overlaid, _trace.sinceCapture(stamps));
+      out = &overlaid;
+    }
+
+    if (rawOut) {
+      rawWriter.commit();
+    } else if (outFile) {
+      writer.write(*out);
+      t = _timer.mark(StageTimer::ENCODE, t);
+    }
+
+    if (_show) {
+      cv::Mat shown =
+          (skipping || finfo.dirtyTile > 0 || controlling)  // _dstImg is reused
+              ? out->clone()
+              : *out;
+      drawFrameRate(shown);
+      cv::imshow("Output", shown);
+      int key = cv::waitKey(1);
+      t = _timer.mark(StageTimer::DISPLAY, t);
+      if (key > 0) {
+        appErr = processKey(key, finfo);
+        if (errQuit == appErr) break;
+      }
+    }
+    _trace.stamp(&stamps, LatencyTrace::OUTPUT);
+    _trace.record(stamps);
+
+    // Only the effect is timed, from upload to download, and not the writer
+    // or display, which no level of the ladder makes any cheaper.
+    if (controlling) {
+      unsigned next = quality.update(effectMs);
+      ++_quality[level].frames;
+      if (next != level) {
+        printf("Frame %u: the effect took %.1f ms per frame, against %.1f; "
+               "switching from %s to %s\n",
+               frameNum, quality.average(), quality.deadline(),
+               describeQualityLevel(level).c_str(),
+               describeQualityLevel(next).c_str());
+        level = next;
+        lastRegions = nullptr;  // Outputs from another level are not reused
+      }
+    }
+
+    if (cb != nullptr && vinfo.frameCount > 0) {  // Unknown for a pipe
+      cb(100.f * (capturing ? capturedNum[slot] : frameNum) / vinfo.frameCount);
+    }
+  }
+
+  stopCapture();
+  reader.release();
+  rawReader.close();
+  if (!rawWriter.close() && !writeFailed) {
+    printf("Error writing: \"%s\"\n", outFile);
+    writeFailed = true;
+  }
+  if (outFile && !rawOut) writer.release();
+  if (finfo.verbose) printPoolStats();
+  if (finfo.verbose) printRoiStats();
+  if (finfo.verbose) printDirtyTileStats();
+  if (finfo.verbose && controlling) printQualityStats(quality);
+  if (capturing)
+    printf("%llu of %llu frames captured (%.1f%%) were dropped, since a newer "
+           "one had arrived before the effect was ready\n",
+           mailbox.dropped(), mailbox.published(),
+           mailbox.published() ? 100. * mailbox.dropped() / mailbox.published()
+                               : 0.);
+  if (skipping)
+    printf("%llu of %u frames (%.1f%%) repeated the last one processed, and "
+           "reused its output\n",
+           repeated, frameNum, frameNum ? 100. * repeated / frameNum : 0.);
+  appErr = endStats(finfo, frameNum, repeated);
+  return writeFailed ? errWrite : appErr;
+bail:
+  if (finfo.async && stream) NvVFX_CudaStreamDestroy(stream);
+  stopCapture();
+  rawWriter.close();
+  endStats(finfo, frameNum, repeated);
+  return appErrFromVfxStatus(vfxErr);
+}
+
+// Copy the output made before from the same input with the same settings out
+// of the cache, or make it and cache it. Movies are cached as whole files.
+FXApp::Err FXApp::processMovieCached(const char *inFile, const char *outFile,
+                                     const FlagInfo &finfo,
+                                     progressCallback cb) {
+  FlagInfo uncached = finfo;
+  ResultCache::Entry entry;
+  ContentHash content;
+  std::string key;
+  FILE *fp;
+  FXApp::Err appErr;
+
+  uncached.cacheDir.clear();
+  if (!openCache(finfo)) return processMovie(inFile, outFile, uncached, cb);
+  {
+    MappedFile in, roi;
+    if (!in.open(inFile)) return errRead;
+    content.update(in.data(), in.size());
+    if (!finfo.roiFile.empty()) {
+      if (!roi.open(finfo.roiFile.c_str())) return errRead;
+      content.update(roi.data(), roi.size());
+    }
+  }
+  content.update(finfo.codec)
+      .update(finfo.yuv)
+      .update(finfo.yuvColorspace)
+      .update(finfo.rawFormat)
+      .value(finfo.skipDuplicates)
+      .value(finfo.dirtyTile)
+      .value(finfo.dirtyRefresh)
+      .value(finfo.segments)
+      .value(finfo.overlap)
+      .value(finfo.batchSize)
+      .update(std::filesystem::path(outFile).extension().string());
+  key = cacheKey(content.hex(), 1 + _chain.size(), finfo);
+
+  if (_cache.lookup(key, &entry)) {
+    if (finfo.verbose) printf("%s is cached\n", inFile);
+    if (!(fp = fopen(outFile, "wb"))) return errWrite;
+    bool ok = entry.header().bytes == fwrite(entry.payload(), 1,
+                                             entry.header().bytes, fp);
+    if (0 != fclose(fp) || !ok) return errWrite;
+    if (cb) cb(100.f);
+  } else {
+    if (errNone != (appErr = processMovie(inFile, outFile, uncached, cb)))
+      return appErr;
+    if (!_cache.storeFile(key, outFile))
+      printf("Cannot cache \"%s\" in \"%s\"\n", outFile,
+             finfo.cacheDir.c_str());
+  }
+  if (finfo.verbose) _cache.print();
+  return errNone;
+}
+
+// Decode, effect and encode run concurrently on their own threads, connected
+// by bounded queues of slot indices. The effect stage runs on the calling
+// thread, since that is where the effect was loaded and where the display
+// window lives. Slots circulate free --> decoded --> processed --> free, so at
+// most pipelineDepth frames are in flight, and a slow stage stalls the others
+// rather than growing memory. Each queue is FIFO with one producer and one
+// consumer, so frames are encoded in the order in which they were decoded.
+FXApp::Err FXApp::processMoviePipelined(cv::VideoCapture &reader,
+                                        cv::VideoWriter &writer, bool write,
+                                        const VideoInfo &vinfo,
+                                        const FlagInfo &finfo,
+                                        progressCallback cb) {
+  const unsigned depth = (unsigned)finfo.pipelineDepth;
+  CUstream stream = 0;
+  FXApp::Err appErr = errNone;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  std::vector<PipelineSlot> slots(depth);
+  FrameQueue<unsigned> freeQueue(depth), decodedQueue(depth),
+      processedQueue(depth);
+  unsigned slotIndex;
+  unsigned long long framesDone = 0;  // Written by the encoder
+  Err statsErr;
+
+  for (slotIndex = 0; slotIndex < depth; ++slotIndex) {
+    slots[slotIndex].srcImg.allocator = &_hostAllocator;
+    slots[slotIndex].dstImg.allocator = &_hostAllocator;
+    slots[slotIndex].srcImg.create(_srcImg.rows, _srcImg.cols, _srcImg.type());
+    slots[slotIndex].dstImg.create(_dstImg.rows, _dstImg.cols, _dstImg.type());
+    if (!slots[slotIndex].srcImg.data || !slots[slotIndex].dstImg.data)
+      return errMemory;
+    NVWrapperForPinnedCVMat(&slots[slotIndex].dstImg, &slots[slotIndex].dstVFX);
+    freeQueue.push(slotIndex);
+  }
+
+  beginStats(finfo, vinfo.frameCount);
+  std::thread decoder([&]() {
+    unsigned index, frameNum = 0;
+    while (freeQueue.pop(&index)) {
+      PipelineSlot &slot = slots[index];
+      StageTimer::Clock::time_point t = _timer.now();
+      if (!reader.read(slot.srcImg)) break;
+      _timer.mark(StageTimer::DECODE, t);
+      slot.stamps = LatencyTrace::Stamps();
+      _trace.stamp(&slot.stamps, LatencyTrace::CAPTURE);
+      slot.stamps.frame = frameNum;
+      if (slot.srcImg.empty()) printf("Frame %u is empty\n", frameNum);
+      NVWrapperForPinnedCVMat(&slot.srcImg,
+                              &slot.srcVFX);  // read() may reallocate
+      slot.frameNum = frameNum++;
+      if (!decodedQueue.push(index)) break;
+    }
+    decodedQueue.close();
+  });
+
+  std::thread encoder([&]() {
+    unsigned index;
+    while (processedQueue.pop(&index)) {
+      if (write) {
+        StageTimer::Clock::time_point t = _timer.now();
+        writer.write(slots[index].dstImg);
+        _timer.mark(StageTimer::ENCODE, t);
+      }
+      _trace.stamp(&slots[index].stamps, LatencyTrace::OUTPUT);
+      _trace.record(slots[index].stamps);
+      ++framesDone;
+      freeQueue.push(index);
+    }
+  });
+
+  while (decodedQueue.pop(&slotIndex)) {
+    PipelineSlot &slot = slots[slotIndex];
+    StageTimer::Clock::time_point t = _timer.now();
+    _trace.stamp(&slot.stamps, LatencyTrace::PRE_UPLOAD);
+
+    if (_enableEffect) {
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&slot.srcVFX, &_srcGpuBuf,
+                                              1.f / 255.f, stream, &_tmpVFX));
+      t = _timer.mark(StageTimer::UPLOAD, t);
+      BAIL_IF_ERR(vfxErr = runEffects(stream));
+      t = _timer.mark(StageTimer::RUN, t);
+      _trace.stamp(&slot.stamps, LatencyTrace::POST_RUN);
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &slot.dstVFX, 255.f,
+                                              stream, &_tmpVFX));
+    } else {
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&slot.srcVFX, &slot.dstVFX,
+                                              1.f / 255.f, stream, &_tmpVFX));
+    }
+    // The slot's images are pinned, so the transfers are asynchronous; neither
+    // the result may be encoded nor the source refilled until they complete.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    t = _timer.mark(StageTimer::DOWNLOAD, t);
+    _trace.stamp(&slot.stamps, LatencyTrace::POST_DOWNLOAD);
+    if (finfo.latencyOverlay)  // The slot is not reused until it is written
+      DrawLatency(slot.dstImg, _trace.sinceCapture(slot.stamps));
+
+    if (_show) {  // Draw on a copy, so that the frame rate is not encoded
+      slot.dstImg.copyTo(_dstImg);
+      drawFrameRate(_dstImg);
+      cv::imshow("Output", _dstImg);
+      int key = cv::waitKey(1);
+      _timer.mark(StageTimer::DISPLAY, t);
+      if (key > 0) {
+        appErr = processKey(key, finfo);
+        if (errQuit == appErr) break;
+      }
+    }
+
+    processedQueue.push(slotIndex);
+
+    if (cb != nullptr) {
+      cb(100.f * slot.frameNum / vinfo.frameCount);
+    }
+  }
+
+bail:
+  decodedQueue.close();  // Stops the decoder early if we bailed
+  freeQueue.close();
+  processedQueue.close();  // The encoder drains what has already been queued
+  decoder.join();
+  encoder.join();
+  statsErr = endStats(finfo, framesDone);
+  if (NVCV_SUCCESS != vfxErr) return appErrFromVfxStatus(vfxErr);
+  return statsErr;
+}
+
+// Wait for the download of the frame held in this set, then write and show it.
+FXApp::Err FXApp::retireAsyncFrameSet(AsyncPingPong &pingPong,
+                                      AsyncFrameSet *set, cv::Mat &dstImg,
+                                      cv::VideoWriter &writer, bool write,
+                                      const VideoInfo &vinfo,
+                                      const FlagInfo &finfo,
+                                      progressCallback cb) {
+  FXApp::Err appErr = errNone;
+  bool held;
+  if (NVCV_SUCCESS != pingPong.retire(set, &held)) return errCuda;
+  if (!held) return errNone;
+  if (write) writer.write(dstImg);
+  if (_show) {  // Draw on a copy, since the pinned buffer is reused
+    dstImg.copyTo(_dstImg);
+    drawFrameRate(_dstImg);
+    cv::imshow("Output", _dstImg);
+    int key = cv::waitKey(1);
+    if (key > 0) appErr = processKey(key, finfo);
+  }
+  if (cb != nullptr) {
+    cb(100.f * set->frameNum / vinfo.frameCount);
+  }
+  return appErr;
+}
+
+// Frames alternate between the two buffer sets of an AsyncPingPong, which
+// overlaps the upload, run and download of consecutive frames with each other
+// and with decoding and encoding on the CPU. The cv::Mats alias the pinned
+// host buffers of each set.
+FXApp::Err FXApp::processMovieAsync(cv::VideoCapture &reader,
+                                    cv::VideoWriter &writer, bool write,
+                                    CUstream runStream, const VideoInfo &vinfo,
+                                    const FlagInfo &finfo,
+                                    progressCallback cb) {
+  FXApp::Err appErr = errNone;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  AsyncPingPong pingPong;
+  cv::Mat srcImg[2], dstImg[2];
+  unsigned frameNum;
+
+  BAIL_IF_ERR(vfxErr = pingPong.alloc(_srcVFX, _dstVFX, _srcGpuBuf,
+                                      AlignmentFor(&_srcGpuBuf), _dstGpuBuf,
+                                      AlignmentFor(&_dstGpuBuf), runStream));
+  for (unsigned i = 0; i < 2; ++i) {
+    CVWrapperForNvCVImage(&pingPong.set(i).srcPinned, &srcImg[i]);
+    CVWrapperForNvCVImage(&pingPong.set(i).dstPinned, &dstImg[i]);
+  }
+  BAIL_IF_ERR(vfxErr = NvCVImage_Alloc(
+                  &_tmpDstVFX, _dstVFX.width, _dstVFX.height,
+                  _dstVFX.pixelFormat, _dstVFX.componentType, _dstVFX.planar,
+                  NVCV_GPU, 0));
+
+  for (frameNum = 0;; ++frameNum) {
+    AsyncFrameSet &set = pingPong.set(frameNum);
+    cv::Mat &src = srcImg[frameNum & 1];
+
+    appErr = retireAsyncFrameSet(pingPong, &set, dstImg[frameNum & 1], writer,
+                                 write, vinfo, finfo, cb);
+    if (errNone != appErr) break;
+
+    if (!reader.read(src)) break;
+    if (src.empty()) {
+      printf("Frame %u is empty\n", frameNum);
+    }
+    if (src.data != set.srcPinned.pixels) {  // The decoder reallocated
+      cv::Mat pinned;
+      CVWrapperForNvCVImage(&set.srcPinned, &pinned);
+      src.copyTo(pinned);
+      src = pinned;
+    }
+
+    BAIL_IF_ERR(vfxErr = pingPong.enqueue(&set, frameNum,
+                                          _enableEffect ? _eff : nullptr,
+                                          &_tmpVFX, &_tmpDstVFX));
+  }
+
+  // Flush the frame still in flight in the other set.
+  if (errNone == appErr)
+    appErr = retireAsyncFrameSet(pingPong, &pingPong.set(frameNum + 1),
+                                 dstImg[(frameNum + 1) & 1], writer, write,
+                                 vinfo, finfo, cb);
+
+bail:
+  pingPong.free();
+  NvCVImage_Dealloc(&_tmpDstVFX);
+  bindEffectImages();  // Restore the default bindings
+  if (NVCV_SUCCESS != vfxErr) return appErrFromVfxStatus(vfxErr);
+  return (errQuit == appErr) ? errNone : appErr;
+}
+
+NvCV_Status FXApp::allocBatchBuffers(unsigned batchSize) {
+  NvCV_Status vfxErr;
+  BAIL_IF_ERR(vfxErr = AllocateBatchBuffer(
+                  &_srcBatchBuf, batchSize, _srcGpuBuf.width,
+                  _srcGpuBuf.height, _srcGpuBuf.pixelFormat,
+                  _srcGpuBuf.componentType, _srcGpuBuf.planar, NVCV_GPU,
+                  AlignmentFor(&_srcGpuBuf)));
+  BAIL_IF_ERR(vfxErr = AllocateBatchBuffer(
+                  &_dstBatchBuf, batchSize, _dstGpuBuf.width,
+                  _dstGpuBuf.height, _dstGpuBuf.pixelFormat,
+                  _dstGpuBuf.componentType, _dstGpuBuf.planar, NVCV_GPU,
+                  AlignmentFor(&_dstGpuBuf)));
+bail:
+  return vfxErr;
+}
+
+// Decode batchSize frames, upload each one into its place in the source batch
+// buffer, run the effect once for the whole batch, then download and encode
+// the results in order. A partial final batch is padded by replicating its
+// last frame, so that the model always sees valid input; the padding results
+// are discarded.
+FXApp::Err FXApp::processMovieBatched(cv::VideoCapture &reader,
+                                      cv::VideoWriter &writer, bool write,
+                                      const VideoInfo &vinfo,
+                                      const FlagInfo &finfo,
+                                      progressCallback cb) {
+  const unsigned batchSize = (unsigned)finfo.batchSize;
+  CUstream stream = 0;
+  FXApp::Err appErr = errNone;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  std::vector<cv::Mat> frames(batchSize);
+  NvCVImage frameVFX, srcView, dstView, padView;
+  unsigned frameNum = 0, numRuns = 0, n, count;
+  std::chrono::high_resolution_clock::time_point start =
+      std::chrono::high_resolution_clock::now();
+  float seconds;
+
+  for (n = 0; n < batchSize; ++n) {
+    frames[n].allocator = &_hostAllocator;
+    frames[n].create(_srcImg.rows, _srcImg.cols, _srcImg.type());
+    if (!frames[n].data) return errMemory;
+  }
+
+  for (count = batchSize; count == batchSize && errQuit != appErr;) {
+    for (count = 0; count < batchSize && reader.read(frames[count]); ++count) {
+      if (frames[count].empty()) {
+        printf("Frame %u is empty\n", frameNum + count);
+      }
+    }
+    if (!count) break;
+
+    for (n = 0; n < count; ++n) {
+      NVWrapperForPinnedCVMat(&frames[n], &frameVFX);
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &frameVFX,
+                      NthImage(n, _srcGpuBuf.height, &_srcBatchBuf, &srcView),
+                      1.f / 255.f, stream, &_tmpVFX));
+    }
+    NthImage(count - 1, _srcGpuBuf.height, &_srcBatchBuf, &padView);
+    for (; n < batchSize; ++n) {
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &padView,
+                      NthImage(n, _srcGpuBuf.height, &_srcBatchBuf, &srcView),
+                      1.f, stream, nullptr));
+    }
+    BAIL_IF_ERR(vfxErr = NvVFX_Run(_eff, 0));
+    ++numRuns;
+
+    for (n = 0; n < count; ++n, ++frameNum) {
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      NthImage(n, _dstGpuBuf.height, &_dstBatchBuf, &dstView),
+                      &_dstVFX, 255.f, stream, &_tmpVFX));
+      // _dstVFX is pinned, so the download is asynchronous.
+      BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+      if (write) writer.write(_dstImg);
+
+      if (_show) {
+        drawFrameRate(_dstImg);
+        cv::imshow("Output", _dstImg);
+        int key = cv::waitKey(1);
+        if (key > 0) {
+          appErr = processKey(key, finfo);
+          if (errQuit == appErr) break;
+        }
+      }
+
+      if (cb != nullptr) {
+        cb(100.f * frameNum / vinfo.frameCount);
+      }
+    }
+  }
+
+  seconds = std::chrono::duration_cast<std::chrono::duration<float>>(
+                std::chrono::high_resolution_clock::now() - start)
+                .count();
+  printf("\nBatch size %u: %u frames in %u runs, %.3f seconds, %.2f frames/sec\n",
+         batchSize, frameNum, numRuns, seconds,
+         (seconds > 0.f) ? frameNum / seconds : 0.f);
+
+bail:
+  return appErrFromVfxStatus(vfxErr);
+}
+
+// Multiplex several videos of the same size through one effect instance.
+// Each batch holds at most one frame from each stream, so a stateful effect
+// always advances a stream's state one frame at a time and in order. When
+// there are more streams than batch slots, streams take turns. Each stream has
+// its own state object, which is bound to its batch slot by
+// NvVFX_SetStateObjectHandleArray(), and each padding slot of a partial batch
+// has a scratch state of its own, so that no real stream's state is advanced
+// by the padding, and no state is advanced twice by one run.
+FXApp::Err FXApp::processMovies(const std::vector<std::string> &inFiles,
+                                const std::vector<std::string> &outFiles,
+                                const FlagInfo &finfo, progressCallback cb) {
+  const unsigned numStreams = (unsigned)inFiles.size();
+  const unsigned batchSize =
+      (finfo.batchSize > 0) ? (unsigned)finfo.batchSize : numStreams;
+  CUstream stream = 0;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  std::vector<MuxStream> streams(numStreams);
+  std::vector<unsigned> active, members(batchSize);
+  std::vector<NvVFX_StateObjectHandle> batchStates(batchSize, nullptr);
+  std::vector<cv::Mat> frames(batchSize);
+  std::vector<NvVFX_StateObjectHandle> scratchStates(batchSize - 1, nullptr);
+  NvCVImage frameVFX, srcView, dstView, padView;
+  bool stateful = IsStatefulEffect(_effectName);
+  unsigned i, n, count, cursor = 0, totalFrames = 0;
+  long long expectedFrames = 0;
+  std::chrono::high_resolution_clock::time_point start;
+  float seconds;
+
+  if (!_chain.empty()) {
+    printf("Error: a chain of effects cannot be applied to multiple inputs\n");
+    return errFlag;
+  }
+  if (finfo.async || finfo.pipelineDepth > 1 || finfo.segments > 1 ||
+      !finfo.yuv.empty() || finfo.skipDuplicates >= 0.f ||
+      !finfo.roiFile.empty() || finfo.dirtyTile > 0 || finfo.deadline >= 0.f ||
+      !finfo.statsFile.empty() || !finfo.statsCsv.empty() ||
+      !finfo.cacheDir.empty() || finfo.realtime || finfo.latency ||
+      finfo.latencyOverlay || !finfo.traceFile.empty()) {
+    printf("Error: --async, --pipeline_depth, --segments, --yuv, "
+           "--skip_duplicates, --roi_file, --dirty_tiles, --deadline, "
+           "--stats, --stats_csv, --cache_dir, --realtime, --latency, "
+           "--latency_overlay and --trace_file cannot be used with multiple "
+           "inputs\n");
+    return errFlag;
+  }
+  for (i = 0; i < numStreams; ++i) {
+    if (!finfo.rawFormat.empty() || IsRawVideoFile(inFiles[i].c_str()) ||
+        (i < outFiles.size() && IsRawVideoFile(outFiles[i].c_str()))) {
+      printf("Error: Y4M and raw video cannot be used with multiple inputs\n");
+      return errFlag;
+    }
+  }
+  for (i = 0; i < numStreams; ++i) {
+    MuxStream &ms = streams[i];
+    if (!ms.reader.open(inFiles[i])) {
+      printf("Error: Could not open video: \"%s\"\n", inFiles[i].c_str());
+      return errRead;
+    }
+    GetVideoInfo(ms.reader, inFiles[i].c_str(), &ms.vinfo, finfo);
+    if (ms.vinfo.width != streams[0].vinfo.width ||
+        ms.vinfo.height != streams[0].vinfo.height) {
+      printf("Error: \"%s\" is %dx%d, but all inputs must be %dx%d\n",
+             inFiles[i].c_str(), ms.vinfo.width, ms.vinfo.height,
+             streams[0].vinfo.width, streams[0].vinfo.height);
+      return errResolution;
+    }
+    expectedFrames += ms.vinfo.frameCount;
+  }
+
+  BAIL_IF_ERR(vfxErr = allocBuffers(streams[0].vinfo.width,
+                                    streams[0].vinfo.height, finfo));
+  BAIL_IF_ERR(vfxErr = allocBatchBuffers(batchSize));
+  for (n = 0; n < batchSize; ++n) {
+    frames[n].allocator = &_hostAllocator;
+    frames[n].create(_srcImg.rows, _srcImg.cols, _srcImg.type());
+    BAIL_IF_NULL(frames[n].data, vfxErr, NVCV_ERR_MEMORY);
+  }
+
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(
+                  _eff, NVVFX_INPUT_IMAGE,
+                  NthImage(0, _srcGpuBuf.height, &_srcBatchBuf, &srcView)));
+  BAIL_IF_ERR(vfxErr = NvVFX_SetImage(
+                  _eff, NVVFX_OUTPUT_IMAGE,
+                  NthImage(0, _dstGpuBuf.height, &_dstBatchBuf, &dstView)));
+  BAIL_IF_ERR(vfxErr = NvVFX_SetU32(_eff, NVVFX_BATCH_SIZE, batchSize));
+  BAIL_IF_ERR(vfxErr = NvVFX_SetU32(
+                  _eff, NVVFX_MODEL_BATCH,
+                  (unsigned)(finfo.modelBatch ? finfo.modelBatch : batchSize)));
+  if (stateful)  // One state per stream, plus one per padding slot
+    BAIL_IF_ERR(vfxErr = NvVFX_SetU32(_eff, NVVFX_MAX_NUMBER_STREAMS,
+                                      numStreams + batchSize - 1));
+  BAIL_IF_ERR(vfxErr = setEffectParams(finfo, stream));
+  BAIL_IF_ERR(vfxErr = loadEffects());
+
+  if (stateful) {
+    for (NvVFX_StateObjectHandle &scratch : scratchStates)
+      BAIL_IF_ERR(vfxErr = NvVFX_AllocateState(_eff, &scratch));
+    for (i = 0; i < numStreams; ++i)
+      BAIL_IF_ERR(vfxErr = NvVFX_AllocateState(_eff, &streams[i].state));
+  }
+
+  for (i = 0; i < numStreams; ++i) {
+    MuxStream &ms = streams[i];
+    if (i < outFiles.size() && !outFiles[i].empty()) {
+      ms.write = ms.writer.open(outFiles[i], StringToFourcc(finfo.codec),
+                                ms.vinfo.frameRate,
+                                cv::Size(_dstVFX.width, _dstVFX.height));
+      if (!ms.write) {
+        printf("Cannot open \"%s\" for video writing\n", outFiles[i].c_str());
+        vfxErr = NVCV_ERR_WRITE;
+        goto bail;
+      }
+    }
+    active.push_back(i);
+  }
+
+  start = std::chrono::high_resolution_clock::now();
+  while (!active.empty()) {
+    // Gather one frame from each of the next batchSize active streams.
+    unsigned take = std::min(batchSize, (unsigned)active.size());
+    for (count = 0, n = 0; n < take; ++n) {
+      unsigned s = active[(cursor + n) % active.size()];
+      if (!streams[s].reader.read(frames[count])) {
+        streams[s].reader.release();  // This stream is finished
+        if (streams[s].write) streams[s].writer.release();
+        continue;
+      }
+      members[count] = s;
+      batchStates[count] = streams[s].state;
+      ++count;
+    }
+    cursor += take;
+    std::erase_if(active, [&](unsigned s) { return !streams[s].reader.isOpened(); });
+    cursor = active.empty() ? 0 : cursor % (unsigned)active.size();
+    if (!count) continue;
+
+    for (n = 0; n < count; ++n) {
+      NVWrapperForPinnedCVMat(&frames[n], &frameVFX);
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &frameVFX,
+                      NthImage(n, _srcGpuBuf.height, &_srcBatchBuf, &srcView),
+                      1.f / 255.f, stream, &_tmpVFX));
+    }
+    NthImage(count - 1, _srcGpuBuf.height, &_srcBatchBuf, &padView);
+    for (; n < batchSize; ++n) {
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      &padView,
+                      NthImage(n, _srcGpuBuf.height, &_srcBatchBuf, &srcView),
+                      1.f, stream, nullptr));
+      batchStates[n] = scratchStates[n - count];
+    }
+    if (stateful)
+      BAIL_IF_ERR(vfxErr = NvVFX_SetStateObjectHandleArray(
+                      _eff, NVVFX_STATE, batchStates.data()));
+    BAIL_IF_ERR(vfxErr = NvVFX_Run(_eff, 0));
+
+    for (n = 0; n < count; ++n) {
+      MuxStream &ms = streams[members[n]];
+      BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(
+                      NthImage(n, _dstGpuBuf.height, &_dstBatchBuf, &dstView),
+                      &_dstVFX, 255.f, stream, &_tmpVFX));
+      // _dstVFX is pinned, so the download is asynchronous.
+      BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+      if (ms.write) ms.writer.write(_dstImg);
+    }
+    totalFrames += count;
+
+    if (cb != nullptr && expectedFrames > 0) {
+      cb(100.f * totalFrames / expectedFrames);
+    }
+  }
+
+  seconds = std::chrono::duration_cast<std::chrono::duration<float>>(
+                std::chrono::high_resolution_clock::now() - start)
+                .count();
+  printf("\n%u streams, batch size %u: %u frames in %.3f seconds, %.2f frames/sec\n",
+         numStreams, batchSize, totalFrames, seconds,
+         (seconds > 0.f) ? totalFrames / seconds : 0.f);
+
+bail:
+  for (i = 0; i < numStreams; ++i) {
+    if (streams[i].state) NvVFX_DeallocateState(_eff, streams[i].state);
+    streams[i].reader.release();
+    if (streams[i].write) streams[i].writer.release();
+  }
+  for (NvVFX_StateObjectHandle scratch : scratchStates)
+    if (scratch) NvVFX_DeallocateState(_eff, scratch);
+  return appErrFromVfxStatus(vfxErr);
+}
+
+// Process the frames of one segment of a movie, decoding its pre-roll frames
+// through the effects but writing only the frames from begin on. Each segment
+// runs on a CUDA stream of its own, so that concurrent segments overlap.
+FXApp::Err FXApp::processMovieSegment(const char *inFile,
+                                      const VideoSegment &segment,
+                                      const FlagInfo &finfo,
+                                      cv::VideoWriter &writer,
+                                      std::atomic<long long> *framesDone,
+                                      long long totalFrames,
+                                      progressCallback cb) {
+  CUstream stream = nullptr;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  FXApp::Err appErr = errNone;
+  cv::VideoCapture reader;
+  VideoInfo vinfo;
+  FlagInfo quiet = finfo;
+  long long frameNum;
+
+  // Adapts the reader to SeekToFrame().
+  struct CaptureSeeker {
+    cv::VideoCapture &reader;
+    const char *file;
+    bool seek(long long frame) {
+      return reader.set(cv::CAP_PROP_POS_FRAMES, (double)frame);
+    }
+    long long position() {
+      return (long long)reader.get(cv::CAP_PROP_POS_FRAMES);
+    }
+    bool restart() { return reader.open(file); }
+    bool skip() { return reader.grab(); }
+  } seeker{reader, inFile};
+
+  quiet.verbose = false;
+  if (!reader.open(inFile)) return errRead;
+  GetVideoInfo(reader, inFile, &vinfo, quiet);
+  BAIL_IF_ERR(vfxErr = NvVFX_CudaStreamCreate(&stream));
+  BAIL_IF_ERR(vfxErr = allocBuffers(vinfo.width, vinfo.height, finfo));
+  BAIL_IF_ERR(vfxErr = bindEffectImages());
+  BAIL_IF_ERR(vfxErr = setEffectParams(finfo, stream));
+  BAIL_IF_ERR(vfxErr = loadEffects());
+  BAIL_IF_ERR(vfxErr = bindSingleStreamState());
+
+  if (!SeekToFrame(seeker, segment.first)) {
+    printf("Error: cannot seek to frame %lld of \"%s\"\n", segment.first,
+           inFile);
+    appErr = errRead;
+    goto bail;
+  }
+
+  for (frameNum = segment.first;
+       (segment.end < 0 || frameNum < segment.end) && reader.read(_srcImg);
+       ++frameNum) {
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_srcGpuBuf,
+                                            1.f / 255.f, stream, &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = runEffects(stream));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
+                                            stream, &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    if (frameNum < segment.begin) continue;  // Pre-roll
+
+    writer.write(_dstImg);
+    long long done = ++*framesDone;
+    if (cb != nullptr && totalFrames > 0) {
+      cb(100.f * done / totalFrames);
+    }
+  }
+
+bail:
+  if (stream) {
+    cudaStreamSynchronize(stream);
+    setEffectParams(finfo, 0);  // Before the stream is gone
+    NvVFX_CudaStreamDestroy(stream);
+  }
+  if (NVCV_SUCCESS != vfxErr) return appErrFromVfxStatus(vfxErr);
+  return appErr;
+}
+
+// Split a movie into finfo.segments frame ranges, and process them
+// concurrently, each with its own FXApp, effect and CUDA stream. The first
+// segment is processed on this thread, by this FXApp, straight into the output
+// file. The others are encoded losslessly, with FFV1, into temporary files next
+// to the output file, which are decoded and appended in order as their
+// segments complete, so the result is a single file in frame order, encoded
+// once with the requested codec.
+FXApp::Err FXApp::processMovieSegments(const char *inFile, const char *outFile,
+                                       const FlagInfo &finfo,
+                                       progressCallback cb) {
+  const unsigned numSegments = (unsigned)finfo.segments;
+  FXApp::Err appErr = errNone;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  cv::VideoCapture reader;
+  cv::VideoWriter writer;
+  VideoInfo vinfo;
+  std::vector<VideoSegment> segments;
+  std::vector<cv::VideoWriter> segmentWriters(numSegments);
+  std::vector<std::string> segmentFiles(numSegments);
+  std::vector<FXApp::Err> errs(numSegments, errNone);
+  std::atomic<long long> framesDone{0};
+  unsigned k;
+
+  if (!inFile || !inFile[0] || !outFile || !outFile[0]) {
+    printf("Error: --segments requires --in_file and --out_file\n");
+    return errFlag;
+  }
+  if (!reader.open(inFile)) {
+    printf("Error: Could not open video: \"%s\"\n", inFile);
+    return errRead;
+  }
+  GetVideoInfo(reader, inFile, &vinfo, finfo);
+  reader.release();
+  if (vinfo.frameCount < numSegments) {
+    printf("Error: cannot split %lld frames into %u segments\n",
+           vinfo.frameCount, numSegments);
+    return errRead;
+  }
+  segments = SplitVideo(vinfo.frameCount, numSegments, finfo.overlap);
+
+  BAIL_IF_ERR(vfxErr = allocBuffers(vinfo.width, vinfo.height, finfo));
+  if (!writer.open(outFile, StringToFourcc(finfo.codec), vinfo.frameRate,
+                   cv::Size(_dstVFX.width, _dstVFX.height))) {
+    printf("Cannot open \"%s\" for video writing\n", outFile);
+    return errWrite;
+  }
+  for (k = 1; k < numSegments; ++k) {
+    segmentFiles[k] = std::string(outFile) + ".seg" + std::to_string(k) + ".mkv";
+    if (!segmentWriters[k].open(segmentFiles[k], StringToFourcc("FFV1"),
+                                vinfo.frameRate,
+                                cv::Size(_dstVFX.width, _dstVFX.height))) {
+      printf("Cannot open \"%s\" for FFV1 video writing\n",
+             segmentFiles[k].c_str());
+      appErr = errWrite;
+      goto cleanup;
+    }
+  }
+
+  RunSegments(
+      numSegments,
+      [&](unsigned k) {
+        if (!k) {
+          errs[0] = processMovieSegment(inFile, segments[0], finfo, writer,
+                                        &framesDone, vinfo.frameCount, cb);
+          return errNone == errs[0];
+        }
+        FXApp app;
+        errs[k] = app.createEffect(_effectSpec.c_str(), _modelDir.c_str());
+        if (errNone == errs[k])
+          errs[k] = app.processMovieSegment(inFile, segments[k], finfo,
+                                            segmentWriters[k], &framesDone, 0,
+                                            nullptr);
+        segmentWriters[k].release();
+        return errNone == errs[k];
+      },
+      [&](unsigned k) {  // Append the segment to the output
+        cv::VideoCapture segmentReader;
+        cv::Mat frame;
+        if (!k) return true;
+        if (!segmentReader.open(segmentFiles[k])) {
+          printf("Error: Could not open video: \"%s\"\n",
+                 segmentFiles[k].c_str());
+          errs[k] = errRead;
+          return false;
+        }
+        while (segmentReader.read(frame)) writer.write(frame);
+        return true;
+      });
+  for (k = 0; k < numSegments && errNone == appErr; ++k) appErr = errs[k];
+  if (finfo.verbose)
+    printf("\n%lld frames written from %u segments\n", framesDone.load(),
+           numSegments);
+
+cleanup:
+  writer.release();
+  for (k = 1; k < numSegments; ++k) {
+    segmentWriters[k].release();
+    if (!segmentFiles[k].empty()) remove(segmentFiles[k].c_str());
+  }
+  return appErr;
+
+bail:
+  return appErrFromVfxStatus(vfxErr);
+}
+
+// Process a list of images with one effect instance. Reading of the next
+// image and writing of the previous ones overlap the effect on the current
+// one, on their own threads. The effect is loaded for the first image, and
+// again only when the image size changes. Unreadable and unwritable images are
+// reported and skipped, rather than abandoning the batch.
+FXApp::Err FXApp::processImages(const std::vector<std::string> &inFiles,
+                                const std::vector<std::string> &outFiles,
+                                const FlagInfo &finfo, progressCallback cb) {
+  typedef std::chrono::high_resolution_clock Clock;
+  const unsigned numSlots = 3;  // One being worked on, one queued, one spare
+  CUstream stream = 0;
+  NvCV_Status vfxErr = NVCV_SUCCESS;
+  ImageSlot srcSlots[numSlots], dstSlots[numSlots];
+  FrameQueue<unsigned> srcFree(numSlots), loaded(numSlots), dstFree(numSlots),
+      done(numSlots);
+  std::atomic<unsigned> numReadErrs{0}, numWriteErrs{0};
+  double readSecs = 0, effectSecs = 0, writeSecs = 0, totalSecs;
+  unsigned numLoads = 0, numImages = 0, s;
+  bool write = !outFiles.empty();
+  Clock::time_point start = Clock::now();
+
+  if (!_eff) return errEffect;
+  if (write && outFiles.size() != inFiles.size()) return errFlag;
+
+  for (s = 0; s < numSlots; ++s) {
+    srcFree.push(s);
+    dstFree.push(s);
+  }
+
+  // Each queue has one producer and one consumer, so a slot whose image could
+  // not be read is kept by the reader for the next image, rather than pushed
+  // back onto srcFree, which the main thread pushes to.
+  std::thread reader([&]() {
+    unsigned i;
+    bool held = false;  // i is a slot that failed to read
+    for (size_t k = 0; k < inFiles.size() && (held || srcFree.pop(&i)); ++k) {
+      Clock::time_point t0 = Clock::now();
+      srcSlots[i].img = cv::imread(inFiles[k]);
+      srcSlots[i].index = k;
+      readSecs += std::chrono::duration<double>(Clock::now() - t0).count();
+      held = !srcSlots[i].img.data;
+      if (held) {
+        printf("Error: Could not read image: \"%s\"\n", inFiles[k].c_str());
+        ++numReadErrs;
+        continue;
+      }
+      if (!loaded.push(i)) break;
+    }
+    loaded.close();
+  });
+
+  std::thread writer([&]() {
+    unsigned i;
+    while (done.pop(&i)) {
+      const std::string &outFile = outFiles[dstSlots[i].index];
+      Clock::time_point t0 = Clock::now();
+      bool ok;
+      try {
+        ok = cv::imwrite(outFile, dstSlots[i].img);
+      } catch (...) {
+        ok = false;
+      }
+      writeSecs += std::chrono::duration<double>(Clock::now() - t0).count();
+      if (!ok) {
+        printf("Error writing: \"%s\"\n", outFile.c_str());
+        ++numWriteErrs;
+      }
+      dstFree.push(i);
+    }
+  });
+
+  if (write) {
+    for (const std::string &outFile : outFiles) {
+      if (IsLossyImageFile(outFile.c_str())) {
+        fprintf(stderr,
+                "WARNING: JPEG output file format will reduce image quality\n");
+        break;
+      }
+    }
+  }
+
+  for (unsigned i, j; loaded.pop(&i);) {
+    ImageSlot &src = srcSlots[i];
+    Clock::time_point t0 = Clock::now();
+    if (!_inited || src.img.cols != _srcImg.cols ||
+        src.img.rows != _srcImg.rows) {
+      BAIL_IF_ERR(vfxErr = allocBuffers(src.img.cols, src.img.rows, finfo));
+      BAIL_IF_ERR(vfxErr = bindEffectImages());
+      BAIL_IF_ERR(vfxErr = setEffectParams(finfo, stream));
+      BAIL_IF_ERR(vfxErr = loadEffects());
+      BAIL_IF_ERR(vfxErr = bindSingleStreamState());
+      ++numLoads;
+    }
+    if (!dstFree.pop(&j)) break;
+    ImageSlot &dst = dstSlots[j];
+    dst.img.allocator = &_hostAllocator;
+    dst.img.create(_dstImg.rows, _dstImg.cols, _dstImg.type());
+    dst.index = src.index;
+    NVWrapperForPinnedCVMat(&src.img, &_srcVFX);
+    NVWrapperForPinnedCVMat(&dst.img, &_dstVFX);
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_srcVFX, &_srcGpuBuf, 1.f / 255.f,
+                                            stream, &_tmpVFX));
+    BAIL_IF_ERR(vfxErr = runEffects(stream));
+    BAIL_IF_ERR(vfxErr = NvCVImage_Transfer(&_dstGpuBuf, &_dstVFX, 255.f,
+                                            stream, &_tmpVFX));
+    // The destination is pinned, so the download is asynchronous; both slots
+    // are handed on only once it, and the upload before it, are complete.
+    BAIL_IF_ERR(vfxErr = CudaStatus(cudaStreamSynchronize(stream)));
+    effectSecs += std::chrono::duration<double>(Clock::now() - t0).count();
+    srcFree.push(i);
+    ++numImages;
+    if (write)
+      done.push(j);
+    else
+      dstFree.push(j);
+    if (cb != nullptr) {
+      cb(100.f * (src.index + 1) / inFiles.size());
+    }
+  }
+
+bail:
+  srcFree.close();  // Stops the reader early, if we bailed
+  reader.join();
+  done.close();     // The writer drains whatever is queued
+  writer.join();
+  NVWrapperForPinnedCVMat(&_srcImg, &_srcVFX);  // Restore the aliases
+  NVWrapperForPinnedCVMat(&_dstImg, &_dstVFX);
+
+  totalSecs = std::chrono::duration<double>(Clock::now() - start).count();
+  printf("\n%u images in %.3f seconds, %.2f images/sec, %u effect load%s\n",
+         numImages, totalSecs, totalSecs > 0 ? numImages / totalSecs : 0.,
+         numLoads, (numLoads == 1) ? "" : "s");
+  if (numImages)
+    printf("Per image: read %.2f ms, effect %.2f ms, write %.2f ms\n",
+           1e3 * readSecs / (numImages + numReadErrs),
+           1e3 * effectSecs / numImages, 1e3 * writeSecs / numImages);
+  if (finfo.verbose) printPoolStats();
+  if (numReadErrs || numWriteErrs)
+    printf("%u images could not be read, %u could not be written\n",
+           numReadErrs.load(), numWriteErrs.load());
+
+  if (NVCV_SUCCESS != vfxErr) return appErrFromVfxStatus(vfxErr);
+  if (numReadErrs) return errRead;
+  if (numWriteErrs) return errWrite;
+  return errNone;
 }
@@ -0,0 +1,132 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __FRAMEQUEUE_H__
+#define __FRAMEQUEUE_H__
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Spin briefly, since the other stage is usually about to deliver, then back off to avoid burning a core
+// while a slow stage (typically the effect or the encoder) catches up.
+inline void FrameWaitBackoff(unsigned spins) {
+  if (spins < 64)
+    std::this_thread::yield();
+  else
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+// Bounded, lock-free, single-producer single-consumer queue.
+// This is used to hand frame slot indices from one pipeline stage to the next. push() blocks while the queue is
+// full and pop() blocks while it is empty, which provides backpressure between stages. After close(), push()
+// fails immediately and pop() fails once the queue has been drained.
+template <typename T>
+class FrameQueue {
+ public:
+  explicit FrameQueue(unsigned capacity) {
+    unsigned size = 2;
+    while (size < capacity + 1) size <<= 1;  // one slot is kept empty to tell full from empty
+    _buf.resize(size);
+    _mask = size - 1;
+  }
+
+  bool push(const T &item) {
+    unsigned head = _head.load(std::memory_order_relaxed), next = (head + 1) & _mask;
+    for (unsigned spins = 0; next == _tail.load(std::memory_order_acquire); ++spins) {
+      if (_closed.load(std::memory_order_acquire)) return false;
+      FrameWaitBackoff(spins);
+    }
+    if (_closed.load(std::memory_order_acquire)) return false;
+    _buf[head] = item;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T *item) {
+    unsigned tail = _tail.load(std::memory_order_relaxed);
+    for (unsigned spins = 0; tail == _head.load(std::memory_order_acquire); ++spins) {
+      if (_closed.load(std::memory_order_acquire) && tail == _head.load(std::memory_order_acquire)) return false;
+      FrameWaitBackoff(spins);
+    }
+    *item = _buf[tail];
+    _tail.store((tail + 1) & _mask, std::memory_order_release);
+    return true;
+  }
+
+  void close() { _closed.store(true, std::memory_order_release); }
+
+ private:
+  std::vector<T> _buf;
+  unsigned _mask;
+  std::atomic<unsigned> _head{0};  // written by the producer
+  std::atomic<unsigned> _tail{0};  // written by the consumer
+  std::atomic<bool> _closed{false};
+};
+
+// Lock-free, single-slot mailbox through which a producer publishes the newest of a stream of frames, and a consumer
+// takes the newest one whenever it is ready for another. Frames published while the consumer is busy replace one
+// another, and are counted as dropped, so the consumer never falls behind the producer. The frames live in kSlots
+// buffers: the producer fills one, the consumer works on another, and the mailbox holds the third, so neither side
+// ever waits for the other to finish with a buffer. After close(), take() fails once the last frame has been taken.
+class FrameMailbox {
+ public:
+  static const unsigned kSlots = 3;
+
+  unsigned fillSlot() const { return _back; }  // The slot that the producer is to fill next
+
+  // Publish the slot just filled, and take back in exchange the one in the mailbox, to fill next.
+  void publish() {
+    unsigned prev = _box.exchange(_back | kFresh, std::memory_order_acq_rel);
+    if (prev & kFresh) _dropped.fetch_add(1, std::memory_order_relaxed);  // Never taken
+    _published.fetch_add(1, std::memory_order_relaxed);
+    _back = prev & ~kFresh;
+  }
+
+  // Wait for a frame newer than the last one taken, and return its slot, which is the consumer's until the next take().
+  bool take(unsigned *slot) {
+    for (unsigned spins = 0; !(_box.load(std::memory_order_acquire) & kFresh); ++spins) {
+      if (_closed.load(std::memory_order_acquire) && !(_box.load(std::memory_order_acquire) & kFresh)) return false;
+      FrameWaitBackoff(spins);
+    }
+    *slot = _front = _box.exchange(_front, std::memory_order_acq_rel) & ~kFresh;
+    return true;
+  }
+
+  void close() { _closed.store(true, std::memory_order_release); }
+  bool closed() const { return _closed.load(std::memory_order_acquire); }
+  unsigned long long published() const { return _published.load(std::memory_order_relaxed); }
+  unsigned long long dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+ private:
+  static const unsigned kFresh = 4;  // Set on the slot in the mailbox until it is taken
+
+  std::atomic<unsigned> _box{1};
+  unsigned _back = 0;   // owned by the producer
+  unsigned _front = 2;  // owned by the consumer
+  std::atomic<bool> _closed{false};
+  std::atomic<unsigned long long> _published{0}, _dropped{0};
+};
+
+#endif  // __FRAMEQUEUE_H__
@@ -0,0 +1,196 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+
+#ifndef __FRAMESIGNATURE_H__
+#define __FRAMESIGNATURE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "nvCVImage.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAMESIGNATURE_SSE2 1
+#endif  // __SSE2__
+
+// A summary of the content of a video frame, cheap enough to compute for every frame as it is decoded, by which a
+// frame that repeats an earlier one can be recognized: a 64-bit hash of every byte, for exact repeats, and optionally
+// a thumbnail of kCells x kCells cell means of the bytes of the first plane, for near repeats.
+struct FrameSignature {
+  static const unsigned kCells = 32;
+  uint64_t hash = 0;
+  std::vector<uint16_t> thumb;  // Cell means, times 16; empty if not computed
+  unsigned width = 0, height = 0;
+  int format = NVCV_FORMAT_UNKNOWN;
+
+  bool valid() const { return 0 != width; }
+  void clear() { width = 0; }
+
+  // The mean absolute difference between the thumbnails of two signatures, in 8-bit levels, or a negative number if
+  // they cannot be compared.
+  float thumbDifference(const FrameSignature &other) const {
+    if (thumb.empty() || thumb.size() != other.thumb.size()) return -1.f;
+    uint64_t sad = 0;
+    for (size_t i = 0; i < thumb.size(); ++i) sad += (unsigned)abs((int)thumb[i] - (int)other.thumb[i]);
+    return sad / (16.f * thumb.size());
+  }
+
+  // Whether this frame repeats the other: exactly if threshold is 0, otherwise to within a mean absolute difference
+  // of threshold levels between their thumbnails.
+  bool matches(const FrameSignature &other, float threshold) const {
+    if (!valid() || width != other.width || height != other.height || format != other.format) return false;
+    if (hash == other.hash) return true;
+    if (threshold <= 0.f) return false;
+    float d = thumbDifference(other);
+    return d >= 0.f && d <= threshold;
+  }
+
+  void compute(const NvCVImage *im, bool withThumb) {
+    unsigned char *y, *u, *v;
+    int yPixBytes, cPixBytes, yPitch, cPitch;
+    width = im->width;
+    height = im->height;
+    format = im->pixelFormat;
+    hash = 0x9E3779B97F4A7C15ull;
+    if (NVCV_YUV420 == im->pixelFormat || NVCV_YUV422 == im->pixelFormat || NVCV_YUV444 == im->pixelFormat) {
+      if (NVCV_SUCCESS != NvCVImage_GetYUVPointers(const_cast<NvCVImage *>(im), &y, &u, &v, &yPixBytes, &cPixBytes,
+                                                   &yPitch, &cPitch)) {
+        clear();
+        return;
+      }
+      unsigned cw = (NVCV_YUV444 == im->pixelFormat) ? im->width : (im->width + 1) / 2,
+               ch = (NVCV_YUV420 == im->pixelFormat) ? (im->height + 1) / 2 : im->height;
+      hashRows(y, yPitch, im->width * yPixBytes, im->height);
+      if (1 == yPixBytes) {  // Otherwise chroma is interleaved with luma, and already hashed
+        if (1 == cPixBytes) {  // Planar
+          hashRows(u, cPitch, cw, ch);
+          hashRows(v, cPitch, cw, ch);
+        } else {  // Semiplanar, U and V interleaved
+          hashRows(u < v ? u : v, cPitch, cw * cPixBytes, ch);
+        }
+      }
+      if (withThumb) thumbnail(y, yPitch, im->width * yPixBytes, im->height);
+    } else {
+      unsigned planes = (NVCV_PLANAR == im->planar) ? im->numComponents : 1,
+               rowBytes = im->width * ((NVCV_PLANAR == im->planar) ? im->componentBytes : im->pixelBytes);
+      for (unsigned p = 0; p < planes; ++p)
+        hashRows((const unsigned char *)im->pixels + (ptrdiff_t)p * im->height * im->pitch, im->pitch, rowBytes,
+                 im->height);
+      if (withThumb) thumbnail((const unsigned char *)im->pixels, im->pitch, rowBytes, im->height);
+    }
+    if (!withThumb) thumb.clear();
+  }
+
+ private:
+  static uint64_t mix(uint64_t h, uint64_t w) {
+    h ^= w * 0xC2B2AE3D27D4EB4Full;
+    h = (h << 31) | (h >> 33);
+    return h * 0x9E3779B97F4A7C15ull;
+  }
+
+  // Four independent lanes of 8-byte words, so that the multiplies overlap.
+  void hashRows(const unsigned char *p, int pitch, unsigned rowBytes, unsigned rows) {
+    uint64_t h[4] = {hash, hash ^ 1, hash ^ 2, hash ^ 3}, w[4], tail;
+    for (unsigned r = 0; r < rows; ++r, p += pitch) {
+      unsigned x = 0;
+      for (; x + 32 <= rowBytes; x += 32) {
+        memcpy(w, p + x, 32);
+        h[0] = mix(h[0], w[0]);
+        h[1] = mix(h[1], w[1]);
+        h[2] = mix(h[2], w[2]);
+        h[3] = mix(h[3], w[3]);
+      }
+      for (; x + 8 <= rowBytes; x += 8) {
+        memcpy(&tail, p + x, 8);
+        h[0] = mix(h[0], tail);
+      }
+      if (x < rowBytes) {
+        tail = 0;
+        memcpy(&tail, p + x, rowBytes - x);
+        h[1] = mix(h[1], tail);
+      }
+    }
+    hash = mix(mix(mix(mix(h[0], h[1]), h[2]), h[3]), rowBytes * (uint64_t)rows);
+  }
+
+  static uint32_t sumBytes(const unsigned char *p, unsigned n) {
+    uint32_t sum = 0;
+    unsigned i = 0;
+#ifdef FRAMESIGNATURE_SSE2
+    __m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(p + i)), zero));
+    sum = (uint32_t)_mm_cvtsi128_si32(acc) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif  // FRAMESIGNATURE_SSE2
+    for (; i < n; ++i) sum += p[i];
+    return sum;
+  }
+
+  void thumbnail(const unsigned char *p, int pitch, unsigned rowBytes, unsigned rows) {
+    const unsigned cells = (rows < kCells || rowBytes < kCells) ? 1 : kCells;
+    std::vector<uint32_t> sums(cells * cells, 0);
+    thumb.assign(cells * cells, 0);
+    for (unsigned r = 0, j = 0; r < rows; ++r, p += pitch) {
+      while (r >= (size_t)(j + 1) * rows / cells) ++j;  // Cell row j spans [j * rows / cells, (j + 1) * rows / cells)
+      uint32_t *s = &sums[(size_t)j * cells];
+      for (unsigned c = 0; c < cells; ++c)
+        s[c] += sumBytes(p + (size_t)c * rowBytes / cells, (unsigned)((size_t)(c + 1) * rowBytes / cells -
+                                                                     (size_t)c * rowBytes / cells));
+    }
+    for (unsigned j = 0; j < cells; ++j) {
+      uint64_t n = (uint64_t)((size_t)(j + 1) * rows / cells - (size_t)j * rows / cells);
+      for (unsigned c = 0; c < cells; ++c) {
+        uint64_t count = n * ((size_t)(c + 1) * rowBytes / cells - (size_t)c * rowBytes / cells);
+        thumb[j * cells + c] = (uint16_t)((16ull * sums[j * cells + c] + count / 2) / count);
+      }
+    }
+  }
+};
+
+// Whether any byte of two equally sized regions of rows differs by more than tolerance, e.g. whether a tile of a frame
+// has changed since an earlier frame. Rows are compared 16 bytes at a time, and the comparison stops at the first
+// difference.
+inline bool RegionsDiffer(const unsigned char *a, int aPitch, const unsigned char *b, int bPitch, unsigned rowBytes,
+                          unsigned rows, unsigned char tolerance) {
+  for (unsigned r = 0; r < rows; ++r, a += aPitch, b += bPitch) {
+    unsigned x = 0;
+#ifdef FRAMESIGNATURE_SSE2
+    const __m128i tol = _mm_set1_epi8((char)tolerance), zero = _mm_setzero_si128();
+    for (; x + 16 <= rowBytes; x += 16) {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + x)), vb = _mm_loadu_si128((const __m128i *)(b + x));
+      __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));  // |a - b|
+      if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(d, tol), zero))) return true;
+    }
+#endif  // FRAMESIGNATURE_SSE2
+    for (; x < rowBytes; ++x)
+      if (abs((int)a[x] - (int)b[x]) > tolerance) return true;
+  }
+  return false;
+}
+
+#endif  // __FRAMESIGNATURE_H__
@@ -0,0 +1,297 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+
+#ifndef __IMAGEPOOL_H__
+#define __IMAGEPOOL_H__
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+
+#include "nvCVImage.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif  // NOMINMAX
+#include <Windows.h>
+#else  // !_WIN32
+#include <sys/mman.h>
+#endif  // _WIN32
+
+// A cache of NvCVImage buffers, keyed by their shape: width, height, pixel format, component type, layout, memory
+// space and alignment. Buffers that are released are kept for reuse by a later acquire() of the same shape. When the
+// total size exceeds the byte cap, the least recently used buffer not in use is reshaped with NvCVImage_Realloc()
+// (which keeps its memory if it is large enough) to satisfy a miss, or freed. The cap can be exceeded by buffers in
+// use. This is not thread-safe; each FXApp has its own pool.
+class NvCVImagePool {
+ public:
+  struct Stats {
+    unsigned long long hits = 0;       // acquire() found a free buffer of that shape
+    unsigned long long misses = 0;     // acquire() allocated or reshaped a buffer
+    unsigned long long evictions = 0;  // buffers freed or reshaped to stay within the cap
+    unsigned long long bytes = 0;      // bytes currently allocated, in use or not
+    unsigned long long peakBytes = 0;
+  };
+
+  explicit NvCVImagePool(unsigned long long maxBytes = 0) : _maxBytes(maxBytes) {}  // 0 means no cap
+  ~NvCVImagePool() {
+    for (Entry &e : _entries) delete e.im;  // ~NvCVImage() deallocates
+  }
+  NvCVImagePool(const NvCVImagePool &) = delete;
+  NvCVImagePool &operator=(const NvCVImagePool &) = delete;
+
+  void setMaxBytes(unsigned long long maxBytes) {
+    _maxBytes = maxBytes;
+    trim();
+  }
+
+  NvCV_Status acquire(unsigned width, unsigned height, NvCVImage_PixelFormat format, NvCVImage_ComponentType type,
+                      unsigned layout, unsigned memSpace, unsigned alignment, NvCVImage **im) {
+    const Key key = {width, height, format, type, layout, memSpace, alignment};
+    std::list<Entry>::iterator it, victim = _entries.end();
+    NvCV_Status err;
+
+    *im = nullptr;
+    for (it = _entries.begin(); it != _entries.end(); ++it) {  // Most recently used first
+      if (it->inUse) continue;
+      if (it->key == key) break;
+      if (it->key.memSpace == memSpace) victim = it;  // The least recently used reshapeable buffer
+    }
+    if (it != _entries.end()) {
+      ++_stats.hits;
+    } else {
+      ++_stats.misses;
+      if (victim != _entries.end() && _maxBytes && _stats.bytes >= _maxBytes) {
+        it = victim;  // Reshape rather than add another buffer
+        ++_stats.evictions;
+        _stats.bytes -= it->im->bufferBytes;
+        err = NvCVImage_Realloc(it->im, width, height, format, type, layout, memSpace, alignment);
+      } else {
+        it = _entries.emplace(_entries.begin(), Entry{key, new NvCVImage, false});
+        err = NvCVImage_Alloc(it->im, width, height, format, type, layout, memSpace, alignment);
+      }
+      if (NVCV_SUCCESS != err) {
+        delete it->im;
+        _entries.erase(it);
+        return err;
+      }
+      it->key = key;
+      _stats.bytes += it->im->bufferBytes;
+      if (_stats.peakBytes < _stats.bytes) _stats.peakBytes = _stats.bytes;
+    }
+    it->inUse = true;
+    _entries.splice(_entries.begin(), _entries, it);
+    *im = it->im;
+    trim();
+    return NVCV_SUCCESS;
+  }
+
+  // Return a buffer to the pool. NULL is ignored.
+  void release(NvCVImage *im) {
+    for (std::list<Entry>::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+      if (it->im == im) {
+        it->inUse = false;
+        _entries.splice(_entries.begin(), _entries, it);
+        break;
+      }
+    }
+    trim();
+  }
+
+  const Stats &stats() const { return _stats; }
+
+ private:
+  struct Key {
+    unsigned width, height;
+    NvCVImage_PixelFormat format;
+    NvCVImage_ComponentType type;
+    unsigned layout, memSpace, alignment;
+    bool operator==(const Key &k) const {
+      return width == k.width && height == k.height && format == k.format && type == k.type && layout == k.layout &&
+             memSpace == k.memSpace && alignment == k.alignment;
+    }
+  };
+  struct Entry {
+    Key key;
+    NvCVImage *im;
+    bool inUse;
+  };
+
+  // Free the least recently used buffers not in use, until we are within the cap.
+  void trim() {
+    if (!_maxBytes) return;
+    for (std::list<Entry>::iterator it = _entries.end(); _stats.bytes > _maxBytes && it != _entries.begin();) {
+      if ((--it)->inUse) continue;
+      ++_stats.evictions;
+      _stats.bytes -= it->im->bufferBytes;
+      delete it->im;
+      it = _entries.erase(it);
+    }
+  }
+
+  std::list<Entry> _entries;  // In order of most to least recently used
+  unsigned long long _maxBytes;
+  Stats _stats;
+};
+
+// A thread-safe cache of page-locked host buffers, by size, for the CPU side of the frames that are transferred to and
+// from the GPU, so that the driver can DMA them directly rather than staging them through a pinned buffer of its own.
+// Buffers come from NvCVImage_Alloc() in NVCV_CPU_PINNED memory. If that fails, as it does without a GPU, or if pinned
+// memory is not asked for, they are instead mapped and locked with mlock() (VirtualLock() on Windows); that keeps them
+// resident, and the pooling is the same, but the driver does not know that they are locked, so it still stages them.
+// Released buffers are kept for an acquire() of the same size, up to maxFree of them.
+class PinnedHostPool {
+ public:
+  struct Stats {
+    unsigned long long hits = 0;       // acquire() found a free buffer of that size
+    unsigned long long misses = 0;     // acquire() allocated a buffer
+    unsigned long long fallbacks = 0;  // buffers that are not NVCV_CPU_PINNED
+    unsigned long long unlocked = 0;   // of those, the ones that could not be locked either, e.g. for RLIMIT_MEMLOCK
+    unsigned long long bytes = 0;      // bytes currently allocated, in use or not
+    unsigned long long peakBytes = 0;
+  };
+
+  explicit PinnedHostPool(bool pinned = true, unsigned maxFree = 8) : _pinned(pinned), _maxFree(maxFree) {}
+  ~PinnedHostPool() {
+    for (Buffer &b : _buffers) destroy(&b);
+  }
+  PinnedHostPool(const PinnedHostPool &) = delete;
+  PinnedHostPool &operator=(const PinnedHostPool &) = delete;
+
+  // A buffer of the given size, or NULL if none could be allocated. memSpace, if not NULL, is set to NVCV_CPU_PINNED
+  // or NVCV_CPU.
+  void *acquire(size_t bytes, unsigned *memSpace = nullptr) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::list<Buffer>::iterator it;
+    for (it = _buffers.begin(); it != _buffers.end(); ++it)  // Most recently used first
+      if (!it->inUse && it->bytes == bytes) break;
+    if (it != _buffers.end()) {
+      ++_stats.hits;
+    } else {
+      ++_stats.misses;
+      it = _buffers.emplace(_buffers.begin());
+      if (!create(bytes, &*it)) {
+        _buffers.erase(it);
+        return nullptr;
+      }
+      _stats.bytes += bytes;
+      if (_stats.peakBytes < _stats.bytes) _stats.peakBytes = _stats.bytes;
+    }
+    it->inUse = true;
+    _buffers.splice(_buffers.begin(), _buffers, it);
+    if (memSpace) *memSpace = it->memSpace;
+    return it->data;
+  }
+
+  // Return a buffer to the pool. NULL is ignored.
+  void release(void *data) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    unsigned numFree = 0;
+    for (std::list<Buffer>::iterator it = _buffers.begin(); it != _buffers.end(); ++it) {
+      if (it->data == data) {
+        it->inUse = false;
+        _buffers.splice(_buffers.begin(), _buffers, it);
+        break;
+      }
+    }
+    for (std::list<Buffer>::iterator it = _buffers.begin(); it != _buffers.end();) {  // Free the least recently used
+      if (it->inUse || ++numFree <= _maxFree) {
+        ++it;
+        continue;
+      }
+      _stats.bytes -= it->bytes;
+      destroy(&*it);
+      it = _buffers.erase(it);
+    }
+  }
+
+  // NVCV_CPU_PINNED if data is in a buffer of the pool that is, otherwise NVCV_CPU.
+  unsigned memSpace(const void *data) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const Buffer &b : _buffers)
+      if ((const unsigned char *)data >= b.data && (const unsigned char *)data < b.data + b.bytes) return b.memSpace;
+    return NVCV_CPU;
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+ private:
+  struct Buffer {
+    NvCVImage im;  // The pinned allocation
+    unsigned char *data = nullptr;
+    size_t bytes = 0;
+    unsigned memSpace = NVCV_CPU;
+    bool locked = false;
+    bool inUse = false;
+  };
+
+  bool create(size_t bytes, Buffer *b) {
+    b->bytes = bytes;
+    if (_pinned && bytes <= 0xFFFFFFFFu &&
+        NVCV_SUCCESS == NvCVImage_Alloc(&b->im, (unsigned)bytes, 1, NVCV_Y, NVCV_U8, NVCV_CHUNKY, NVCV_CPU_PINNED, 0)) {
+      b->data = (unsigned char *)b->im.pixels;
+      b->memSpace = NVCV_CPU_PINNED;
+      return true;
+    }
+    ++_stats.fallbacks;
+#ifdef _WIN32
+    b->data = (unsigned char *)VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!b->data) return false;
+    b->locked = 0 != VirtualLock(b->data, bytes);
+#else   // !_WIN32
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == p) return false;
+    b->data = (unsigned char *)p;
+    b->locked = 0 == mlock(p, bytes);
+#endif  // _WIN32
+    if (!b->locked) ++_stats.unlocked;
+    return true;
+  }
+
+  void destroy(Buffer *b) {
+    if (NVCV_CPU_PINNED == b->memSpace) {
+      NvCVImage_Dealloc(&b->im);
+    } else if (b->data) {
+#ifdef _WIN32
+      if (b->locked) VirtualUnlock(b->data, b->bytes);
+      VirtualFree(b->data, 0, MEM_RELEASE);
+#else   // !_WIN32
+      munmap(b->data, b->bytes);  // Which also unlocks it
+#endif  // _WIN32
+    }
+    b->data = nullptr;
+  }
+
+  mutable std::mutex _mutex;
+  std::list<Buffer> _buffers;  // In order of most to least recently used
+  bool _pinned;
+  unsigned _maxFree;
+  Stats _stats;
+};
+
+#endif  // __IMAGEPOOL_H__
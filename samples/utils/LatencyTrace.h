@@ -0,0 +1,160 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __LATENCYTRACE_H__
+#define __LATENCYTRACE_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// The latency of each frame, from its capture to its output, and between the points on the way. Each frame carries
+// its own Stamps through the pipeline, whichever threads it passes through, and is recorded once it has been output,
+// by the one thread that does that. The latencies are reported as histograms, and as a trace for chrome://tracing,
+// with a row per interval, in which the frames in flight overlap. As with StageTimer, a disabled trace neither reads
+// the clock nor records anything.
+class LatencyTrace {
+ public:
+  enum Point { CAPTURE, PRE_UPLOAD, POST_RUN, POST_DOWNLOAD, OUTPUT, NUM_POINTS };
+  enum { NUM_INTERVALS = NUM_POINTS - 1 };  // Interval i is from point i to point i + 1
+  typedef std::chrono::steady_clock Clock;
+
+  struct Stamps {
+    unsigned long long frame = 0;
+    Clock::time_point t[NUM_POINTS];
+  };
+
+  void enable(bool on, size_t expectedFrames = 0) {
+    _enabled = on;
+    if (!on) return;
+    _frames.clear();
+    _frames.reserve(expectedFrames);
+    _start = Clock::now();
+  }
+  bool enabled() const { return _enabled; }
+
+  void stamp(Stamps *stamps, Point point) const {
+    if (_enabled) stamps->t[point] = Clock::now();
+  }
+  // Points that a frame skipped, e.g. the upload of a frame that reused an earlier output, take the time of the next.
+  void record(const Stamps &stamps) {
+    if (!_enabled) return;
+    _frames.push_back(stamps);
+    Stamps &s = _frames.back();
+    for (int p = NUM_POINTS - 2; p >= 0; --p)
+      if (s.t[p] == Clock::time_point()) s.t[p] = s.t[p + 1];
+  }
+  float sinceCapture(const Stamps &stamps) const {  // Milliseconds
+    return _enabled ? ms(stamps.t[CAPTURE], Clock::now()) : 0.f;
+  }
+
+  static const char *intervalName(int interval) {
+    static const char *names[NUM_INTERVALS] = {"wait", "upload+run", "download", "output"};
+    return names[interval];
+  }
+
+  // A histogram of frames by latency, in power-of-two bins of milliseconds, with a column per interval and one for
+  // the whole, followed by percentiles.
+  void print() const {
+    static const int kBins = 12;  // [0, 1), [1, 2), [2, 4) ... [512, 1024), and 1024 up
+    unsigned long long counts[kBins][NUM_INTERVALS + 1] = {};
+    std::vector<float> sorted[NUM_INTERVALS + 1];
+    int col, bin, lastBin = 0;
+    if (_frames.empty()) return;
+    for (const Stamps &s : _frames) {
+      for (col = 0; col <= NUM_INTERVALS; ++col) {
+        float t = (col < NUM_INTERVALS) ? ms(s.t[col], s.t[col + 1]) : ms(s.t[CAPTURE], s.t[OUTPUT]);
+        for (bin = 0; bin + 1 < kBins && t >= (float)(1 << bin);) ++bin;
+        ++counts[bin][col];
+        lastBin = std::max(lastBin, bin);
+        sorted[col].push_back(t);
+      }
+    }
+    printf("Latency of %zu frames, from capture to output:\n%-12s", _frames.size(), "ms");
+    for (col = 0; col < NUM_INTERVALS; ++col) printf(" %10s", intervalName(col));
+    printf(" %10s\n", "total");
+    for (bin = 0; bin <= lastBin; ++bin) {
+      char range[16];
+      if (bin + 1 == kBins)
+        snprintf(range, sizeof(range), "%d+", 1 << (bin - 1));
+      else
+        snprintf(range, sizeof(range), "%d-%d", bin ? 1 << (bin - 1) : 0, 1 << bin);
+      printf("%-12s", range);
+      for (col = 0; col <= NUM_INTERVALS; ++col) printf(" %10llu", counts[bin][col]);
+      printf("\n");
+    }
+    for (std::vector<float> &v : sorted) std::sort(v.begin(), v.end());
+    static const double kPercentiles[] = {.50, .90, .99, 1.};
+    for (double p : kPercentiles) {
+      printf("%-12s", (1. == p) ? "max" : (.50 == p) ? "p50" : (.90 == p) ? "p90" : "p99");
+      for (col = 0; col <= NUM_INTERVALS; ++col) {
+        size_t rank = (size_t)(p * sorted[col].size() + 0.999999);  // nearest rank
+        printf(" %10.3f", sorted[col][rank ? rank - 1 : 0]);
+      }
+      printf("\n");
+    }
+  }
+
+  // The Trace Event Format of chrome://tracing and Perfetto: a complete ("X") event per frame per interval, on a row
+  // ("thread") per interval, and a counter of the frames between capture and output.
+  bool writeChromeTrace(const char *file) const {
+    FILE *fd = fopen(file, "w");
+    std::vector<std::pair<double, int>> changes;  // Of the number of frames in flight
+    int col, inFlight = 0;
+    if (!fd) return false;
+    fprintf(fd, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fd, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"VideoEffects\"}}");
+    for (col = 0; col < NUM_INTERVALS; ++col)
+      fprintf(fd,
+              ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+              col + 1, intervalName(col));
+    for (const Stamps &s : _frames) {
+      for (col = 0; col < NUM_INTERVALS; ++col)
+        fprintf(fd,
+                ",\n{\"name\": \"frame %llu\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                "\"ts\": %.3f, \"dur\": %.3f}",
+                s.frame, intervalName(col), col + 1, us(s.t[col]), us(s.t[col + 1]) - us(s.t[col]));
+      changes.push_back(std::make_pair(us(s.t[CAPTURE]), +1));
+      changes.push_back(std::make_pair(us(s.t[OUTPUT]), -1));
+    }
+    std::sort(changes.begin(), changes.end());  // At a tie, a frame leaves before the next arrives
+    for (const std::pair<double, int> &change : changes)
+      fprintf(fd, ",\n{\"name\": \"frames in flight\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {\"frames\": %d}}",
+              change.first, inFlight += change.second);
+    fprintf(fd, "\n]}\n");
+    return 0 == fclose(fd);
+  }
+
+ private:
+  static float ms(Clock::time_point t0, Clock::time_point t1) {
+    return std::chrono::duration<float, std::milli>(t1 - t0).count();
+  }
+  double us(Clock::time_point t) const { return std::chrono::duration<double, std::micro>(t - _start).count(); }
+
+  bool _enabled = false;
+  std::vector<Stamps> _frames;
+  Clock::time_point _start;
+};
+
+#endif  // __LATENCYTRACE_H__
@@ -0,0 +1,100 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __QUALITYCONTROLLER_H__
+#define __QUALITYCONTROLLER_H__
+
+// Chooses, from a ladder of configurations of an effect ordered from the best and most expensive (level 0) to the
+// cheapest, the best one whose time per frame keeps within a deadline, from the times measured at the level in use.
+// Times are averaged over windows of frames; a window over the deadline steps down one level at once, but stepping
+// up takes several windows with ample headroom, and more after each step up that had to be undone, so that the level
+// settles rather than oscillating between one that is too slow and one that is fast enough.
+class QualityController {
+ public:
+  void init(double deadlineMs, unsigned numLevels, unsigned window = 15) {
+    _deadline = deadlineMs;
+    _numLevels = numLevels ? numLevels : 1;
+    _window = window ? window : 1;
+    _level = 0;
+    _upHold = kMinUpHold;
+    _switches = 0;
+    restart();
+  }
+
+  // Account for a frame processed at the current level, and return the level at which to process the next one.
+  unsigned update(double ms) {
+    if (_settle) {  // The frames after a switch also pay for it
+      --_settle;
+      return _level;
+    }
+    _sum += ms;
+    if (++_count < _window) return _level;
+    _average = _sum / _count;
+    _sum = 0.;
+    _count = 0;
+    if (_average > _deadline) {
+      if (_steppedUp) _upHold = (2 * _upHold < kMaxUpHold) ? 2 * _upHold : kMaxUpHold;  // That was premature
+      if (_level + 1 < _numLevels) step(_level + 1);
+      _headroom = 0;
+    } else {
+      if (_steppedUp) _upHold = kMinUpHold;  // The step up held
+      _steppedUp = false;
+      if (_average > kHeadroom * _deadline)
+        _headroom = 0;
+      else if (_level && ++_headroom >= _upHold)
+        step(_level - 1);
+    }
+    return _level;
+  }
+
+  unsigned level() const { return _level; }
+  double deadline() const { return _deadline; }
+  double average() const { return _average; }  // Per frame, over the last window
+  unsigned long long switches() const { return _switches; }
+
+ private:
+  static constexpr double kHeadroom = .75;  // Step up only from under this fraction of the deadline
+  static const unsigned kSettleFrames = 2, kMinUpHold = 2, kMaxUpHold = 64;
+
+  void step(unsigned level) {
+    _steppedUp = level < _level;
+    _level = level;
+    ++_switches;
+    restart();
+  }
+  void restart() {
+    _sum = 0.;
+    _count = 0;
+    _headroom = 0;
+    _settle = kSettleFrames;
+  }
+
+  double _deadline = 0., _sum = 0., _average = 0.;
+  unsigned _numLevels = 1, _window = 15, _level = 0, _count = 0, _settle = 0;
+  unsigned _headroom = 0;             // Consecutive windows under kHeadroom * _deadline
+  unsigned _upHold = kMinUpHold;      // Windows of headroom needed to step up
+  bool _steppedUp = false;            // The last switch was up, and no window has been measured since
+  unsigned long long _switches = 0;
+};
+
+#endif  // __QUALITYCONTROLLER_H__
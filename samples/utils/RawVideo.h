@@ -0,0 +1,547 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __RAWVIDEO_H__
+#define __RAWVIDEO_H__
+
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameQueue.h"
+#include "nvCVImage.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif  // NOMINMAX
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else  // !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+// The format of uncompressed 8-bit video frames, stored back to back in a headerless file, or in a YUV4MPEG2 (Y4M)
+// stream. Frames are tightly packed: the pitch is the width times the bytes per pixel of the first plane.
+struct RawVideoFormat {
+  unsigned width = 0, height = 0;
+  NvCVImage_PixelFormat format = NVCV_FORMAT_UNKNOWN;
+  unsigned layout = NVCV_CHUNKY;
+  double frameRate = 0.;
+  unsigned colorspace = 0;      // The NVCV_FULL_RANGE and NVCV_CHROMA_* bits given by a Y4M header,
+  bool hasColorspace = false;   // if it gave any
+
+  bool isYUV() const { return NVCV_YUV420 == format || NVCV_YUV422 == format || NVCV_YUV444 == format; }
+  int pixelBytes() const {
+    switch (format) {
+      case NVCV_BGR: case NVCV_RGB:   return 3;
+      case NVCV_BGRA: case NVCV_RGBA: return 4;
+      case NVCV_YUV422:               return (NVCV_YUV == layout || NVCV_YVU == layout) ? 1 : 2;  // planar or chunky
+      default:                        return 1;  // The luma plane of YUV, or gray
+    }
+  }
+  int pitch() const { return (int)width * pixelBytes(); }
+  size_t frameBytes() const {
+    size_t luma = (size_t)width * height;
+    switch (format) {
+      case NVCV_YUV420: return luma * 3 / 2;
+      case NVCV_YUV422: return luma * 2;
+      case NVCV_YUV444: return luma * 3;
+      default:          return luma * pixelBytes();
+    }
+  }
+
+  // Make im a view of the frame at p; nothing is copied.
+  NvCV_Status wrap(const void *p, NvCVImage *im) const {
+    NvCV_Status err = NvCVImage_Init(im, width, height, pitch(), const_cast<void *>(p), format, NVCV_U8, layout,
+                                     NVCV_CPU);
+    im->colorspace = (unsigned char)colorspace;
+    return err;
+  }
+};
+
+// Parse a format such as "nv12", "nv12:1920x1080" or "nv12:1920x1080@29.97". The size and rate are left as they
+// were if they are not given. Returns false, having printed why, if the format is not one of those below.
+inline bool ParseRawVideoFormat(const std::string &spec, RawVideoFormat *fmt) {
+  static const struct {
+    const char *name;
+    NvCVImage_PixelFormat format;
+    unsigned layout;
+  } formats[] = {
+      {"nv12", NVCV_YUV420, NVCV_NV12}, {"nv21", NVCV_YUV420, NVCV_NV21}, {"i420", NVCV_YUV420, NVCV_I420},
+      {"yv12", NVCV_YUV420, NVCV_YV12}, {"yuy2", NVCV_YUV422, NVCV_YUY2}, {"yuyv", NVCV_YUV422, NVCV_YUYV},
+      {"uyvy", NVCV_YUV422, NVCV_UYVY}, {"i422", NVCV_YUV422, NVCV_YUV},  {"i444", NVCV_YUV444, NVCV_YUV},
+      {"bgr24", NVCV_BGR, NVCV_CHUNKY}, {"rgb24", NVCV_RGB, NVCV_CHUNKY}, {"bgra", NVCV_BGRA, NVCV_CHUNKY},
+      {"rgba", NVCV_RGBA, NVCV_CHUNKY}, {"gray", NVCV_Y, NVCV_CHUNKY},
+  };
+  size_t colon = spec.find(':');
+  std::string name = spec.substr(0, colon);
+  for (char &c : name) c = (char)tolower((unsigned char)c);
+  for (const auto &f : formats) {
+    if (name != f.name) continue;
+    fmt->format = f.format;
+    fmt->layout = f.layout;
+    if (colon == std::string::npos) return true;
+    unsigned w, h;
+    double fps;
+    int n = sscanf(spec.c_str() + colon + 1, "%ux%u@%lf", &w, &h, &fps);
+    if (n < 2 || !w || !h || (3 == n && !(fps > 0.))) break;
+    fmt->width = w;
+    fmt->height = h;
+    if (3 == n) fmt->frameRate = fps;
+    return true;
+  }
+  printf("Unknown raw video format \"%s\"; expected e.g. nv12:1920x1080@30, with one of nv12, nv21, i420, yv12, "
+         "yuy2, uyvy, i422, i444, bgr24, rgb24, bgra, rgba or gray\n", spec.c_str());
+  return false;
+}
+
+// Y4M carries planar YUV and gray only; other formats are stored in the nearest planar one.
+inline RawVideoFormat Y4MFormatFor(const RawVideoFormat &fmt) {
+  RawVideoFormat y4m = fmt;
+  if (NVCV_Y != fmt.format) {
+    if (!fmt.isYUV()) y4m.format = NVCV_YUV420;
+    y4m.layout = NVCV_YUV;
+  }
+  return y4m;
+}
+
+// A path of "-" is standard input or output, so that frames can be piped to and from e.g. ffmpeg.
+inline bool IsStdioPath(const char *path) { return !strcmp(path, "-"); }
+
+inline FILE *RawVideoStdin() {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+#endif  // _WIN32
+  return stdin;
+}
+
+// The original standard output, for frames. On the first call, stdout is redirected to stderr, so that whatever is
+// printed thereafter does not end up among the frames; call it before anything else is printed.
+inline FILE *RawVideoStdout() {
+  static FILE *fp = nullptr;
+  if (!fp) {
+    fflush(stdout);
+#ifdef _WIN32
+    int fd = _dup(_fileno(stdout));
+    if (fd >= 0) _setmode(fd, _O_BINARY);
+    if (fd >= 0 && nullptr != (fp = _fdopen(fd, "wb"))) _dup2(_fileno(stderr), _fileno(stdout));
+#else   // !_WIN32
+    int fd = dup(fileno(stdout));
+    if (fd >= 0 && nullptr != (fp = fdopen(fd, "wb"))) dup2(fileno(stderr), fileno(stdout));
+#endif  // _WIN32
+    if (fp) setvbuf(stdout, nullptr, _IONBF, 0);  // Interleave with stderr, as the terminal would
+  }
+  return fp;
+}
+
+// Read-only memory map of a whole file, read front to back.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const char *path) {
+    close();
+#ifdef _WIN32
+    _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr);
+    LARGE_INTEGER size;
+    if (INVALID_HANDLE_VALUE == _file || !GetFileSizeEx(_file, &size)) return false;
+    _size = (size_t)size.QuadPart;
+    if (!_size) return true;
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping) return false;
+    _data = (const unsigned char *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    return nullptr != _data;
+#else   // !_WIN32
+    int fd = ::open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0) return false;
+    if (fstat(fd, &st) < 0) {
+      ::close(fd);
+      return false;
+    }
+    _size = (size_t)st.st_size;
+    void *p = _size ? mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    ::close(fd);  // The mapping keeps the file open
+    if (MAP_FAILED == p) return false;
+    _data = (const unsigned char *)p;
+    if (_data) madvise(p, _size, MADV_SEQUENTIAL);  // Aggressive readahead, and early reclaim of pages read
+    return true;
+#endif  // _WIN32
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle(_mapping);
+    if (INVALID_HANDLE_VALUE != _file) CloseHandle(_file);
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+#else   // !_WIN32
+    if (_data) munmap(const_cast<unsigned char *>(_data), _size);
+#endif  // _WIN32
+    _data = nullptr;
+    _size = 0;
+  }
+
+  // Ask for [offset, offset + bytes) to be read ahead, as the caller is about to get to it.
+  void willNeed(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+    const size_t page = 4096;
+    if (offset >= _size) return;
+    if (bytes > _size - offset) bytes = _size - offset;
+    size_t begin = offset & ~(page - 1);
+    madvise(const_cast<unsigned char *>(_data) + begin, bytes + (offset - begin), MADV_WILLNEED);
+#else   // !_WIN32: FILE_FLAG_SEQUENTIAL_SCAN reads ahead
+    (void)offset, (void)bytes;
+#endif  // _WIN32
+  }
+
+  const unsigned char *data() const { return _data; }
+  size_t size() const { return _size; }
+
+ private:
+  const unsigned char *_data = nullptr;
+  size_t _size = 0;
+#ifdef _WIN32
+  HANDLE _file = INVALID_HANDLE_VALUE, _mapping = nullptr;
+#endif  // _WIN32
+};
+
+// Reads a Y4M file, or a headerless file of frames of a given format, by mapping it into memory. Each frame is
+// returned as an NvCVImage view of the mapping, so nothing is copied until the frame is converted for the effect.
+// Standard input cannot be mapped, so it is instead read ahead, a whole frame per fread(), into a few recycled frame
+// buffers on a thread of its own, which keeps the pipe drained while the caller works on the previous frames.
+class RawVideoReader {
+ public:
+  ~RawVideoReader() { close(); }
+
+  // Open a Y4M file if headerless is null; otherwise a headerless file of frames of that format and size. A path of
+  // "-" is standard input. Returns false, having printed why, on failure.
+  bool open(const char *path, const RawVideoFormat *headerless, unsigned depth = 4) {
+    close();
+    _pos = 0;
+    _prefetched = 0;
+    _stream = IsStdioPath(path);
+    if (_stream) {
+      _fp = RawVideoStdin();
+    } else if (!_file.open(path)) {
+      printf("Error: Could not open video: \"%s\"\n", path);
+      return false;
+    }
+    if (headerless) {
+      _fmt = *headerless;
+      _y4m = false;
+      if (!_fmt.width || !_fmt.height) {
+        printf("Error: the size of the frames of \"%s\" must be given, e.g. --raw_format=nv12:1920x1080\n", path);
+        return false;
+      }
+    } else if (!parseY4MHeader(path)) {
+      return false;
+    }
+    if ((NVCV_YUV420 == _fmt.format && ((_fmt.width | _fmt.height) & 1)) ||
+        (NVCV_YUV422 == _fmt.format && (_fmt.width & 1))) {
+      printf("Error: \"%s\": %ux%u is not a whole number of chroma samples\n", path, _fmt.width, _fmt.height);
+      return false;
+    }
+    if (!(_fmt.frameRate > 0.)) _fmt.frameRate = 30.;
+    if (!_stream) {
+      _file.willNeed(_pos, readahead());
+      return true;
+    }
+    _bufs.resize(depth);
+    for (std::vector<unsigned char> &buf : _bufs) buf.resize(_fmt.frameBytes());
+    _free.reset(new FrameQueue<unsigned>(depth));
+    _full.reset(new FrameQueue<unsigned>(depth));
+    for (unsigned i = 0; i < depth; ++i) _free->push(i);
+    _held = false;
+    _thread = std::thread(&RawVideoReader::run, this);
+    return true;
+  }
+
+  const RawVideoFormat &format() const { return _fmt; }
+
+  // The number of frames, assuming that every Y4M frame header is as long as the first; 0 if unknown, as for a pipe.
+  long long frameCount() const {
+    size_t header = 0, bytes = _fmt.frameBytes();
+    if (_y4m && _pos + 5 <= _file.size() && !memcmp(_file.data() + _pos, "FRAME", 5)) {
+      const void *eol = memchr(_file.data() + _pos, '\n', _file.size() - _pos);
+      if (eol) header = (const unsigned char *)eol - (_file.data() + _pos) + 1;
+    }
+    return bytes ? (long long)((_file.size() - _pos) / (header + bytes)) : 0;
+  }
+
+  // Make frame a view of the next frame. It remains valid until the reader is closed, or, for standard input, until
+  // the next read(). Returns false at the end of the file, including a truncated last frame.
+  bool read(NvCVImage *frame) {
+    const size_t bytes = _fmt.frameBytes();
+    if (_stream) {
+      if (_held) _free->push(_current);  // The previous frame is done with
+      _held = _full->pop(&_current);
+      return _held && NVCV_SUCCESS == _fmt.wrap(_bufs[_current].data(), frame);
+    }
+    if (_y4m) {
+      if (_pos + 5 > _file.size() || memcmp(_file.data() + _pos, "FRAME", 5)) return false;
+      const void *eol = memchr(_file.data() + _pos, '\n', _file.size() - _pos);
+      if (!eol) return false;
+      _pos = (const unsigned char *)eol - _file.data() + 1;
+    }
+    if (bytes > _file.size() - _pos) return false;
+    if (NVCV_SUCCESS != _fmt.wrap(_file.data() + _pos, frame)) return false;
+    _pos += bytes;
+    if (_pos >= _prefetched) {  // Keep the next few frames on their way in
+      _file.willNeed(_pos, readahead());
+      _prefetched = _pos + readahead() / 2;
+    }
+    return true;
+  }
+
+  // Standard input is left open; the reader thread finishes the frame that it is reading, if any.
+  void close() {
+    if (_thread.joinable()) {
+      _free->close();
+      _full->close();
+      _thread.join();
+    }
+    _file.close();
+    _fp = nullptr;
+  }
+
+ private:
+  void run() {
+    const size_t bytes = _fmt.frameBytes();
+    std::string header;
+    unsigned i;
+    while (_free->pop(&i)) {
+      if (_y4m && (!readLine(&header) || header.compare(0, 5, "FRAME"))) break;
+      if (fread(_bufs[i].data(), 1, bytes, _fp) != bytes || !_full->push(i)) break;
+    }
+    _full->close();
+  }
+
+  bool readLine(std::string *line) {
+    int c;
+    line->clear();
+    while (EOF != (c = getc(_fp)) && '\n' != c)
+      if (line->size() < 4096) line->push_back((char)c);
+    return EOF != c;
+  }
+
+  size_t readahead() const {
+    size_t bytes = 4 * _fmt.frameBytes();
+    return bytes > (32u << 20) ? bytes : (32u << 20);
+  }
+
+  bool parseY4MHeader(const char *path) {
+    std::string header;
+    if (_stream) {
+      if (!readLine(&header)) header.clear();
+    } else {
+      const char *p = (const char *)_file.data();
+      const char *eol = p ? (const char *)memchr(p, '\n', _file.size()) : nullptr;
+      if (eol) header.assign(p, eol);
+      _pos = eol ? (size_t)(eol + 1 - p) : 0;
+    }
+    if (header.compare(0, 10, "YUV4MPEG2 ")) {
+      printf("Error: \"%s\" is not a YUV4MPEG2 file\n", path);
+      return false;
+    }
+    const char *p = header.c_str(), *eol = p + header.size();
+    std::string chroma = "420jpeg", range;
+    unsigned num = 0, den = 0;
+    _fmt = RawVideoFormat();
+    for (p += 9; p < eol;) {
+      while (p < eol && ' ' == *p) ++p;
+      const char *tok = p;
+      while (p < eol && ' ' != *p) ++p;
+      if (tok == p) break;
+      std::string val(tok + 1, p);
+      switch (*tok) {
+        case 'W': _fmt.width = (unsigned)strtoul(val.c_str(), nullptr, 10); break;
+        case 'H': _fmt.height = (unsigned)strtoul(val.c_str(), nullptr, 10); break;
+        case 'F': sscanf(val.c_str(), "%u:%u", &num, &den); break;
+        case 'C': chroma = val; break;
+        case 'X':
+          if (!val.compare(0, 11, "COLORRANGE=")) range = val.substr(11);
+          break;
+        default: break;  // Interlacing, aspect ratio, and comments do not matter here
+      }
+    }
+    _y4m = true;
+    if (num && den) _fmt.frameRate = (double)num / den;
+    _fmt.layout = NVCV_YUV;
+    if (!chroma.compare(0, 3, "420")) {
+      _fmt.format = NVCV_YUV420;
+      _fmt.colorspace = ("420mpeg2" == chroma) ? NVCV_CHROMA_MPEG2
+                        : ("420paldv" == chroma) ? NVCV_CHROMA_TOPLEFT
+                                                 : NVCV_CHROMA_JPEG;  // 420, 420jpeg
+      _fmt.hasColorspace = ("420" == chroma || "420jpeg" == chroma || "420mpeg2" == chroma || "420paldv" == chroma);
+    } else if ("422" == chroma) {
+      _fmt.format = NVCV_YUV422;
+    } else if ("444" == chroma) {
+      _fmt.format = NVCV_YUV444;
+    } else if ("mono" == chroma) {
+      _fmt.format = NVCV_Y;
+      _fmt.layout = NVCV_CHUNKY;
+    }
+    if (NVCV_FORMAT_UNKNOWN == _fmt.format || (NVCV_YUV420 == _fmt.format && !_fmt.hasColorspace)) {
+      printf("Error: \"%s\": unsupported Y4M colorspace C%s; 8-bit 420, 422, 444 or mono is supported\n", path,
+             chroma.c_str());
+      return false;
+    }
+    if (!range.empty()) {
+      _fmt.hasColorspace = true;
+      if ("FULL" == range) _fmt.colorspace |= NVCV_FULL_RANGE;
+    }
+    if (!_fmt.width || !_fmt.height) {
+      printf("Error: \"%s\": the Y4M header has no size\n", path);
+      return false;
+    }
+    return true;
+  }
+
+  MappedFile _file;
+  RawVideoFormat _fmt;
+  size_t _pos = 0;         // The offset of the next frame, or its Y4M frame header
+  size_t _prefetched = 0;  // Readahead is renewed when _pos gets here
+  bool _y4m = false;
+
+  // Standard input
+  bool _stream = false;
+  FILE *_fp = nullptr;
+  std::vector<std::vector<unsigned char>> _bufs;
+  std::unique_ptr<FrameQueue<unsigned>> _free, _full;  // Buffer indices, to the reader thread and to the caller
+  unsigned _current = 0;                               // The buffer of the last frame returned by read()
+  bool _held = false;                                  // whether the caller still has it
+  std::thread _thread;
+};
+
+// Writes frames as Y4M or headerless, on a thread of its own, so that the caller can convert the next frame while
+// the previous ones are written. acquire() hands out one of a few frame buffers, as an NvCVImage for the caller to
+// fill, and commit() queues it to be written; acquire() blocks while all of the buffers are queued.
+class RawVideoWriter {
+ public:
+  ~RawVideoWriter() { close(); }
+
+  // Returns false, having printed why, on failure. A Y4M file needs a planar YUV or gray format; see Y4MFormatFor().
+  // A path of "-" is standard output.
+  bool open(const char *path, const RawVideoFormat &fmt, bool y4m, unsigned depth = 4) {
+    close();
+    _fmt = fmt;
+    _stdout = IsStdioPath(path);
+    _fp = _stdout ? RawVideoStdout() : fopen(path, "wb");
+    if (!_fp) {
+      printf("Cannot open \"%s\" for writing\n", path);
+      return false;
+    }
+    _y4m = y4m;
+    _failed = false;
+    if (y4m && !writeY4MHeader()) _failed = true;
+    _bufs.resize(depth);
+    for (std::vector<unsigned char> &buf : _bufs) buf.resize(fmt.frameBytes());
+    _free.reset(new FrameQueue<unsigned>(depth));
+    _full.reset(new FrameQueue<unsigned>(depth));
+    for (unsigned i = 0; i < depth; ++i) _free->push(i);
+    _thread = std::thread(&RawVideoWriter::run, this);
+    return true;
+  }
+
+  // Make frame a view of the next buffer to fill. Returns false if an earlier write failed.
+  bool acquire(NvCVImage *frame) {
+    if (_failed || !_free->pop(&_current)) return false;
+    return NVCV_SUCCESS == _fmt.wrap(_bufs[_current].data(), frame);
+  }
+
+  void commit() { _full->push(_current); }
+
+  // Write whatever is queued and close the file. Returns false if anything could not be written.
+  bool close() {
+    if (!_fp) return true;
+    _full->close();
+    _thread.join();
+    if (0 != (_stdout ? fflush(_fp) : fclose(_fp))) _failed = true;
+    _fp = nullptr;
+    return !_failed;
+  }
+
+  bool failed() const { return _failed; }
+
+ private:
+  void run() {
+    unsigned i;
+    while (_full->pop(&i)) {
+      if (!_failed && ((_y4m && 6 != fwrite("FRAME\n", 1, 6, _fp)) ||
+                       fwrite(_bufs[i].data(), 1, _bufs[i].size(), _fp) != _bufs[i].size()))
+        _failed = true;
+      _free->push(i);
+    }
+  }
+
+  bool writeY4MHeader() {
+    const char *chroma = "mono";
+    unsigned num, den;
+    if (NVCV_YUV420 == _fmt.format)
+      chroma = (NVCV_CHROMA_TOPLEFT & _fmt.colorspace)      ? "420paldv"
+               : (NVCV_CHROMA_INTSTITIAL & _fmt.colorspace) ? "420jpeg"
+                                                            : "420mpeg2";
+    else if (NVCV_YUV422 == _fmt.format)
+      chroma = "422";
+    else if (NVCV_YUV444 == _fmt.format)
+      chroma = "444";
+    if (std::fabs(_fmt.frameRate - std::round(_fmt.frameRate)) < 1e-3)
+      num = (unsigned)std::round(_fmt.frameRate), den = 1;
+    else if (std::fabs(_fmt.frameRate * 1.001 - std::round(_fmt.frameRate * 1.001)) < 1e-3)
+      num = (unsigned)std::round(_fmt.frameRate * 1.001) * 1000, den = 1001;  // NTSC rates, e.g. 30000:1001
+    else
+      num = (unsigned)std::round(_fmt.frameRate * 1000.), den = 1000;
+    return 0 < fprintf(_fp, "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C%s XCOLORRANGE=%s\n", _fmt.width, _fmt.height, num,
+                       den, chroma, (NVCV_FULL_RANGE & _fmt.colorspace) ? "FULL" : "LIMITED");
+  }
+
+  RawVideoFormat _fmt;
+  FILE *_fp = nullptr;
+  bool _stdout = false;
+  bool _y4m = false;
+  std::atomic<bool> _failed{false};
+  std::vector<std::vector<unsigned char>> _bufs;
+  std::unique_ptr<FrameQueue<unsigned>> _free, _full;  // Buffer indices, to the caller and to the writer thread
+  unsigned _current = 0;                               // The buffer handed out by acquire()
+  std::thread _thread;
+};
+
+#endif  // __RAWVIDEO_H__
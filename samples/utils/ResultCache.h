@@ -0,0 +1,281 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+
+#ifndef __RESULTCACHE_H__
+#define __RESULTCACHE_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "RawVideo.h"  // MappedFile
+#include "nvCVImage.h"
+
+// A 128-bit hash of a stream of bytes, as two independent 64-bit lanes, by which results are addressed by the content
+// and the settings that they were computed from.
+class ContentHash {
+ public:
+  ContentHash() : _h{0x243F6A8885A308D3ull, 0x13198A2E03707344ull} {}
+
+  ContentHash &update(const void *data, size_t bytes) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t w;
+    _length += bytes;
+    while (bytes && _fill) {  // Complete a word begun by the last update
+      _word |= (uint64_t)*p++ << (8 * _fill);
+      --bytes;
+      if (8 == ++_fill) {
+        mixWord(_word);
+        _word = 0;
+        _fill = 0;
+      }
+    }
+    for (; bytes >= 8; p += 8, bytes -= 8) {
+      memcpy(&w, p, 8);
+      mixWord(w);
+    }
+    for (; bytes; --bytes) _word |= (uint64_t)*p++ << (8 * _fill++);
+    return *this;
+  }
+  ContentHash &update(const std::string &str) {  // With its length, so that consecutive strings are unambiguous
+    uint64_t n = str.size();
+    return update(&n, sizeof(n)).update(str.data(), str.size());
+  }
+  template <typename T>
+  ContentHash &value(const T &v) {
+    return update(&v, sizeof(v));
+  }
+
+  std::string hex() const {
+    uint64_t h0 = _h[0], h1 = _h[1], t = _word ^ _length;
+    char buf[33];
+    h0 = fmix(h0 ^ t ^ 0xA5A5A5A5u);
+    h1 = fmix(h1 ^ t ^ h0);
+    snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)h0, (unsigned long long)h1);
+    return buf;
+  }
+
+ private:
+  static uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    return k ^ (k >> 33);
+  }
+  void mixWord(uint64_t w) {
+    uint64_t h = _h[0] ^ (w * 0x87C37B91114253D5ull);
+    _h[0] = ((h << 31) | (h >> 33)) * 0x4CF5AD432745937Full;
+    _h[1] = (((_h[1] + w) * 0x9E3779B97F4A7C15ull) ^ (_h[1] >> 29)) + _h[0];
+  }
+
+  uint64_t _h[2];
+  uint64_t _word = 0, _length = 0;
+  unsigned _fill = 0;
+};
+
+// What a cache entry holds: an image in any NvCVImage format, stored tightly packed so that it can be used in place
+// once mapped, or, if the pixel format is NVCV_FORMAT_UNKNOWN, an opaque file, such as an encoded video.
+struct ResultCacheHeader {
+  char magic[8] = {'V', 'F', 'X', 'C', 'A', 'C', 'H', '1'};
+  uint32_t width = 0, height = 0;
+  int32_t pixelFormat = NVCV_FORMAT_UNKNOWN, componentType = NVCV_TYPE_UNKNOWN;
+  uint32_t planar = NVCV_CHUNKY, rowBytes = 0, planes = 1, reserved = 0;
+  uint64_t bytes = 0;  // Of the payload, which follows at kPayloadOffset
+  static const size_t kPayloadOffset = 64;  // Keeps the payload aligned for any component type
+};
+static_assert(sizeof(ResultCacheHeader) <= ResultCacheHeader::kPayloadOffset, "The header overlaps the payload");
+
+// A persistent store of results, one file per entry, named by the hash of everything that the result depends upon.
+// Entries are read by mapping them into memory. The store is bounded in size: the least recently used entries are
+// evicted first, recency being kept as the modification time of the entry file, so that it survives across runs and
+// is shared by every process that uses the same directory. Entries are written to a temporary file and renamed into
+// place, so a reader never sees a partial entry.
+class ResultCache {
+ public:
+  struct Stats {
+    unsigned long long hits = 0, misses = 0, stores = 0, evictions = 0;
+    unsigned long long bytes = 0;  // In the store, as of the last scan or change
+  };
+
+  // An entry found by lookup(), mapped for as long as this lives.
+  class Entry {
+   public:
+    const ResultCacheHeader &header() const { return _header; }
+    const unsigned char *payload() const { return _file.data() + ResultCacheHeader::kPayloadOffset; }
+
+    // Make im a view of the image in the entry; nothing is copied.
+    NvCV_Status wrap(NvCVImage *im) const {
+      return NvCVImage_Init(im, _header.width, _header.height, (int)_header.rowBytes,
+                            const_cast<unsigned char *>(payload()), (NvCVImage_PixelFormat)_header.pixelFormat,
+                            (NvCVImage_ComponentType)_header.componentType, _header.planar, NVCV_CPU);
+    }
+
+   private:
+    friend class ResultCache;
+    MappedFile _file;
+    ResultCacheHeader _header;
+  };
+
+  bool open(const std::string &dir, unsigned long long maxBytes) {
+    std::error_code ec;
+    _dir = dir;
+    _maxBytes = maxBytes;
+    std::filesystem::create_directories(_dir, ec);
+    if (!std::filesystem::is_directory(_dir, ec)) {
+      printf("Error: Could not open cache directory: \"%s\"\n", dir.c_str());
+      _dir.clear();
+      return false;
+    }
+    evict();  // Also totals the store
+    return true;
+  }
+  bool enabled() const { return !_dir.empty(); }
+  const Stats &stats() const { return _stats; }
+
+  bool lookup(const std::string &key, Entry *entry) {
+    std::string path = pathOf(key);
+    std::error_code ec;
+    if (!enabled()) return false;
+    if (!entry->_file.open(path.c_str()) || entry->_file.size() < ResultCacheHeader::kPayloadOffset) {
+      entry->_file.close();
+      ++_stats.misses;
+      return false;
+    }
+    memcpy(&entry->_header, entry->_file.data(), sizeof(entry->_header));
+    if (memcmp(entry->_header.magic, ResultCacheHeader().magic, sizeof(entry->_header.magic)) ||
+        entry->_file.size() != ResultCacheHeader::kPayloadOffset + entry->_header.bytes) {
+      entry->_file.close();  // Not an entry, or truncated; it will be replaced
+      ++_stats.misses;
+      return false;
+    }
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);  // Recently used
+    ++_stats.hits;
+    return true;
+  }
+
+  // Store an image, from CPU memory.
+  bool store(const std::string &key, const NvCVImage *im) {
+    ResultCacheHeader h;
+    h.width = im->width;
+    h.height = im->height;
+    h.pixelFormat = im->pixelFormat;
+    h.componentType = im->componentType;
+    h.planar = im->planar;
+    h.planes = (NVCV_PLANAR == im->planar) ? im->numComponents : 1;
+    h.rowBytes = im->width * ((NVCV_PLANAR == im->planar) ? im->componentBytes : im->pixelBytes);
+    h.bytes = (uint64_t)h.rowBytes * h.height * h.planes;
+    return write(key, h, [&](FILE *fp) {
+      for (unsigned p = 0; p < h.planes; ++p)
+        for (unsigned y = 0; y < h.height; ++y)
+          if (h.rowBytes != fwrite((const unsigned char *)im->pixels + ((ptrdiff_t)p * h.height + y) * im->pitch, 1,
+                                   h.rowBytes, fp))
+            return false;
+      return true;
+    });
+  }
+
+  // Store a copy of a file.
+  bool storeFile(const std::string &key, const char *path) {
+    MappedFile src;
+    ResultCacheHeader h;
+    if (!src.open(path)) return false;
+    h.bytes = src.size();
+    return write(key, h, [&](FILE *fp) { return !h.bytes || h.bytes == fwrite(src.data(), 1, h.bytes, fp); });
+  }
+
+  // Evict the least recently used entries until the store fits in its bound.
+  void evict() {
+    struct Item {
+      std::filesystem::path path;
+      std::filesystem::file_time_type time;
+      uintmax_t size;
+    };
+    std::vector<Item> items;
+    std::error_code ec;
+    _stats.bytes = 0;
+    for (auto it = std::filesystem::directory_iterator(_dir, ec); !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec)) {
+      if (it->path().extension() != kSuffix || !it->is_regular_file(ec)) continue;
+      items.push_back({it->path(), it->last_write_time(ec), it->file_size(ec)});
+      _stats.bytes += items.back().size;
+    }
+    if (_stats.bytes <= _maxBytes) return;
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.time < b.time; });
+    for (const Item &item : items) {
+      if (_stats.bytes <= _maxBytes) break;
+      if (!std::filesystem::remove(item.path, ec)) continue;
+      _stats.bytes -= item.size;
+      ++_stats.evictions;
+    }
+  }
+
+  void print() const {
+    printf("Result cache: %llu hits, %llu misses, %llu stored, %llu evicted, %.1f MB of %.1f MB\n", _stats.hits,
+           _stats.misses, _stats.stores, _stats.evictions, _stats.bytes / 1048576., _maxBytes / 1048576.);
+  }
+
+ private:
+  static constexpr const char *kSuffix = ".vfxc";
+
+  std::string pathOf(const std::string &key) const { return (std::filesystem::path(_dir) / (key + kSuffix)).string(); }
+
+  template <typename WritePayload>
+  bool write(const std::string &key, const ResultCacheHeader &h, WritePayload writePayload) {
+    static const unsigned char zeros[ResultCacheHeader::kPayloadOffset] = {};
+    std::string path = pathOf(key), tmp;
+    std::error_code ec;
+    FILE *fp;
+    if (!enabled() || ResultCacheHeader::kPayloadOffset + h.bytes > _maxBytes) return false;
+    tmp = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    if (nullptr == (fp = fopen(tmp.c_str(), "wb"))) return false;
+    bool ok = 1 == fwrite(&h, sizeof(h), 1, fp) &&
+              1 == fwrite(zeros, ResultCacheHeader::kPayloadOffset - sizeof(h), 1, fp) && writePayload(fp);
+    ok = (0 == fclose(fp)) && ok;
+    if (ok) {
+      std::filesystem::rename(tmp, path, ec);
+      ok = !ec;
+    }
+    if (!ok) {
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+    ++_stats.stores;
+    _stats.bytes += ResultCacheHeader::kPayloadOffset + h.bytes;  // Or less, if it replaced an entry
+    if (_stats.bytes > _maxBytes) evict();
+    return true;
+  }
+
+  std::string _dir;
+  unsigned long long _maxBytes = 0;
+  Stats _stats;
+};
+
+#endif  // __RESULTCACHE_H__
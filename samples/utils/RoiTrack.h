@@ -0,0 +1,139 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+
+#ifndef __ROITRACK_H__
+#define __ROITRACK_H__
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// A rectangle of a video frame, in pixels.
+struct RoiRect {
+  int x = 0, y = 0, width = 0, height = 0;
+};
+
+// The regions of interest of each frame of a video, read from a sidecar file of rectangles, either CSV lines of
+//   frame,x,y,width,height
+// or a JSON array of objects with the members "frame", "x", "y", "width" (or "w") and "height" (or "h"). A frame
+// may have several rectangles. A frame that is not mentioned has the regions of the last frame before it that is,
+// so a still region need only be given once; a rectangle of zero size gives a frame no regions.
+class RoiTrack {
+ public:
+  bool load(const char *path) {
+    std::string text;
+    char buf[4096];
+    size_t n;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+      printf("Error: Could not open ROI file: \"%s\"\n", path);
+      return false;
+    }
+    while (0 < (n = fread(buf, 1, sizeof(buf), fp))) text.append(buf, n);
+    fclose(fp);
+    _frames.clear();
+    size_t i = text.find_first_not_of(" \t\r\n");
+    bool ok = (i != std::string::npos && ('[' == text[i] || '{' == text[i])) ? parseJSON(text) : parseCSV(text);
+    if (!ok) printf("Error: \"%s\" is not a valid ROI file\n", path);
+    return ok;
+  }
+
+  // The regions of the given frame; empty if it has none.
+  const std::vector<RoiRect> &regions(unsigned frame) const {
+    static const std::vector<RoiRect> none;
+    auto it = _frames.upper_bound(frame);
+    if (it == _frames.begin()) return none;
+    return (--it)->second;
+  }
+
+  size_t numKeyFrames() const { return _frames.size(); }
+  bool empty() const { return _frames.empty(); }
+
+ private:
+  std::map<unsigned, std::vector<RoiRect>> _frames;  // Of the frames that are mentioned
+
+  bool add(long long frame, const RoiRect &r) {
+    if (frame < 0 || r.x < 0 || r.y < 0 || r.width < 0 || r.height < 0) return false;
+    std::vector<RoiRect> &rects = _frames[(unsigned)frame];
+    if (r.width && r.height) rects.push_back(r);
+    return true;
+  }
+
+  bool parseCSV(const std::string &text) {
+    size_t line = 0, begin, end;
+    for (begin = 0; begin < text.size(); begin = end + 1) {
+      end = text.find('\n', begin);
+      if (end == std::string::npos) end = text.size();
+      std::string s = text.substr(begin, end - begin);
+      const char *p = s.c_str();
+      long long frame;
+      RoiRect r;
+      ++line;
+      while (isspace((unsigned char)*p)) ++p;
+      if (!*p || '#' == *p) continue;
+      if (1 == line && !isdigit((unsigned char)*p)) continue;  // A header
+      if (5 != sscanf(p, "%lld , %d , %d , %d , %d", &frame, &r.x, &r.y, &r.width, &r.height) || !add(frame, r)) {
+        printf("Line %zu: expected frame,x,y,width,height\n", line);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Only as much JSON as a flat array of flat objects of numbers needs.
+  bool parseJSON(const std::string &text) {
+    const char *p = text.c_str(), *end;
+    while (nullptr != (p = strchr(p, '{'))) {
+      long long frame = -1;
+      RoiRect r;
+      if (nullptr == (end = strchr(p, '}'))) return false;
+      for (++p; p < end;) {
+        const char *key = strchr(p, '"'), *keyEnd;
+        if (!key || key >= end) break;
+        if (nullptr == (keyEnd = strchr(key + 1, '"')) || keyEnd >= end) return false;
+        std::string name(key + 1, keyEnd);
+        for (p = keyEnd + 1; isspace((unsigned char)*p); ++p) continue;
+        if (':' != *p++) return false;
+        char *q;
+        long long val = strtoll(p, &q, 10);
+        if (q == p) return false;
+        if ("frame" == name)                         frame = val;
+        else if ("x" == name)                        r.x = (int)val;
+        else if ("y" == name)                        r.y = (int)val;
+        else if ("width" == name || "w" == name)     r.width = (int)val;
+        else if ("height" == name || "h" == name)    r.height = (int)val;
+        p = q;
+      }
+      if (!add(frame, r)) return false;
+      p = end + 1;
+    }
+    return true;
+  }
+};
+
+#endif  // __ROITRACK_H__
@@ -0,0 +1,88 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+#ifndef __SEGMENTEDVIDEO_H__
+#define __SEGMENTEDVIDEO_H__
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// A range of frames of a video, processed apart from the rest. Decoding starts at frame first, and the frames from
+// there to begin are pre-roll, which bring temporal effects to a steady state but are not output.
+struct VideoSegment {
+  long long first;
+  long long begin;
+  long long end;  // One past the last frame output; < 0 means to the end of the video
+};
+
+// Split frameCount frames into numSegments segments of nearly equal length, each with up to overlap frames of
+// pre-roll. The last segment runs to the end of the video, in case the frame count is an underestimate.
+inline std::vector<VideoSegment> SplitVideo(long long frameCount, unsigned numSegments, long long overlap) {
+  std::vector<VideoSegment> segments(numSegments);
+  for (unsigned k = 0; k < numSegments; ++k) {
+    segments[k].begin = frameCount * k / numSegments;
+    segments[k].end = (k + 1 < numSegments) ? frameCount * (k + 1) / numSegments : -1;
+    segments[k].first = std::max(0LL, segments[k].begin - overlap);
+  }
+  return segments;
+}
+
+// Position a reader so that the next frame it decodes is the given one. Not every backend seeks exactly: a seek may
+// fail, or land on an earlier key frame, in which case the frames up to the one requested are skipped; one that lands
+// past it, or fails, is redone by decoding from the start. The reader provides
+//   bool seek(long long frame)  request a position, returning false on failure
+//   long long position()        the index of the next frame that will be decoded
+//   bool restart()              go back to the first frame
+//   bool skip()                 decode and discard one frame
+template <class Reader>
+bool SeekToFrame(Reader &reader, long long frame) {
+  long long pos = 0;
+  if (frame <= 0) return true;
+  if (!reader.seek(frame) || (pos = reader.position()) < 0 || pos > frame) {
+    if (!reader.restart()) return false;
+    pos = 0;
+  }
+  for (; pos < frame && reader.skip(); ++pos) continue;
+  return pos == frame;
+}
+
+// Run process(k) for each of numSegments segments concurrently, the first on this thread and each of the others on a
+// thread of its own, and pass each segment in order to stitch(k), as soon as it and all those before it are complete.
+// Both return false on failure, after which nothing more is stitched, though every segment is still waited for.
+// Returns whether all succeeded.
+template <class Process, class Stitch>
+bool RunSegments(unsigned numSegments, Process process, Stitch stitch) {
+  std::vector<char> processed(numSegments, 0);
+  std::vector<std::thread> workers;
+  bool ok = true;
+  for (unsigned k = 1; k < numSegments; ++k) workers.emplace_back([&, k]() { processed[k] = process(k); });
+  if (numSegments) processed[0] = process(0);
+  for (unsigned k = 0; k < numSegments; ++k) {
+    if (k) workers[k - 1].join();
+    ok = ok && processed[k] && stitch(k);
+  }
+  return ok;
+}
+
+#endif  // __SEGMENTEDVIDEO_H__
@@ -0,0 +1,184 @@
+/*###############################################################################
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###############################################################################*/
+
+
+#ifndef __STAGETIMER_H__
+#define __STAGETIMER_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Per-frame timing of the stages of video processing, summarized as percentiles.
+// Each stage keeps its own list of samples, in frame order, so a stage may be timed on its own thread (as in the
+// pipelined mode) without locking, as long as each stage is only ever timed by one thread. When disabled, now() does
+// not read the clock and mark() returns immediately, so the instrumentation can be left in place at no cost.
+// The GPU stages are timed on the host: upload and run measure the time to enqueue the work, and the download, which
+// ends by synchronizing the stream, absorbs the time that the GPU work takes to complete.
+class StageTimer {
+ public:
+  enum Stage { DECODE, UPLOAD, RUN, DOWNLOAD, ENCODE, DISPLAY, NUM_STAGES };
+  typedef std::chrono::steady_clock Clock;
+
+  // Enabling discards the samples of the previous run; disabling keeps them for inspection.
+  void enable(bool on, size_t expectedFrames = 0) {
+    _enabled = on;
+    if (!on) return;
+    for (std::vector<float> &samples : _samples) {
+      samples.clear();
+      samples.reserve(expectedFrames);
+    }
+    _frames = 0;
+    _repeated = 0;
+    _seconds = 0;
+  }
+  bool enabled() const { return _enabled; }
+
+  Clock::time_point now() const { return _enabled ? Clock::now() : Clock::time_point(); }
+
+  // Record the time for a stage since t0, and return the current time, to be the t0 of the next stage.
+  Clock::time_point mark(Stage stage, Clock::time_point t0) {
+    if (!_enabled) return t0;
+    Clock::time_point t1 = Clock::now();
+    _samples[stage].push_back(std::chrono::duration<float, std::milli>(t1 - t0).count());
+    return t1;
+  }
+
+  void start() {
+    if (_enabled) _start = Clock::now();
+  }
+  // Repeated frames are those that reused the output of an earlier one, rather than being run through the effect.
+  void stop(unsigned long long frames, unsigned long long repeated = 0) {
+    if (!_enabled) return;
+    _seconds = std::chrono::duration<double>(Clock::now() - _start).count();
+    _frames = frames;
+    _repeated = repeated;
+  }
+
+  const std::vector<float> &samples(int stage) const { return _samples[stage]; }
+  double seconds() const { return _seconds; }
+  unsigned long long frames() const { return _frames; }
+  unsigned long long repeated() const { return _repeated; }
+
+  static const char *stageName(int stage) {
+    static const char *names[NUM_STAGES] = {"decode", "upload", "run", "download", "encode", "display"};
+    return names[stage];
+  }
+
+  struct Summary {
+    size_t count = 0;
+    float mean = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;  // milliseconds
+  };
+
+  Summary summarize(int stage) const {
+    Summary sum;
+    std::vector<float> sorted(_samples[stage]);
+    if (sorted.empty()) return sum;
+    std::sort(sorted.begin(), sorted.end());
+    sum.count = sorted.size();
+    for (float ms : sorted) sum.mean += ms;
+    sum.mean /= sum.count;
+    sum.p50 = percentile(sorted, 0.50);
+    sum.p90 = percentile(sorted, 0.90);
+    sum.p99 = percentile(sorted, 0.99);
+    sum.max = sorted.back();
+    return sum;
+  }
+
+  void print() const {
+    printf("%llu frames in %.3f seconds, %.2f frames/sec\n", _frames, _seconds, fps());
+    if (_repeated)
+      printf("%llu frames (%.1f%%) repeated an earlier output\n", _repeated, 100. * _repeated / _frames);
+    printf("%-10s %8s %9s %9s %9s %9s %9s\n", "stage", "frames", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+      Summary sum = summarize(stage);
+      if (!sum.count) continue;
+      printf("%-10s %8zu %9.3f %9.3f %9.3f %9.3f %9.3f\n", stageName(stage), sum.count, sum.mean, sum.p50, sum.p90,
+             sum.p99, sum.max);
+    }
+  }
+
+  bool writeJson(const char *file) const {
+    FILE *fd = fopen(file, "w");
+    if (!fd) return false;
+    fprintf(fd, "{\n  \"frames\": %llu,\n  \"seconds\": %.6f,\n  \"fps\": %.3f,\n", _frames, _seconds, fps());
+    if (_repeated) fprintf(fd, "  \"repeated\": %llu,\n", _repeated);
+    fprintf(fd, "  \"stages\": {");
+    const char *sep = "\n";
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+      Summary sum = summarize(stage);
+      if (!sum.count) continue;
+      fprintf(fd,
+              "%s    \"%s\": {\"count\": %zu, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, "
+              "\"p99_ms\": %.4f, \"max_ms\": %.4f}",
+              sep, stageName(stage), sum.count, sum.mean, sum.p50, sum.p90, sum.p99, sum.max);
+      sep = ",\n";
+    }
+    fprintf(fd, "\n  }\n}\n");
+    return 0 == fclose(fd);
+  }
+
+  // One row per frame, one column per stage, in milliseconds. Stages that were not timed are left out.
+  bool writeCsv(const char *file) const {
+    FILE *fd = fopen(file, "w");
+    size_t rows = 0, row;
+    int stage;
+    if (!fd) return false;
+    fprintf(fd, "frame");
+    for (stage = 0; stage < NUM_STAGES; ++stage) {
+      if (_samples[stage].empty()) continue;
+      fprintf(fd, ",%s_ms", stageName(stage));
+      rows = std::max(rows, _samples[stage].size());
+    }
+    fprintf(fd, "\n");
+    for (row = 0; row < rows; ++row) {
+      fprintf(fd, "%zu", row);
+      for (stage = 0; stage < NUM_STAGES; ++stage) {
+        if (_samples[stage].empty()) continue;
+        if (row < _samples[stage].size())
+          fprintf(fd, ",%.4f", _samples[stage][row]);
+        else
+          fprintf(fd, ",");
+      }
+      fprintf(fd, "\n");
+    }
+    return 0 == fclose(fd);
+  }
+
+ private:
+  static float percentile(const std::vector<float> &sorted, double p) {  // nearest rank
+    size_t rank = (size_t)(p * sorted.size() + 0.999999);
+    return sorted[rank ? rank - 1 : 0];
+  }
+  double fps() const { return (_seconds > 0) ? _frames / _seconds : 0.; }
+
+  bool _enabled = false;
+  std::vector<float> _samples[NUM_STAGES];
+  Clock::time_point _start;
+  double _seconds = 0;
+  unsigned long long _frames = 0;
+  unsigned long long _repeated = 0;
+};
+
+#endif  // __STAGETIMER_H__
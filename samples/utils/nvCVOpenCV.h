@@ -24,6 +24,7 @@
 #ifndef __NVCVOPENCV_H__
 #define __NVCVOPENCV_H__
 
+#include "ImagePool.h"
 #include "nvCVImage.h"
 #include "opencv2/opencv.hpp"
 
@@ -78,4 +79,65 @@ inline void NVWrapperForCVMat(const cv::Mat *cvIm, NvCVImage *nvcvIm) {
   nvcvIm->reserved[1]    = 0;
 }
 
+// Allocates the pixels of cv::Mats from a PinnedHostPool, so that a Mat that is created with it, and then filled by
+// e.g. VideoCapture::read() or read by VideoWriter::write(), is transferred to and from the GPU without staging.
+// Set Mat::allocator before the Mat is created; Mats allocated this way must not outlive the allocator.
+class PinnedMatAllocator : public cv::MatAllocator {
+public:
+  explicit PinnedMatAllocator(bool pinned = true) : _pool(pinned) {}
+
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step, cv::AccessFlag /*flags*/,
+                         cv::UMatUsageFlags /*usageFlags*/) const override {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {  // As cv::StdMatAllocator
+      if (step) {
+        if (data0 && step[i] != cv::Mat::AUTO_STEP) {
+          CV_Assert(total <= step[i]);
+          total = step[i];
+        } else {
+          step[i] = total;
+        }
+      }
+      total *= sizes[i];
+    }
+    uchar* data = data0 ? (uchar*)data0 : (uchar*)_pool.acquire(total);
+    if (!data) CV_Error(cv::Error::StsNoMem, "Out of pinned memory");  // cv::Mat then tries the default allocator
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+  }
+
+  bool allocate(cv::UMatData* u, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const override {
+    return nullptr != u;
+  }
+
+  void deallocate(cv::UMatData* u) const override {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) _pool.release(u->origdata);
+    delete u;
+  }
+
+  PinnedHostPool::Stats stats() const { return _pool.stats(); }
+
+  // NVCV_CPU_PINNED if the pixels of the Mat are in pinned memory from a PinnedMatAllocator, otherwise NVCV_CPU.
+  static unsigned memSpaceOf(const cv::Mat* cvIm) {
+    const PinnedMatAllocator* a = cvIm->u ? dynamic_cast<const PinnedMatAllocator*>(cvIm->u->currAllocator) : nullptr;
+    return a ? a->_pool.memSpace(cvIm->data) : NVCV_CPU;
+  }
+
+private:
+  mutable PinnedHostPool _pool;
+};
+
+// Wrap a cv::Mat in an NvCVImage, in NVCV_CPU_PINNED memory if it was allocated by a PinnedMatAllocator that could
+// provide it, so that NvCVImage_Transfer() can copy it to or from the GPU asynchronously and without staging.
+inline void NVWrapperForPinnedCVMat(const cv::Mat *cvIm, NvCVImage *nvcvIm) {
+  NVWrapperForCVMat(cvIm, nvcvIm);
+  nvcvIm->gpuMem = (unsigned char)PinnedMatAllocator::memSpaceOf(cvIm);
+}
+
 #endif // __NVCVOPENCV_H__
\ No newline at end of file